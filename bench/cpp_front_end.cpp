@@ -0,0 +1,92 @@
+// cpp_front_end.cpp — C Macros vs. C++ Front End Throughput
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#include "../lib/loggin.hpp"
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Records per measured run */
+    static const int iterations = 1000000;
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── RUNS ────────────────────────────┐
+
+        /* Output that only renders the message, so formatting cost stands out */
+        static void render_only(log_event_t *event) {
+            char buf[1024];
+            vsnprintf(buf, sizeof(buf), event->fmt, event->ap);
+        }
+
+        template <class F>
+        static double ns_per_record(F &&body) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                body(i);
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / iterations;
+        }
+
+        int main(void) {
+            FILE *sink = fopen("/dev/null", "w");
+            std::string user = "alice";
+
+            logger_init();
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_file_output(sink, LOG_LEVEL_TRACE);
+            logger_set_level(LOG_LEVEL_INFO);
+
+            double c_enabled = ns_per_record([&](int i) {
+                log_info("user %s request %d took %.3f ms status %u", user.c_str(), i, i * 0.001, 200u);
+            });
+            double cpp_enabled = ns_per_record([&](int i) {
+                LOG_INFO("user %s request %d took %.3f ms status %u", user, i, i * 0.001, 200u);
+            });
+            double c_ints = ns_per_record([&](int i) {
+                log_info("shard %d key %d version %ld", i & 63, i, (long)i * 7);
+            });
+            double cpp_ints = ns_per_record([&](int i) {
+                LOG_INFO("shard %d key %d version %ld", i & 63, i, (long)i * 7);
+            });
+            /* Same statements again with only the rendering output attached */
+            logger_remove_output(logger_find_output(logger_file_output, sink));
+            logger_add_custom_output(render_only, NULL, LOG_LEVEL_TRACE);
+            double c_render = ns_per_record([&](int i) {
+                log_info("user %s request %d took %.3f ms status %u", user.c_str(), i, i * 0.001, 200u);
+            });
+            double cpp_render = ns_per_record([&](int i) {
+                LOG_INFO("user %s request %d took %.3f ms status %u", user, i, i * 0.001, 200u);
+            });
+
+            double c_disabled = ns_per_record([&](int i) {
+                log_debug("user %s request %d", user.c_str(), i);
+            });
+            double cpp_disabled = ns_per_record([&](int i) {
+                LOG_DEBUG("user %s request %d", user, i);
+            });
+
+            logger_cleanup();
+            fclose(sink);
+
+            printf("%-28s %10s %10s\n", "ns/record", "C macros", "C++");
+            printf("%-28s %10.1f %10.1f\n", "mixed, enabled", c_enabled, cpp_enabled);
+            printf("%-28s %10.1f %10.1f\n", "integers, enabled", c_ints, cpp_ints);
+            printf("%-28s %10.1f %10.1f\n", "mixed, render-only output", c_render, cpp_render);
+            printf("%-28s %10.1f %10.1f\n", "disabled level", c_disabled, cpp_disabled);
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
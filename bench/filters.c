@@ -0,0 +1,64 @@
+// filters.c — Cost of a Message Dropped by an Output Filter
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <time.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Heartbeats per measured run */
+    #define ITERATIONS 1000000
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── RUNS ────────────────────────────┐
+
+        static double now_ns(void) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+        }
+
+        static double run(const char *rule) {
+            FILE *file = fopen("/dev/null", "w");
+
+            logger_init();
+            logger_set_level(LOG_LEVEL_INFO);
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_file_output(file, LOG_LEVEL_INFO);
+            if (rule) {
+                logger_add_output_filter(logger_find_output(logger_file_output, file), rule);
+            }
+
+            double start = now_ns();
+            for (int i = 0; i < ITERATIONS; i++) {
+                log_info("heartbeat from worker %d, queue %d, uptime %.1f s", i & 7, i & 63, i * 0.001);
+            }
+            double elapsed = (now_ns() - start) / ITERATIONS;
+
+            logger_cleanup();
+            fclose(file);
+            return elapsed;
+        }
+
+        int main(void) {
+            printf("%-40s %8s\n", "ns/heartbeat", "");
+            printf("%-40s %8.1f\n", "no filter, written", run(NULL));
+            printf("%-40s %8.1f\n", "format^=heartbeat, dropped", run("format^=heartbeat"));
+            printf("%-40s %8.1f\n", "text*=heartbeat, dropped", run("text*=heartbeat"));
+            printf("%-40s %8.1f\n", "format^=noise, written", run("format^=noise"));
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
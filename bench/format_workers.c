@@ -0,0 +1,103 @@
+// format_workers.c — Async Throughput by Number of Format Workers
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <pthread.h>
+#include <time.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Lines per run, split across the producers */
+    #define LINES 400000
+
+    /* Threads logging during a run */
+    #define PRODUCERS 4
+
+    static pthread_mutex_t run_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── RUNS ────────────────────────────┐
+
+        static double now_sec(void) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+        }
+
+        /* The async writer requires a lock */
+        static void run_lock(bool lock, void *user_data) {
+            (void)user_data;
+            if (lock) {
+                pthread_mutex_lock(&run_mutex);
+            } else {
+                pthread_mutex_unlock(&run_mutex);
+            }
+        }
+
+        static void *producer_main(void *arg) {
+            int id = (int)(long)arg;
+            for (int i = 0; i < LINES / PRODUCERS; i++) {
+                log_info("request %d from worker %d took %.3f ms, status %s", i, id, i * 0.013, "ok");
+            }
+            return NULL;
+        }
+
+        /* Lines per second from the first log call until everything is written */
+        static double run(const char *path, unsigned workers) {
+            pthread_t threads[PRODUCERS];
+            FILE *file = fopen(path, "w");
+            if (!file) {
+                perror(path);
+                return 0;
+            }
+
+            logger_init();
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            logger_set_lock(run_lock, NULL);
+            logger_set_format_workers(workers);
+            logger_set_async(true);
+
+            double start = now_sec();
+            for (long i = 0; i < PRODUCERS; i++) {
+                pthread_create(&threads[i], NULL, producer_main, (void*)i);
+            }
+            for (int i = 0; i < PRODUCERS; i++) {
+                pthread_join(threads[i], NULL);
+            }
+            logger_flush();
+            double elapsed = now_sec() - start;
+
+            logger_cleanup();
+            fclose(file);
+            return LINES / elapsed;
+        }
+
+        int main(void) {
+            static const unsigned counts[] = { 0, 1, 2, 4, 8 };
+            char path[] = "/tmp/loggin_bench_workers.log";
+
+            printf("%d producers, %d lines per run\n", PRODUCERS, LINES);
+            printf("%-8s %16s %16s\n", "workers", "/dev/null (l/s)", "file (l/s)");
+            for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+                double null_rate = run("/dev/null", counts[i]);
+                double file_rate = run(path, counts[i]);
+                printf("%-8u %16.0f %16.0f\n", counts[i], null_rate, file_rate);
+            }
+            remove(path);
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
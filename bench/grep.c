@@ -0,0 +1,113 @@
+// grep.c — loggin-grep Against grep on a Generated Log File
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <stdlib.h>
+#include <time.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Lines in the generated file, about 100 bytes each */
+    #define LINES 2000000
+
+    /* Runs per query; the best one is reported so the page cache is warm */
+    #define RUNS 3
+
+    /* Each query written for both tools; the second adds a level set and a ten-minute window */
+    static const struct {
+        const char *name;
+        const char *loggin;
+        const char *grep;
+    } queries[] = {
+        { "substring",
+          "-c -e \"disk full\"",
+          "-c -F \"disk full\"" },
+        { "level + time + substring",
+          "-c --min-level WARN --time \"2024-01-15 14:1\" -e \"disk full\"",
+          "-c -E \"^2024-01-15 14:1.{4} (WARN |ERROR|FATAL).*disk full\"" },
+    };
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── RUNS ────────────────────────────┐
+
+        static double now_sec(void) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+        }
+
+        static int generate(const char *path) {
+            static const char *levels[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL" };
+            FILE *file = fopen(path, "w");
+            if (!file) {
+                perror(path);
+                return -1;
+            }
+            for (int i = 0; i < LINES; i++) {
+                int level = i % 13 < 8 ? i % 3 : 3 + i % 3;
+                fprintf(file, "2024-01-15 14:%02d:%02d %-5s net/conn.c:%d [handle_request]: request %d took %d us%s\n",
+                        i / (LINES / 60), i % 60, levels[level], 100 + i % 50, i, i % 977,
+                        i % 101 == 0 ? ", disk full" : ", ok");
+            }
+            fclose(file);
+            return 0;
+        }
+
+        /* Best wall time of a shell command, with its printed count */
+        static double best_time(const char *command, long *count) {
+            double best = 1e9;
+            for (int run = 0; run < RUNS; run++) {
+                char out[64] = "";
+                double start = now_sec();
+                FILE *pipe = popen(command, "r");
+                if (!pipe) {
+                    return 0;
+                }
+                if (!fgets(out, sizeof(out), pipe)) {
+                    out[0] = '\0';
+                }
+                pclose(pipe);
+                double elapsed = now_sec() - start;
+                best = elapsed < best ? elapsed : best;
+                *count = atol(out);
+            }
+            return best;
+        }
+
+        int main(void) {
+            const char *path = "/tmp/loggin_bench_grep.log";
+            char command[512];
+
+            if (generate(path) != 0) {
+                return 1;
+            }
+
+            printf("%d lines\n", LINES);
+            printf("%-26s %12s %12s %9s %9s\n", "query", "grep (ms)", "loggin (ms)", "speedup", "matches");
+            for (size_t i = 0; i < sizeof(queries) / sizeof(queries[0]); i++) {
+                long grep_count = 0, loggin_count = 0;
+                snprintf(command, sizeof(command), "LC_ALL=C grep %s %s", queries[i].grep, path);
+                double grep_time = best_time(command, &grep_count);
+                snprintf(command, sizeof(command), "./build/loggin-grep %s %s", queries[i].loggin, path);
+                double loggin_time = best_time(command, &loggin_count);
+                printf("%-26s %12.1f %12.1f %8.1fx %9ld%s\n", queries[i].name, grep_time * 1000, loggin_time * 1000,
+                       grep_time / loggin_time, loggin_count, grep_count == loggin_count ? "" : " (grep disagrees)");
+            }
+
+            remove(path);
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
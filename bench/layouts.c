@@ -0,0 +1,67 @@
+// layouts.c — Built-in File Layout vs the Same Line from a Compiled Pattern
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <time.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Lines per measured run */
+    #define ITERATIONS 500000
+
+    /* Pattern that reproduces logger_file_output with function names shown */
+    #define BUILTIN_PATTERN "%d %-5l %f:%L [%F]: %m%n"
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── RUNS ────────────────────────────┐
+
+        static double now_ns(void) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+        }
+
+        static double run(const char *pattern) {
+            FILE *file = fopen("/dev/null", "w");
+
+            logger_init();
+            logger_set_level(LOG_LEVEL_INFO);
+            logger_set_show_function(true);
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_file_output(file, LOG_LEVEL_INFO);
+            if (pattern) {
+                logger_set_output_pattern(logger_find_output(logger_file_output, file), pattern);
+            }
+
+            double start = now_ns();
+            for (int i = 0; i < ITERATIONS; i++) {
+                log_info("request %d served in %.2f ms", i, i * 0.01);
+            }
+            double elapsed = (now_ns() - start) / ITERATIONS;
+
+            logger_cleanup();
+            fclose(file);
+            return elapsed;
+        }
+
+        int main(void) {
+            printf("%-40s %8s\n", "ns/line", "");
+            printf("%-40s %8.1f\n", "built-in file layout", run(NULL));
+            printf("%-40s %8.1f\n", "pattern " BUILTIN_PATTERN, run(BUILTIN_PATTERN));
+            printf("%-40s %8.1f\n", "pattern with %ms and thread id", run("%d{%F %T.%ms} %-5l <%t> %f:%L [%F] %m%n"));
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
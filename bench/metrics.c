@@ -0,0 +1,93 @@
+// metrics.c — Cost of Metric Updates Against Logging Every Value
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <time.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Values per measured run */
+    #define ITERATIONS 10000000
+
+    /* Values per run when every one becomes a log line */
+    #define LINE_ITERATIONS 200000
+
+    /* Keeps the timed body from being optimized away */
+    static volatile unsigned sink;
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── RUNS ────────────────────────────┐
+
+        static double now_ns(void) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+        }
+
+        static void empty_body(int i) {
+            sink = (unsigned)i;
+        }
+
+        static void counter_body(int i) {
+            sink = (unsigned)i;
+            log_counter_add("bench.bytes", i & 4095);
+        }
+
+        static void gauge_body(int i) {
+            sink = (unsigned)i;
+            log_gauge_set("bench.depth", i & 63);
+        }
+
+        /* What the metric replaces: one line per value, aggregated downstream */
+        static void line_body(int i) {
+            sink = (unsigned)i;
+            log_info("request bytes=%d", i & 4095);
+        }
+
+        static double ns_per_call(void (*body)(int), int iterations) {
+            double start = now_ns();
+            for (int i = 0; i < iterations; i++) {
+                body(i);
+            }
+            return (now_ns() - start) / iterations;
+        }
+
+        int main(void) {
+            FILE *file = tmpfile();
+
+            logger_init();
+            logger_set_level(LOG_LEVEL_INFO);
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_file_output(file, LOG_LEVEL_INFO);
+
+            counter_body(0);
+            gauge_body(0);
+            double base = ns_per_call(empty_body, ITERATIONS);
+            double counter = ns_per_call(counter_body, ITERATIONS);
+            double gauge = ns_per_call(gauge_body, ITERATIONS);
+            double line = ns_per_call(line_body, LINE_ITERATIONS);
+
+            printf("%-32s %8s\n", "ns/value", "");
+            printf("%-32s %8.1f\n", "empty loop body", base);
+            printf("%-32s %8.1f\n", "log_counter_add", counter);
+            printf("%-32s %8.1f\n", "log_gauge_set", gauge);
+            printf("%-32s %8.1f\n", "log_info line to a file", line);
+
+            logger_cleanup();
+            fclose(file);
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
@@ -0,0 +1,121 @@
+// priority_lanes.c — ERROR Latency Under a TRACE Storm, Synchronous vs Async Lanes
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* ERROR lines measured per run, one per millisecond */
+    #define SAMPLES 500
+
+    /* Threads flooding TRACE lines during a storm */
+    #define STORM_THREADS 3
+
+    static double latencies[SAMPLES];
+    static volatile int latency_count;
+    static volatile bool storming;
+    static pthread_mutex_t run_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── RUNS ────────────────────────────┐
+
+        static int64_t realtime_ns(void) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        }
+
+        /* Time from the log call to the moment an ERROR reaches the outputs */
+        static void latency_output(log_event_t *event) {
+            if (latency_count < SAMPLES) {
+                latencies[latency_count++] = (double)(realtime_ns() - event->timestamp_ns) / 1000.0;
+            }
+        }
+
+        /* The async writer requires a lock; synchronous runs take it too */
+        static void run_lock(bool lock, void *user_data) {
+            (void)user_data;
+            if (lock) {
+                pthread_mutex_lock(&run_mutex);
+            } else {
+                pthread_mutex_unlock(&run_mutex);
+            }
+        }
+
+        static void *storm_main(void *arg) {
+            (void)arg;
+            for (unsigned i = 0; storming; i++) {
+                log_trace("storm line %u with enough payload to keep the disk busy for a while", i);
+            }
+            return NULL;
+        }
+
+        static int compare_double(const void *a, const void *b) {
+            double x = *(const double*)a, y = *(const double*)b;
+            return x < y ? -1 : x > y;
+        }
+
+        static void run(const char *name, bool async, bool storm) {
+            pthread_t threads[STORM_THREADS];
+            FILE *file = tmpfile();
+            log_stats_t stats;
+
+            logger_init();
+            logger_set_level(LOG_LEVEL_TRACE);
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            logger_add_custom_output(latency_output, NULL, LOG_LEVEL_ERROR);
+            logger_set_lock(run_lock, NULL);
+            logger_set_async(async);
+            latency_count = 0;
+
+            storming = storm;
+            for (int i = 0; storm && i < STORM_THREADS; i++) {
+                pthread_create(&threads[i], NULL, storm_main, NULL);
+            }
+            for (int i = 0; i < SAMPLES; i++) {
+                usleep(1000);
+                log_error("sample %d", i);
+            }
+            storming = false;
+            for (int i = 0; storm && i < STORM_THREADS; i++) {
+                pthread_join(threads[i], NULL);
+            }
+
+            logger_flush();
+            logger_get_stats(&stats);
+            qsort(latencies, (size_t)latency_count, sizeof(latencies[0]), compare_double);
+            printf("%-28s %10.1f %10.1f %10.1f %12llu\n", name,
+                   latencies[latency_count / 2], latencies[latency_count * 99 / 100],
+                   latencies[latency_count - 1], stats.records_dropped);
+
+            logger_cleanup();
+            fclose(file);
+        }
+
+        int main(void) {
+            printf("%-28s %10s %10s %10s %12s\n", "ERROR latency (us)", "p50", "p99", "max", "dropped");
+            run("sync, idle", false, false);
+            run("sync, TRACE storm", false, true);
+            run("async lanes, idle", true, false);
+            run("async lanes, TRACE storm", true, true);
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
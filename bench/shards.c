@@ -0,0 +1,95 @@
+// shards.c — Many Threads Writing One File vs Their Own Shard Files
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Writer threads per run */
+    #define THREADS 4
+
+    /* Lines per writer thread */
+    #define LINES 200000
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── RUNS ────────────────────────────┐
+
+        static double now_ns(void) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+        }
+
+        static void *writer_main(void *arg) {
+            (void)arg;
+            for (int i = 0; i < LINES; i++) {
+                log_info("request %d served in %.2f ms", i, i * 0.01);
+            }
+            return NULL;
+        }
+
+        /* Lines per second across all writers */
+        static double run(bool sharded, const char *dir) {
+            pthread_t threads[THREADS];
+            char path[256];
+
+            snprintf(path, sizeof(path), "%s/app.log", dir);
+            FILE *file = sharded ? NULL : fopen(path, "w");
+
+            logger_init();
+            logger_set_level(LOG_LEVEL_INFO);
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            if (sharded) {
+                logger_set_shard_output(path, LOG_LEVEL_INFO);
+            } else {
+                logger_add_file_output(file, LOG_LEVEL_INFO);
+            }
+
+            double start = now_ns();
+            for (int i = 0; i < THREADS; i++) {
+                pthread_create(&threads[i], NULL, writer_main, NULL);
+            }
+            for (int i = 0; i < THREADS; i++) {
+                pthread_join(threads[i], NULL);
+            }
+            logger_flush();
+            double elapsed = now_ns() - start;
+
+            logger_cleanup();
+            if (file) {
+                fclose(file);
+            }
+            return THREADS * LINES / (elapsed / 1e9);
+        }
+
+        int main(void) {
+            char dir[] = "/tmp/loggin-shards-XXXXXX";
+            if (!mkdtemp(dir)) {
+                perror("mkdtemp");
+                return 1;
+            }
+
+            printf("%-32s %12s\n", "lines/s, 4 threads", "");
+            printf("%-32s %12.0f\n", "one shared file", run(false, dir));
+            printf("%-32s %12.0f\n", "one shard per thread", run(true, dir));
+            printf("shards left in %s for loggin-merge\n", dir);
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
@@ -0,0 +1,79 @@
+// span_overhead.c — Cost of LOG_SPAN Against Hand-Timed Debug Lines
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <time.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Spans per measured run */
+    #define ITERATIONS 10000000
+
+    /* Keeps the timed body from being optimized away */
+    static volatile unsigned sink;
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── RUNS ────────────────────────────┐
+
+        static double now_ns(void) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+        }
+
+        static void empty_body(int i) {
+            sink = (unsigned)i;
+        }
+
+        static void spanned_body(int i) {
+            LOG_SPAN("bench.span");
+            sink = (unsigned)i;
+        }
+
+        /* What the span replaces: two clock reads and a (disabled) debug line */
+        static void hand_timed_body(int i) {
+            double start = now_ns();
+            sink = (unsigned)i;
+            log_debug("took %.0f ns", now_ns() - start);
+        }
+
+        static double ns_per_call(void (*body)(int)) {
+            double start = now_ns();
+            for (int i = 0; i < ITERATIONS; i++) {
+                body(i);
+            }
+            return (now_ns() - start) / ITERATIONS;
+        }
+
+        int main(void) {
+            logger_init();
+            logger_set_level(LOG_LEVEL_INFO);
+
+            spanned_body(0);
+            double base = ns_per_call(empty_body);
+            double span = ns_per_call(spanned_body);
+            double hand = ns_per_call(hand_timed_body);
+
+            printf("%-32s %8s\n", "ns/call", "");
+            printf("%-32s %8.1f\n", "empty loop body", base);
+            printf("%-32s %8.1f\n", "LOG_SPAN", span);
+            printf("%-32s %8.1f\n", "clock_gettime x2 + log_debug", hand);
+
+            logger_span_report();
+            logger_cleanup();
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
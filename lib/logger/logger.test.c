@@ -6,6 +6,8 @@
 //
 // Developed with ❤️ by Sebastian Rivera.
 
+#define _GNU_SOURCE
+
 #include "../loggin.h"
 #include <assert.h>
 #include <string.h>
@@ -13,6 +15,13 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 // ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
 
@@ -33,6 +42,13 @@
     static pthread_mutex_t test_mutex = PTHREAD_MUTEX_INITIALIZER;
     static int thread_safety_counter = 0;
 
+    /* Allocation tracking for the bounded-memory test */
+    extern void *__libc_malloc(size_t size);
+    extern void *__libc_calloc(size_t count, size_t size);
+    extern void *__libc_realloc(void *ptr, size_t size);
+    static bool allocations_tracked = false;
+    static int allocation_count = 0;
+
     /* Test counters */
     static int tests_run = 0;
     static int tests_passed = 0;
@@ -58,6 +74,22 @@
             }
         }
 
+        /* Interposed allocator, counts calls while tracking is on */
+        void *malloc(size_t size) {
+            if (allocations_tracked) __atomic_add_fetch(&allocation_count, 1, __ATOMIC_RELAXED);
+            return __libc_malloc(size);
+        }
+
+        void *calloc(size_t count, size_t size) {
+            if (allocations_tracked) __atomic_add_fetch(&allocation_count, 1, __ATOMIC_RELAXED);
+            return __libc_calloc(count, size);
+        }
+
+        void *realloc(void *ptr, size_t size) {
+            if (allocations_tracked) __atomic_add_fetch(&allocation_count, 1, __ATOMIC_RELAXED);
+            return __libc_realloc(ptr, size);
+        }
+
         /* Reset captured output */
         void reset_captured_output(void) {
             memset(captured_output, 0, sizeof(captured_output));
@@ -410,49 +442,2364 @@
 
     // └────────────────────────────────────────────────────────────────────┘
 
-    // ┌──────────────────────────── MAIN TEST RUNNER ────────────────────────────┐
+    // ┌──────────────────────────── COALESCING TESTS ────────────────────────────┐
 
-        int main(void) {
-            printf("🧪 Running Logger Test Suite\n");
-            printf("============================\n\n");
+        static void log_repeated(int count, const char *message) {
+            for (int i = 0; i < count; i++) {
+                logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "%s", message);
+            }
+        }
+
+        int test_coalesce_repeats(void) {
+            logger_init();
+            reset_captured_output();
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            logger_set_coalesce(60000);
             
-            // Initialize tests
-            tests_run = 0;
-            tests_passed = 0;
-            tests_failed = 0;
+            log_repeated(5, "Same|");
+            log_repeated(1, "Other|");
             
-            // Run all tests
-            RUN_TEST(test_logger_init_cleanup);
-            RUN_TEST(test_multiple_init_calls);
+            TEST_ASSERT(strcmp(captured_output, "Same|last message repeated 4 timesOther|") == 0);
             
-            RUN_TEST(test_logger_set_level);
-            RUN_TEST(test_logger_set_quiet);
-            RUN_TEST(test_logger_set_colors);
-            RUN_TEST(test_logger_set_show_file_line);
-            RUN_TEST(test_logger_set_show_function);
-            RUN_TEST(test_logger_set_lock);
+            logger_cleanup();
+            return 1;
+        }
+
+        int test_coalesce_flush(void) {
+            logger_init();
+            reset_captured_output();
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            logger_set_coalesce(60000);
             
-            RUN_TEST(test_logger_add_console_output);
-            RUN_TEST(test_logger_add_file_output);
-            RUN_TEST(test_logger_add_file_output_invalid);
-            RUN_TEST(test_logger_add_custom_output);
-            RUN_TEST(test_logger_add_custom_output_invalid);
+            log_repeated(3, "Tail|");
+            TEST_ASSERT(strcmp(captured_output, "Tail|") == 0);
             
-            RUN_TEST(test_logger_level_to_string);
-            RUN_TEST(test_logger_string_to_level);
+            logger_flush();
+            TEST_ASSERT(strcmp(captured_output, "Tail|last message repeated 2 times") == 0);
             
-            RUN_TEST(test_logger_log_basic);
-            RUN_TEST(test_logger_log_with_format);
-            RUN_TEST(test_logger_log_level_filtering);
+            logger_cleanup();
+            return 1;
+        }
+
+        /* A burst followed by silence is summarised once its window expires */
+        int test_coalesce_expiry(void) {
+            logger_init();
+            reset_captured_output();
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            logger_set_coalesce(40);
             
-            RUN_TEST(test_log_trace_macro);
-            RUN_TEST(test_log_info_macro);
-            RUN_TEST(test_log_error_macro);
+            log_repeated(4, "Burst|");
+            TEST_ASSERT(strcmp(captured_output, "Burst|") == 0);
+            for (int i = 0; i < 100 && strcmp(captured_output, "Burst|") == 0; i++) {
+                usleep(5000);
+            }
+            TEST_ASSERT(strcmp(captured_output, "Burst|last message repeated 3 times") == 0);
             
-            RUN_TEST(test_thread_safety);
+            /* Changing the window closes pending runs instead of dropping them */
+            reset_captured_output();
+            logger_set_coalesce(60000);
+            log_repeated(3, "Pending|");
+            logger_set_coalesce(0);
+            TEST_ASSERT(strcmp(captured_output, "Pending|last message repeated 2 times") == 0);
             
-            RUN_TEST(test_empty_message);
-            RUN_TEST(test_null_file_name);
+            logger_cleanup();
+            return 1;
+        }
+
+        int test_coalesce_output_opt_out(void) {
+            logger_init();
+            reset_captured_output();
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            logger_set_coalesce(60000);
+            
+            int output = logger_find_output(test_output_capture, NULL);
+            TEST_ASSERT(output >= 0);
+            TEST_ASSERT(logger_set_output_coalesce(output, false) == 0);
+            
+            log_repeated(3, "Each|");
+            logger_flush();
+            TEST_ASSERT(strcmp(captured_output, "Each|Each|Each|") == 0);
+            
+            logger_cleanup();
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── CATEGORY TESTS ────────────────────────────┐
+
+        int test_category_inherits_parent(void) {
+            logger_init();
+            reset_captured_output();
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            
+            log_category_t *http = logger_category("net.http");
+            log_category_t *pool = logger_category("db.pool");
+            TEST_ASSERT(strcmp(http->name, "net.http") == 0);
+            
+            logger_set_category_level("net", LOG_LEVEL_DEBUG);
+            log_cat_debug(http, "http debug|");
+            log_cat_debug(pool, "pool debug|");
+            
+            TEST_ASSERT(strcmp(captured_output, "http debug|") == 0);
+            
+            logger_cleanup();
+            return 1;
+        }
+
+        int test_category_cache_invalidation(void) {
+            logger_init();
+            reset_captured_output();
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            
+            log_category_t *http = logger_category("net.http");
+            log_cat_info(http, "first|");
+            
+            logger_set_category_level("net.http", LOG_LEVEL_ERROR);
+            log_cat_info(http, "hidden|");
+            
+            logger_clear_category_level("net.http");
+            logger_set_level(LOG_LEVEL_TRACE);
+            log_cat_trace(http, "trace|");
+            
+            TEST_ASSERT(strcmp(captured_output, "first|trace|") == 0);
+            
+            /* Levels are resolved when they change, and a new category starts from its parent's */
+            logger_set_category_level("net", LOG_LEVEL_WARN);
+            TEST_ASSERT(http->effective_level == LOG_LEVEL_WARN);
+            TEST_ASSERT(logger_category("net.late")->effective_level == LOG_LEVEL_WARN);
+            TEST_ASSERT(!logger_category_enabled(http, LOG_LEVEL_INFO));
+            
+            logger_cleanup();
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── CONFIG FILE TESTS ────────────────────────────┐
+
+        /* Outputs a configuration file may declare, as many as the logger has slots */
+        #define MAX_TEST_CONFIG_OUTPUTS 16
+
+        static void write_config(const char *path, const char *contents) {
+            FILE *file = fopen(path, "w");
+            fputs(contents, file);
+            fclose(file);
+        }
+
+        int test_load_config(void) {
+            const char *path = "test_config.conf";
+            logger_init();
+            reset_captured_output();
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            
+            write_config(path, "# test\nlevel = warn\ncategory.net.http = TRACE\n");
+            TEST_ASSERT(logger_load_config(path) == 0);
+            TEST_ASSERT(logger_get_level() == LOG_LEVEL_WARN);
+            
+            log_info("hidden|");
+            log_cat_trace(logger_category("net.http"), "http|");
+            TEST_ASSERT(strcmp(captured_output, "http|") == 0);
+            
+            logger_cleanup();
+            remove(path);
+            return 1;
+        }
+
+        int test_load_config_invalid_keeps_previous(void) {
+            const char *path = "test_config.conf";
+            logger_init();
+            
+            write_config(path, "level = DEBUG\n");
+            TEST_ASSERT(logger_load_config(path) == 0);
+            
+            write_config(path, "level = ERROR\nbogus = 1\n");
+            TEST_ASSERT(logger_load_config(path) == -1);
+            TEST_ASSERT(strstr(logger_config_error(), ":2: unknown key") != NULL);
+            TEST_ASSERT(logger_get_level() == LOG_LEVEL_DEBUG);
+            
+            logger_cleanup();
+            remove(path);
+            return 1;
+        }
+
+        /* A reload leaves slots the caller reused alone, and fails whole when outputs do not fit */
+        int test_load_config_slots(void) {
+            const char *path = "test_config.conf";
+            const char *log_path = "test_config_output.log";
+            char lines[MAX_TEST_CONFIG_OUTPUTS * 32] = "";
+            logger_init();
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            
+            snprintf(lines, sizeof(lines), "output = file %s INFO\n", log_path);
+            write_config(path, lines);
+            TEST_ASSERT(logger_load_config(path) == 0);
+            int slot = 0;
+            TEST_ASSERT(logger_remove_output(slot) == 0);
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            TEST_ASSERT(logger_find_output(test_output_capture, NULL) == slot);
+            
+            TEST_ASSERT(logger_load_config(path) == 0);
+            TEST_ASSERT(logger_find_output(test_output_capture, NULL) == slot);
+            
+            /* One more output than there are slots */
+            lines[0] = '\0';
+            for (int i = 0; i < MAX_TEST_CONFIG_OUTPUTS; i++) {
+                strcat(lines, "output = console INFO\n");
+            }
+            write_config(path, lines);
+            TEST_ASSERT(logger_load_config(path) == -1);
+            TEST_ASSERT(strstr(logger_config_error(), "no free slot") != NULL);
+            TEST_ASSERT(logger_find_output(test_output_capture, NULL) == slot);
+            TEST_ASSERT(logger_find_output(logger_console_output, stderr) == -1);
+            
+            logger_cleanup();
+            remove(path);
+            remove(log_path);
+            return 1;
+        }
+
+        int test_watch_config_reload(void) {
+            const char *path = "test_config.conf";
+            logger_init();
+            
+            write_config(path, "level = DEBUG\n");
+            
+            /* Reloads close files other threads may be writing, so a lock is required */
+            TEST_ASSERT(logger_watch_config(path) == -1);
+            TEST_ASSERT(logger_get_level() != LOG_LEVEL_DEBUG);
+            logger_set_lock(test_thread_lock, NULL);
+            TEST_ASSERT(logger_watch_config(path) == 0);
+            TEST_ASSERT(logger_get_level() == LOG_LEVEL_DEBUG);
+            
+            write_config(path, "level = ERROR\n");
+            for (int i = 0; i < 200 && logger_get_level() != LOG_LEVEL_ERROR; i++) {
+                usleep(5000);
+            }
+            TEST_ASSERT(logger_get_level() == LOG_LEVEL_ERROR);
+            
+            logger_cleanup();
+            remove(path);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── MEMORY BUDGET TESTS ────────────────────────────┐
+
+        /* Every logging path the suite exercises, in one go */
+        static void logging_workload(log_category_t *category) {
+            for (int i = 0; i < 50; i++) {
+                char request[16];
+                snprintf(request, sizeof(request), "r%d", i);
+                logger_context_set("req_id", request);
+                log_trace("Trace %d", i);
+                log_debug("Debug %s %d", test_arg1, i);
+                log_info("Info %ld %u %c", (long)i * 1000, (unsigned)i, 'x');
+                log_warn("Warn %s", "repeat");
+                log_error("Error %x", i);
+                log_fatal("Fatal %p", (void*)&i);
+                log_cat_debug(category, "Category %d", i);
+                logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, test_format, test_arg1, test_arg2);
+                logger_log(LOG_LEVEL_INFO, NULL, test_function, test_line, "");
+            }
+            
+            log_hexdump(LOG_LEVEL_DEBUG, test_format, strlen(test_format), "format");
+            
+            log_batch_t batch;
+            logger_batch_begin(&batch);
+            for (int i = 0; i < 20; i++) {
+                log_batch(&batch, LOG_LEVEL_INFO, "Shard %d summary", i);
+            }
+            logger_batch_commit(&batch);
+            logger_context_clear(NULL);
+            logger_flush();
+        }
+
+        static volatile bool workload_go = false;
+        static volatile bool workload_done = false;
+
+        /* Started before allocations are tracked, so only the logging itself is measured */
+        static void *workload_thread(void *arg) {
+            while (!workload_go) {
+                usleep(1000);
+            }
+            logging_workload((log_category_t*)arg);
+            workload_done = true;
+            return NULL;
+        }
+
+        int test_memory_budget_no_malloc(void) {
+            logger_init();
+            TEST_ASSERT(logger_set_memory_budget(256 * 1024) == 0);
+            
+            log_stats_t stats;
+            logger_get_stats(&stats);
+            TEST_ASSERT(stats.memory_budget == 256 * 1024);
+            TEST_ASSERT(stats.records_total > 0);
+            
+            FILE *file = tmpfile();
+            TEST_ASSERT(file != NULL);
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            logger_add_json_output(file, LOG_LEVEL_TRACE);
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            logger_set_lock(test_thread_lock, NULL);
+            logger_set_level(LOG_LEVEL_TRACE);
+            logger_set_coalesce(1000);
+            logger_set_show_context(true);
+            log_category_t *category = logger_category("test.budget");
+            reset_captured_output();
+            
+            allocation_count = 0;
+            allocations_tracked = true;
+            logging_workload(category);
+            allocations_tracked = false;
+            TEST_ASSERT(allocation_count == 0);
+            
+            /* A thread's first events with the throttle and the profiler counting them */
+            pthread_t thread;
+            TEST_ASSERT(logger_set_rate_budget(1000000000ul, 0) == 0);
+            logger_set_profiler(true);
+            workload_go = workload_done = false;
+            TEST_ASSERT(pthread_create(&thread, NULL, workload_thread, category) == 0);
+            allocations_tracked = true;
+            workload_go = true;
+            while (!workload_done) {
+                usleep(1000);
+            }
+            allocations_tracked = false;
+            pthread_join(thread, NULL);
+            TEST_ASSERT(allocation_count == 0);
+            logger_set_profiler(false);
+            TEST_ASSERT(ftell(file) > 0);
+            
+            logger_cleanup();
+            fclose(file);
+            TEST_ASSERT(logger_set_memory_budget(0) == 0);
+            return 1;
+        }
+
+        /* A new budget is refused while a stream still writes into the old arena */
+        int test_memory_budget_change_keeps_streams(void) {
+            logger_init();
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            TEST_ASSERT(logger_set_memory_budget(1024 * 1024) == 0);
+            
+            FILE *file = tmpfile();
+            TEST_ASSERT(file != NULL);
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            log_info("before");
+            TEST_ASSERT(logger_set_memory_budget(2 * 1024 * 1024) == -1);
+            log_info("after");
+            logger_flush();
+            TEST_ASSERT(ftell(file) > 0);
+            
+            /* The stream's buffer goes away with the arena, so it is closed first */
+            TEST_ASSERT(logger_remove_output(logger_find_output(logger_file_output, file)) == 0);
+            fclose(file);
+            TEST_ASSERT(logger_set_memory_budget(2 * 1024 * 1024) == 0);
+            log_stats_t stats;
+            logger_get_stats(&stats);
+            TEST_ASSERT(stats.memory_budget == 2 * 1024 * 1024);
+            
+            /* A stream that was already written keeps its own buffer and does not pin the arena */
+            file = tmpfile();
+            TEST_ASSERT(file != NULL);
+            fputs("header\n", file);
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            log_info("used stream");
+            TEST_ASSERT(logger_set_memory_budget(1024 * 1024) == 0);
+            log_info("still open");
+            logger_flush();
+            
+            logger_cleanup();
+            char line[256];
+            rewind(file);
+            TEST_ASSERT(fgets(line, sizeof(line), file) && strcmp(line, "header\n") == 0);
+            TEST_ASSERT(fgets(line, sizeof(line), file) && strstr(line, "used stream") != NULL);
+            TEST_ASSERT(fgets(line, sizeof(line), file) && strstr(line, "still open") != NULL);
+            fclose(file);
+            TEST_ASSERT(logger_set_memory_budget(0) == 0);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── BATCH TESTS ────────────────────────────┐
+
+        static int batch_output_count = 0;
+        static char batch_output_last[64];
+
+        static void batch_output_capture(log_event_t *event) {
+            vsnprintf(batch_output_last, sizeof(batch_output_last), event->fmt, event->ap);
+            batch_output_count++;
+        }
+
+        int test_batch_commit(void) {
+            logger_init();
+            logger_set_level(LOG_LEVEL_INFO);
+            logger_add_custom_output(batch_output_capture, NULL, LOG_LEVEL_TRACE);
+            batch_output_count = 0;
+            
+            log_batch_t batch;
+            logger_batch_begin(&batch);
+            TEST_ASSERT(log_batch(&batch, LOG_LEVEL_INFO, "shard %d", 1) == 0);
+            TEST_ASSERT(log_batch(&batch, LOG_LEVEL_DEBUG, "filtered") == 0);
+            TEST_ASSERT(log_batch(&batch, LOG_LEVEL_WARN, "shard %d", 2) == 0);
+            TEST_ASSERT(batch.count == 2);
+            
+            /* Nothing reaches the outputs before the commit */
+            TEST_ASSERT(batch_output_count == 0);
+            TEST_ASSERT(logger_batch_commit(&batch) == 2);
+            TEST_ASSERT(batch_output_count == 2);
+            TEST_ASSERT(strcmp(batch_output_last, "shard 2") == 0);
+            TEST_ASSERT(batch.head == NULL && batch.count == 0);
+            
+            log_stats_t stats;
+            logger_get_stats(&stats);
+            TEST_ASSERT(stats.records_in_use == 0);
+            
+            logger_cleanup();
+            return 1;
+        }
+
+        static void *batch_single_writer(void *arg) {
+            (void)arg;
+            for (int i = 0; i < 200; i++) {
+                log_info("single %d", i);
+            }
+            return NULL;
+        }
+
+        /* Lines of one batch stay together while another thread logs */
+        int test_batch_not_interleaved(void) {
+            FILE *file = tmpfile();
+            TEST_ASSERT(file != NULL);
+            
+            logger_init();
+            logger_set_quiet(false);
+            logger_set_level(LOG_LEVEL_INFO);
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            logger_set_lock(test_thread_lock, NULL);
+            
+            pthread_t thread;
+            pthread_create(&thread, NULL, batch_single_writer, NULL);
+            for (int b = 0; b < 20; b++) {
+                log_batch_t batch;
+                logger_batch_begin(&batch);
+                for (int i = 0; i < 10; i++) {
+                    log_batch(&batch, LOG_LEVEL_INFO, "batch %d line %d", b, i);
+                }
+                logger_batch_commit(&batch);
+            }
+            pthread_join(thread, NULL);
+            logger_cleanup();
+            
+            char line[256];
+            int current = -1;
+            int expected = 0;
+            int lines = 0;
+            rewind(file);
+            while (fgets(line, sizeof(line), file)) {
+                const char *text = strstr(line, "batch ");
+                int b, i;
+                if (!text || sscanf(text, "batch %d line %d", &b, &i) != 2) {
+                    /* A foreign line may only fall between batches */
+                    TEST_ASSERT(expected == 0);
+                    continue;
+                }
+                if (i == 0) {
+                    TEST_ASSERT(expected == 0);
+                    current = b;
+                }
+                TEST_ASSERT(b == current && i == expected);
+                expected = (expected + 1) % 10;
+                lines++;
+            }
+            fclose(file);
+            TEST_ASSERT(lines == 200);
+            return 1;
+        }
+
+        /* In bounded mode a full pool drops events instead of allocating */
+        int test_batch_bounded_drop(void) {
+            logger_init();
+            logger_set_level(LOG_LEVEL_INFO);
+            TEST_ASSERT(logger_set_memory_budget(16 * 4096 + 2 * 1024) == 0);
+            
+            log_batch_t batch;
+            logger_batch_begin(&batch);
+            for (int i = 0; i < 5; i++) {
+                log_batch(&batch, LOG_LEVEL_INFO, "event %d", i);
+            }
+            TEST_ASSERT(batch.count == 2);
+            TEST_ASSERT(batch.dropped == 3);
+            
+            log_stats_t stats;
+            logger_get_stats(&stats);
+            TEST_ASSERT(stats.records_in_use == 2);
+            TEST_ASSERT(logger_set_memory_budget(0) == -1);
+            
+            logger_batch_discard(&batch);
+            logger_get_stats(&stats);
+            TEST_ASSERT(stats.records_in_use == 0);
+            
+            logger_cleanup();
+            TEST_ASSERT(logger_set_memory_budget(0) == 0);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── SPAN TESTS ────────────────────────────┐
+
+        static void span_workload(int count) {
+            for (int i = 0; i < count; i++) {
+                LOG_SPAN("test.span");
+            }
+        }
+
+        int test_span_report(void) {
+            logger_init();
+            logger_set_level(LOG_LEVEL_INFO);
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            reset_captured_output();
+            
+            span_workload(100);
+            logger_span_report();
+            TEST_ASSERT(strstr(captured_output, "span test.span: n=100 p50=") != NULL);
+            
+            /* Only spans that ended since the last report are counted */
+            reset_captured_output();
+            logger_span_report();
+            TEST_ASSERT(captured_size == 0);
+            span_workload(7);
+            logger_span_report();
+            TEST_ASSERT(strstr(captured_output, "n=7 ") != NULL);
+            
+            logger_cleanup();
+            return 1;
+        }
+
+        int test_span_interval(void) {
+            logger_init();
+            logger_set_level(LOG_LEVEL_INFO);
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            logger_set_lock(test_thread_lock, NULL);
+            reset_captured_output();
+            
+            TEST_ASSERT(logger_set_span_interval(20) == 0);
+            span_workload(5);
+            usleep(100000);
+            TEST_ASSERT(logger_set_span_interval(0) == 0);
+            TEST_ASSERT(strstr(captured_output, "span test.span: n=5 ") != NULL);
+            
+            logger_cleanup();
+            return 1;
+        }
+
+        int test_span_trace(void) {
+            char contents[4096];
+            FILE *trace = tmpfile();
+            TEST_ASSERT(trace != NULL);
+            
+            logger_set_span_trace(trace);
+            span_workload(3);
+            logger_set_span_trace(NULL);
+            
+            rewind(trace);
+            size_t len = fread(contents, 1, sizeof(contents) - 1, trace);
+            contents[len] = '\0';
+            fclose(trace);
+            
+            TEST_ASSERT(contents[0] == '[');
+            TEST_ASSERT(strstr(contents, "{\"name\":\"test.span\",\"cat\":\"span\",\"ph\":\"X\"") != NULL);
+            TEST_ASSERT(strstr(contents, "},\n{") != NULL);
+            TEST_ASSERT(strcmp(contents + len - 3, "\n]\n") == 0);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── CLOCK TESTS ────────────────────────────┐
+
+        static int64_t clock_test_stamps[1000];
+        static int clock_test_count = 0;
+
+        static void timestamp_capture(log_event_t *event) {
+            if (clock_test_count < 1000) {
+                clock_test_stamps[clock_test_count++] = event->timestamp_ns;
+            }
+        }
+
+        static int64_t realtime_ns(void) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        }
+
+        /* TSC timestamps track the wall clock and never run backwards */
+        int test_tsc_clock(void) {
+            logger_init();
+            logger_set_level(LOG_LEVEL_INFO);
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_custom_output(timestamp_capture, NULL, LOG_LEVEL_TRACE);
+            
+            if (logger_set_tsc_clock(true) != 0) {
+                /* No invariant TSC here, the default clock stays in use */
+                logger_cleanup();
+                return 1;
+            }
+            
+            clock_test_count = 0;
+            int64_t before = realtime_ns();
+            for (int i = 0; i < 1000; i++) {
+                log_info("tick %d", i);
+            }
+            int64_t after = realtime_ns();
+            
+            TEST_ASSERT(clock_test_count == 1000);
+            TEST_ASSERT(clock_test_stamps[0] > before - 1000000);
+            TEST_ASSERT(clock_test_stamps[999] < after + 1000000);
+            for (int i = 1; i < 1000; i++) {
+                TEST_ASSERT(clock_test_stamps[i] >= clock_test_stamps[i - 1]);
+            }
+            
+            TEST_ASSERT(logger_set_tsc_clock(false) == 0);
+            logger_cleanup();
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── COMPRESSION TESTS ────────────────────────────┐
+
+        int test_lz_round_trip(void) {
+            static char input[20000];
+            static char packed[24000];
+            static char output[20000];
+            size_t len = 0;
+            
+            for (int i = 0; len + 64 < sizeof(input); i++) {
+                len += (size_t)snprintf(input + len, sizeof(input) - len,
+                                        "2024-01-15 14:30:%02d INFO  main.c:%d: request %d done\n", i % 60, i % 7, i);
+            }
+            
+            size_t packed_size = logger_lz_compress(input, len, packed, sizeof(packed));
+            TEST_ASSERT(packed_size > 0 && packed_size < len / 2);
+            TEST_ASSERT(logger_lz_decompress(packed, packed_size, output, sizeof(output)) == (long)len);
+            TEST_ASSERT(memcmp(input, output, len) == 0);
+            
+            /* Corrupt input is rejected instead of overrunning */
+            TEST_ASSERT(logger_lz_decompress(packed, packed_size, output, len / 2) == -1);
+            return 1;
+        }
+
+        int test_compressed_output(void) {
+            const char *path = "test_output.lgz";
+            remove(path);
+            
+            logger_init();
+            TEST_ASSERT(logger_add_compressed_output(path, LOG_LEVEL_TRACE) == 0);
+            for (int i = 0; i < 3000; i++) {
+                logger_log(LOG_LEVEL_WARN, test_file, test_function, test_line, "compressed line %d", i);
+            }
+            logger_cleanup();
+            
+            FILE *file = fopen(path, "rb");
+            TEST_ASSERT(file != NULL);
+            
+            static char packed[80000];
+            static char raw[70000];
+            log_frame_header_t header;
+            unsigned records = 0;
+            bool found_last = false;
+            
+            while (fread(&header, sizeof(header), 1, file) == 1) {
+                TEST_ASSERT(header.magic == LOGGER_FRAME_MAGIC);
+                TEST_ASSERT(header.first_ns <= header.last_ns);
+                TEST_ASSERT(fread(packed, 1, header.packed_size, file) == header.packed_size);
+                TEST_ASSERT(logger_lz_decompress(packed, header.packed_size, raw, sizeof(raw) - 1) == (long)header.raw_size);
+                raw[header.raw_size] = '\0';
+                found_last = found_last || strstr(raw, "WARN  test_file.c:42: compressed line 2999\n") != NULL;
+                records += header.record_count;
+            }
+            fclose(file);
+            remove(path);
+            
+            TEST_ASSERT(records == 3000);
+            TEST_ASSERT(found_last);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── FILE INDEX TESTS ────────────────────────────┐
+
+        int test_file_index(void) {
+            logger_init();
+            logger_set_level(LOG_LEVEL_TRACE);
+            FILE *log = tmpfile();
+            FILE *index = tmpfile();
+            TEST_ASSERT(log != NULL && index != NULL);
+            TEST_ASSERT(logger_set_file_index(log, index, 4) == -1); /* Not an output yet */
+            
+            logger_add_file_output(log, LOG_LEVEL_TRACE);
+            TEST_ASSERT(logger_set_file_index(log, index, 4) == 0);
+            for (int i = 0; i < 10; i++) {
+                logger_log(i == 5 ? LOG_LEVEL_ERROR : LOG_LEVEL_DEBUG, test_file, test_function, test_line, "indexed %d", i);
+            }
+            logger_cleanup();
+            
+            log_index_header_t header;
+            log_index_entry_t entries[4];
+            rewind(index);
+            TEST_ASSERT(fread(&header, sizeof(header), 1, index) == 1);
+            TEST_ASSERT(header.magic == LOGGER_INDEX_MAGIC && header.every == 4);
+            TEST_ASSERT(fread(entries, sizeof(entries[0]), 4, index) == 3);
+            
+            TEST_ASSERT(entries[0].offset == 0 && entries[0].count == 4);
+            TEST_ASSERT(entries[0].level_mask == (1u << LOG_LEVEL_DEBUG));
+            TEST_ASSERT(entries[1].level_mask == ((1u << LOG_LEVEL_DEBUG) | (1u << LOG_LEVEL_ERROR)));
+            TEST_ASSERT(entries[2].count == 2);
+            TEST_ASSERT(entries[0].first_ns <= entries[1].first_ns);
+            
+            /* Each entry points at the first line of its block */
+            char line[256];
+            TEST_ASSERT(fseek(log, (long)entries[1].offset, SEEK_SET) == 0);
+            TEST_ASSERT(fgets(line, sizeof(line), log) != NULL);
+            TEST_ASSERT(strstr(line, "indexed 4\n") != NULL);
+            
+            fclose(log);
+            fclose(index);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── CONTEXT TESTS ────────────────────────────┐
+
+        static log_event_t context_event;
+        static log_context_field_t context_fields[LOGGER_CONTEXT_MAX];
+        static char context_thread_name[LOGGER_THREAD_NAME_MAX];
+
+        /* Keep a copy of the last event's thread and context */
+        static void context_capture(log_event_t *event) {
+            context_event = *event;
+            memcpy(context_fields, event->context, (size_t)event->context_count * sizeof(context_fields[0]));
+            snprintf(context_thread_name, sizeof(context_thread_name), "%s", event->thread_name ? event->thread_name : "");
+        }
+
+        static void context_setup(void) {
+            logger_init();
+            logger_set_level(LOG_LEVEL_TRACE);
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_custom_output(context_capture, NULL, LOG_LEVEL_TRACE);
+        }
+
+        int test_context_fields(void) {
+            context_setup();
+            logger_set_thread_name("ctx-main");
+            
+            TEST_ASSERT(logger_context_set("req_id", "abc") == 0);
+            TEST_ASSERT(logger_context_set("user", "42") == 0);
+            TEST_ASSERT(logger_context_set("req_id", "def") == 0); /* Replaces in place */
+            log_info("with context");
+            TEST_ASSERT(context_event.thread_id == (int)syscall(SYS_gettid));
+            TEST_ASSERT(context_event.thread_id == logger_thread_id());
+            TEST_ASSERT(strcmp(context_thread_name, "ctx-main") == 0);
+            TEST_ASSERT(context_event.context_count == 2);
+            TEST_ASSERT(strcmp(context_fields[0].key, "req_id") == 0 && strcmp(context_fields[0].value, "def") == 0);
+            TEST_ASSERT(strcmp(context_fields[1].key, "user") == 0 && strcmp(context_fields[1].value, "42") == 0);
+            
+            logger_context_clear("req_id");
+            log_info("one left");
+            TEST_ASSERT(context_event.context_count == 1);
+            TEST_ASSERT(strcmp(context_fields[0].key, "user") == 0);
+            
+            /* Slots are fixed, so the table can fill up */
+            char key[16];
+            for (int i = 1; i < LOGGER_CONTEXT_MAX; i++) {
+                snprintf(key, sizeof(key), "k%d", i);
+                TEST_ASSERT(logger_context_set(key, "v") == 0);
+            }
+            TEST_ASSERT(logger_context_set("overflow", "v") == -1);
+            TEST_ASSERT(logger_context_set("user", "again") == 0);
+            TEST_ASSERT(logger_context_set("a_key_that_is_far_too_long_for_a_slot", "v") == -1);
+            
+            logger_context_clear(NULL);
+            log_info("no context");
+            TEST_ASSERT(context_event.context_count == 0);
+            logger_cleanup();
+            return 1;
+        }
+
+        static void *context_worker(void *arg) {
+            int *tid = (int*)arg;
+            logger_set_thread_name("ctx-worker");
+            logger_context_set("req_id", "worker");
+            log_info("from worker");
+            *tid = context_event.thread_id;
+            TEST_ASSERT(strcmp(context_thread_name, "ctx-worker") == 0);
+            TEST_ASSERT(context_event.context_count == 1);
+            return (void*)1;
+        }
+
+        /* Context belongs to the thread that set it */
+        int test_context_per_thread(void) {
+            pthread_t thread;
+            void *result = NULL;
+            int worker_tid = 0;
+            
+            context_setup();
+            logger_context_set("req_id", "main");
+            TEST_ASSERT(pthread_create(&thread, NULL, context_worker, &worker_tid) == 0);
+            pthread_join(thread, &result);
+            TEST_ASSERT(result == (void*)1);
+            TEST_ASSERT(worker_tid != 0 && worker_tid != logger_thread_id());
+            
+            log_info("from main");
+            TEST_ASSERT(context_event.context_count == 1);
+            TEST_ASSERT(strcmp(context_fields[0].value, "main") == 0);
+            logger_context_clear(NULL);
+            logger_cleanup();
+            return 1;
+        }
+
+        /* Text outputs add "[tid name] key=value" after the location */
+        int test_context_file_output(void) {
+            char line[512];
+            char expected[128];
+            FILE *file = tmpfile();
+            TEST_ASSERT(file != NULL);
+            
+            context_setup();
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            logger_set_thread_name("ctx-main");
+            logger_context_set("req_id", "abc");
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "hidden");
+            logger_set_show_context(true);
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "shown");
+            logger_context_clear(NULL);
+            logger_cleanup();
+            
+            rewind(file);
+            TEST_ASSERT(fgets(line, sizeof(line), file) != NULL);
+            TEST_ASSERT(strstr(line, " test_file.c:42: hidden\n") != NULL);
+            TEST_ASSERT(fgets(line, sizeof(line), file) != NULL);
+            snprintf(expected, sizeof(expected), " test_file.c:42 [%d ctx-main] req_id=abc: shown\n", logger_thread_id());
+            TEST_ASSERT(strstr(line, expected) != NULL);
+            fclose(file);
+            return 1;
+        }
+
+        /* JSON lines carry the thread and context as members */
+        int test_json_output(void) {
+            char line[1024];
+            char expected[128];
+            FILE *file = tmpfile();
+            TEST_ASSERT(file != NULL);
+            
+            context_setup();
+            logger_add_json_output(file, LOG_LEVEL_TRACE);
+            logger_set_thread_name("ctx-main");
+            logger_context_set("req_id", "a\"b");
+            logger_log(LOG_LEVEL_WARN, test_file, test_function, test_line, "said \"%s\"\n", "hi");
+            logger_context_clear(NULL);
+            log_category_t *category = logger_category("db");
+            log_cat_error(category, "plain");
+            logger_cleanup();
+            
+            rewind(file);
+            TEST_ASSERT(fgets(line, sizeof(line), file) != NULL);
+            TEST_ASSERT(strncmp(line, "{\"ts_ns\":", 9) == 0);
+            TEST_ASSERT(strstr(line, "\"level\":\"WARN\",\"file\":\"test_file.c\",\"line\":42,\"function\":\"test_function\"") != NULL);
+            snprintf(expected, sizeof(expected), "\"tid\":%d,\"thread\":\"ctx-main\"", logger_thread_id());
+            TEST_ASSERT(strstr(line, expected) != NULL);
+            TEST_ASSERT(strstr(line, "\"msg\":\"said \\\"hi\\\"\\u000a\",\"ctx\":{\"req_id\":\"a\\\"b\"}}\n") != NULL);
+            
+            TEST_ASSERT(fgets(line, sizeof(line), file) != NULL);
+            TEST_ASSERT(strstr(line, "\"category\":\"db\"") != NULL);
+            TEST_ASSERT(strstr(line, "\"msg\":\"plain\"}\n") != NULL);
+            fclose(file);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── HEXDUMP TESTS ────────────────────────────┐
+
+        static char hexdump_output[32768];
+        static int hexdump_count = 0;
+
+        static void hexdump_capture(log_event_t *event) {
+            vsnprintf(hexdump_output, sizeof(hexdump_output), event->fmt, event->ap);
+            hexdump_count++;
+        }
+
+        static void hexdump_setup(void) {
+            logger_init();
+            logger_set_level(LOG_LEVEL_DEBUG);
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_custom_output(hexdump_capture, NULL, LOG_LEVEL_TRACE);
+            hexdump_output[0] = '\0';
+            hexdump_count = 0;
+        }
+
+        /* Same columns as `hexdump -C`, one record for the whole dump */
+        int test_hexdump_layout(void) {
+            const unsigned char payload[] = "Hello, world!\n\0\x01\x7f\x80\xff" "AB";
+            hexdump_setup();
+            
+            log_hexdump(LOG_LEVEL_DEBUG, payload, sizeof(payload) - 1, "packet");
+            TEST_ASSERT(hexdump_count == 1);
+            TEST_ASSERT(strcmp(hexdump_output,
+                "packet (21 bytes)\n"
+                "00000000  48 65 6c 6c 6f 2c 20 77  6f 72 6c 64 21 0a 00 01  |Hello, world!...|\n"
+                "00000010  7f 80 ff 41 42                                    |...AB|") == 0);
+            
+            log_hexdump(LOG_LEVEL_DEBUG, payload, 0, NULL);
+            TEST_ASSERT(strcmp(hexdump_output, "hexdump (0 bytes)") == 0);
+            logger_cleanup();
+            return 1;
+        }
+
+        /* Disabled dumps never read the buffer */
+        int test_hexdump_disabled(void) {
+            hexdump_setup();
+            log_hexdump(LOG_LEVEL_TRACE, (const void*)16, (size_t)1 << 40, "unmapped");
+            TEST_ASSERT(hexdump_count == 0);
+            logger_cleanup();
+            return 1;
+        }
+
+        /* Long dumps are cut at the limit, or rendered in full without one */
+        int test_hexdump_limit(void) {
+            static unsigned char payload[8192];
+            for (size_t i = 0; i < sizeof(payload); i++) {
+                payload[i] = (unsigned char)i;
+            }
+            hexdump_setup();
+            
+            logger_set_hexdump_limit(32);
+            log_hexdump(LOG_LEVEL_INFO, payload, 100, "capped");
+            TEST_ASSERT(strncmp(hexdump_output, "capped (100 bytes)\n00000000  00 01", 23) == 0);
+            TEST_ASSERT(strstr(hexdump_output, "\n00000010  10 11") != NULL);
+            TEST_ASSERT(strstr(hexdump_output, "\n00000020") == NULL);
+            TEST_ASSERT(strstr(hexdump_output, "|\n... 68 more bytes") != NULL);
+            
+            /* Past the stack buffer the dump moves to the heap */
+            logger_set_hexdump_limit(0);
+            log_hexdump(LOG_LEVEL_INFO, payload, 4000, "full");
+            TEST_ASSERT(strstr(hexdump_output, "\n00000f90  90 91 92 93 94 95 96 97  98 99 9a 9b 9c 9d 9e 9f  |................|") != NULL);
+            TEST_ASSERT(strstr(hexdump_output, "more bytes") == NULL);
+            
+            const char *last = strrchr(hexdump_output, '\n');
+            TEST_ASSERT(strcmp(last, "\n00000f90  90 91 92 93 94 95 96 97  98 99 9a 9b 9c 9d 9e 9f  |................|") == 0);
+            logger_cleanup();
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── TCP OUTPUT TESTS ────────────────────────────┐
+
+        /* Collector stand-in: accepts one connection, reads `expect_lines` lines, then goes away */
+        typedef struct {
+            int listen_fd;
+            int expect_lines;
+            char data[8192];
+            size_t size;
+        } test_collector_t;
+
+        static int collector_listen(test_collector_t *collector, int port) {
+            struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port) };
+            socklen_t addr_len = sizeof(addr);
+            int one = 1;
+            
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            collector->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+            setsockopt(collector->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(collector->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+                listen(collector->listen_fd, 1) != 0 ||
+                getsockname(collector->listen_fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+                close(collector->listen_fd);
+                return -1;
+            }
+            return ntohs(addr.sin_port);
+        }
+
+        static void *collector_main(void *arg) {
+            test_collector_t *collector = (test_collector_t*)arg;
+            int fd = accept(collector->listen_fd, NULL, NULL);
+            int lines = 0;
+            
+            while (fd >= 0 && collector->size < sizeof(collector->data)) {
+                if (lines >= collector->expect_lines) {
+                    break;
+                }
+                ssize_t got = recv(fd, collector->data + collector->size, sizeof(collector->data) - collector->size, 0);
+                if (got <= 0) {
+                    break;
+                }
+                for (ssize_t i = 0; i < got; i++) {
+                    lines += collector->data[collector->size + (size_t)i] == '\n';
+                }
+                collector->size += (size_t)got;
+            }
+            
+            if (fd >= 0) close(fd);
+            close(collector->listen_fd);
+            return NULL;
+        }
+
+        static long file_size(const char *path) {
+            FILE *file = fopen(path, "rb");
+            if (!file) return -1;
+            fseek(file, 0, SEEK_END);
+            long size = ftell(file);
+            fclose(file);
+            return size;
+        }
+
+        /* Lines logged while the collector is down are spooled and replayed first once it returns */
+        int test_tcp_reconnect_spool(void) {
+            static test_collector_t first, second;
+            const char *spool = "test_tcp.spool";
+            pthread_t thread;
+            remove(spool);
+            
+            memset(&first, 0, sizeof(first));
+            first.expect_lines = 3;
+            int port = collector_listen(&first, 0);
+            TEST_ASSERT(port > 0);
+            TEST_ASSERT(pthread_create(&thread, NULL, collector_main, &first) == 0);
+            
+            logger_init();
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            TEST_ASSERT(logger_add_tcp_output("127.0.0.1", port, LOG_FRAMING_NEWLINE, spool, 1 << 20, LOG_LEVEL_INFO) == 0);
+            for (int i = 0; i < 3; i++) {
+                logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "live %d", i);
+            }
+            logger_flush();
+            pthread_join(thread, NULL);
+            TEST_ASSERT(strstr(first.data, "test_file.c:42: live 0\n") != NULL);
+            TEST_ASSERT(strstr(first.data, "test_file.c:42: live 2\n") != NULL);
+            
+            /* Collector is gone (give its FIN a moment): logging carries on and lands in the spool */
+            usleep(20000);
+            for (int i = 0; i < 3; i++) {
+                logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "spooled %d", i);
+            }
+            logger_flush();
+            TEST_ASSERT(file_size(spool) > 0);
+            
+            memset(&second, 0, sizeof(second));
+            second.expect_lines = 4;
+            TEST_ASSERT(collector_listen(&second, port) == port);
+            TEST_ASSERT(pthread_create(&thread, NULL, collector_main, &second) == 0);
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "back");
+            logger_flush();
+            pthread_join(thread, NULL);
+            logger_cleanup();
+            
+            char *spooled = strstr(second.data, "spooled 0\n");
+            char *back = strstr(second.data, "back\n");
+            TEST_ASSERT(spooled != NULL && back != NULL && spooled < back);
+            TEST_ASSERT(strstr(second.data, "spooled 2\n") < back);
+            TEST_ASSERT(strstr(second.data, "live") == NULL);
+            TEST_ASSERT(file_size(spool) == 0);
+            remove(spool);
+            return 1;
+        }
+
+        /* Length framing puts a big-endian byte count before each line */
+        int test_tcp_length_framing(void) {
+            static test_collector_t collector;
+            pthread_t thread;
+            
+            memset(&collector, 0, sizeof(collector));
+            int port = collector_listen(&collector, 0);
+            TEST_ASSERT(port > 0);
+            
+            logger_init();
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            TEST_ASSERT(logger_add_tcp_output("localhost", port, LOG_FRAMING_LENGTH, NULL, 0, LOG_LEVEL_INFO) == 0);
+            logger_log(LOG_LEVEL_WARN, test_file, test_function, test_line, "first");
+            logger_log(LOG_LEVEL_WARN, test_file, test_function, test_line, "second");
+            collector.expect_lines = 1 << 30; /* Read until cleanup closes the connection */
+            TEST_ASSERT(pthread_create(&thread, NULL, collector_main, &collector) == 0);
+            logger_cleanup();
+            pthread_join(thread, NULL);
+            
+            const unsigned char *p = (const unsigned char*)collector.data;
+            uint32_t first = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+            TEST_ASSERT(first > 5 && collector.size > 4 + first + 4);
+            TEST_ASSERT(memcmp(p + 4 + first - 5, "first", 5) == 0);
+            p += 4 + first;
+            uint32_t second = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+            TEST_ASSERT(collector.size == 4 + first + 4 + second);
+            TEST_ASSERT(memcmp(p + 4 + second - 6, "second", 6) == 0);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── PROFILER TESTS ────────────────────────────┐
+
+        static int profile_noisy_line;
+        static int profile_quiet_line;
+
+        static void profile_noisy(int i) {
+            profile_noisy_line = __LINE__ + 1;
+            log_info("noisy statement %d with a long tail of text nobody reads", i);
+        }
+
+        static void profile_quiet(void) {
+            profile_quiet_line = __LINE__ + 1;
+            log_warn("quiet");
+        }
+
+        static void *profile_worker(void *arg) {
+            (void)arg;
+            for (int i = 0; i < 5; i++) {
+                profile_noisy(i);
+            }
+            return NULL;
+        }
+
+        /* Counts merge across threads and rank sites by bytes */
+        int test_profile_top(void) {
+            log_profile_entry_t entries[4];
+            log_profile_entry_t total;
+            pthread_t thread;
+            FILE *file = tmpfile();
+            TEST_ASSERT(file != NULL);
+            
+            logger_init();
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            logger_set_profiler(true);
+            logger_profile_reset();
+            
+            for (int i = 0; i < 10; i++) {
+                profile_quiet();
+                profile_noisy(i);
+                profile_noisy(i);
+                log_debug("below the level, never counted");
+            }
+            TEST_ASSERT(pthread_create(&thread, NULL, profile_worker, NULL) == 0);
+            pthread_join(thread, NULL);
+            
+            TEST_ASSERT(logger_profile_top(entries, 4, &total) == 2);
+            TEST_ASSERT(total.events == 35);
+            TEST_ASSERT(entries[0].line == profile_noisy_line && strcmp(entries[0].file, __FILE__) == 0);
+            TEST_ASSERT(strcmp(entries[0].function, "profile_noisy") == 0 && entries[0].level == LOG_LEVEL_INFO);
+            TEST_ASSERT(entries[0].events == 25);
+            TEST_ASSERT(entries[1].line == profile_quiet_line && entries[1].events == 10);
+            TEST_ASSERT(entries[0].bytes > 2 * entries[1].bytes);
+            TEST_ASSERT(total.bytes == entries[0].bytes + entries[1].bytes);
+            TEST_ASSERT((long)total.bytes == ftell(file));
+            
+            logger_profile_reset();
+            TEST_ASSERT(logger_profile_top(entries, 4, &total) == 0 && total.events == 0);
+            profile_quiet();
+            TEST_ASSERT(logger_profile_top(entries, 4, NULL) == 1 && entries[0].events == 1);
+            
+            logger_set_profiler(false);
+            logger_cleanup();
+            fclose(file);
+            return 1;
+        }
+
+        /* The report goes through the outputs and does not count itself */
+        int test_profile_report(void) {
+            char expected[128];
+            log_profile_entry_t total;
+            
+            logger_init();
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            logger_set_profiler(true);
+            logger_profile_reset();
+            for (int i = 0; i < 3; i++) {
+                profile_noisy(i);
+            }
+            profile_quiet();
+            
+            reset_captured_output();
+            logger_profile_report(1);
+            TEST_ASSERT(strstr(captured_output, "log volume: 4 events, ") != NULL);
+            snprintf(expected, sizeof(expected), "#1 %s:%d INFO: 3 events (75.0%%), ", __FILE__, profile_noisy_line);
+            TEST_ASSERT(strstr(captured_output, expected) != NULL);
+            TEST_ASSERT(strstr(captured_output, "#2") == NULL);
+            logger_profile_top(NULL, 0, &total);
+            TEST_ASSERT(total.events == 4);
+            
+            /* Interval reports cover one interval each */
+            reset_captured_output();
+            TEST_ASSERT(logger_set_profile_interval(50, 3) == 0);
+            for (int i = 0; i < 40 && !strstr(captured_output, "log volume"); i++) {
+                usleep(10000);
+            }
+            TEST_ASSERT(strstr(captured_output, "log volume: ") != NULL);
+            TEST_ASSERT(logger_set_profile_interval(0, 0) == 0);
+            
+            logger_set_profiler(false);
+            logger_cleanup();
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── ASYNC WRITER TESTS ────────────────────────────┐
+
+        static char async_lines[512][32];
+        static int async_line_count = 0;
+        static volatile bool async_gate_entered = false;
+        static volatile bool async_gate_open = false;
+
+        /* Records messages in write order; holds the writer on "gate" until released */
+        static void async_capture(log_event_t *event) {
+            char message[32];
+            vsnprintf(message, sizeof(message), event->fmt, event->ap);
+            if (strcmp(message, "gate") == 0) {
+                async_gate_entered = true;
+                while (!async_gate_open) {
+                    usleep(1000);
+                }
+            }
+            if (async_line_count < 512) {
+                strcpy(async_lines[async_line_count++], message);
+            }
+        }
+
+        /* An error queued behind a trace flood is written next, each lane in order, with or without workers */
+        int test_async_priority_lanes(void) {
+            for (unsigned workers = 0; workers <= 2; workers += 2) {
+                logger_init();
+                logger_set_level(LOG_LEVEL_TRACE);
+                logger_remove_output(logger_find_output(logger_console_output, stderr));
+                logger_add_custom_output(async_capture, NULL, LOG_LEVEL_TRACE);
+                async_line_count = 0;
+                async_gate_entered = false;
+                async_gate_open = false;
+                TEST_ASSERT(logger_set_format_workers(workers) == 0);
+                
+                /* The writer and the synchronous fallbacks share the outputs, so a lock is required */
+                TEST_ASSERT(logger_set_async(true) == -1);
+                logger_set_lock(test_thread_lock, NULL);
+                TEST_ASSERT(logger_set_async(true) == 0);
+                
+                log_trace("gate");
+                while (!async_gate_entered) {
+                    usleep(1000);
+                }
+                for (int i = 0; i < 200; i++) {
+                    log_trace("trace %d", i);
+                }
+                log_error("error 0");
+                log_trace("trace 200");
+                log_error("error 1");
+                async_gate_open = true;
+                logger_flush();
+                
+                TEST_ASSERT(async_line_count == 204);
+                TEST_ASSERT(strcmp(async_lines[0], "gate") == 0);
+                TEST_ASSERT(strcmp(async_lines[1], "error 0") == 0);
+                TEST_ASSERT(strcmp(async_lines[2], "error 1") == 0);
+                for (int i = 0; i <= 200; i++) {
+                    char expected[32];
+                    snprintf(expected, sizeof(expected), "trace %d", i);
+                    TEST_ASSERT(strcmp(async_lines[3 + i], expected) == 0);
+                }
+                
+                TEST_ASSERT(logger_set_async(false) == 0);
+                logger_cleanup();
+            }
+            return 1;
+        }
+
+        /* Records keep their producer's context; FATAL waits until it is written */
+        int test_async_context_and_fatal(void) {
+            context_setup();
+            logger_set_lock(test_thread_lock, NULL);
+            TEST_ASSERT(logger_set_async(true) == 0);
+            logger_set_thread_name("async-main");
+            logger_context_set("req_id", "q7");
+            
+            log_info("queued");
+            logger_flush();
+            TEST_ASSERT(context_event.thread_id == logger_thread_id());
+            TEST_ASSERT(strcmp(context_thread_name, "async-main") == 0);
+            TEST_ASSERT(context_event.context_count == 1);
+            TEST_ASSERT(strcmp(context_fields[0].key, "req_id") == 0 && strcmp(context_fields[0].value, "q7") == 0);
+            
+            logger_context_clear(NULL);
+            log_fatal("going down");
+            TEST_ASSERT(context_event.level == LOG_LEVEL_FATAL && context_event.context_count == 0);
+            
+            logger_cleanup();
+            return 1;
+        }
+
+        /* Lines rendered by format workers reach the file complete and in logging order */
+        int test_async_format_workers(void) {
+            char line[512];
+            char expected[64];
+            FILE *file = tmpfile();
+            TEST_ASSERT(file != NULL);
+            
+            context_setup();
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            logger_set_show_function(true);
+            logger_set_lock(test_thread_lock, NULL);
+            TEST_ASSERT(logger_set_format_workers(17) == -1);
+            TEST_ASSERT(logger_set_async(true) == 0);
+            
+            /* The count changes on a running writer too */
+            for (int i = 0; i < 6000; i++) {
+                if (i == 1000) {
+                    TEST_ASSERT(logger_set_format_workers(4) == 0);
+                }
+                if (i == 4000) {
+                    logger_flush();
+                    logger_set_show_function(false);
+                }
+                logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "line %d", i);
+            }
+            logger_flush();
+            TEST_ASSERT(context_event.fmt != NULL && strcmp(context_event.fmt, "%s") == 0);
+            logger_cleanup();
+            
+            rewind(file);
+            int count = 0;
+            while (fgets(line, sizeof(line), file)) {
+                snprintf(expected, sizeof(expected), ": line %d\n", count);
+                size_t length = strlen(line);
+                TEST_ASSERT(length > strlen(expected) && strcmp(line + length - strlen(expected), expected) == 0);
+                TEST_ASSERT(strstr(line, " INFO  test_file.c:42") != NULL);
+                TEST_ASSERT((strstr(line, " [test_function]: ") != NULL) == (count < 4000));
+                count++;
+            }
+            fclose(file);
+            TEST_ASSERT(count == 6000);
+            return 1;
+        }
+
+        /* Under a memory budget the chunk ring comes out of the record slots and goes back after */
+        int test_async_format_workers_budget(void) {
+            log_stats_t stats;
+            context_setup();
+            logger_set_lock(test_thread_lock, NULL);
+            TEST_ASSERT(logger_set_memory_budget(256 * 1024) == 0);
+            TEST_ASSERT(logger_set_format_workers(2) == 0);
+            logger_get_stats(&stats);
+            unsigned long total = stats.records_total;
+            
+            /* Too small for four chunks and a useful pool: no workers, no records lent */
+            TEST_ASSERT(logger_set_async(true) == 0);
+            logger_get_stats(&stats);
+            TEST_ASSERT(stats.records_total == total);
+            TEST_ASSERT(logger_set_async(false) == 0);
+            
+            TEST_ASSERT(logger_set_memory_budget(1024 * 1024) == 0);
+            logger_get_stats(&stats);
+            total = stats.records_total;
+            TEST_ASSERT(logger_set_async(true) == 0);
+            logger_get_stats(&stats);
+            TEST_ASSERT(stats.memory_budget == 1024 * 1024);
+            TEST_ASSERT(stats.records_total < total - 4 * 64);
+            TEST_ASSERT(logger_set_memory_budget(2 * 1024 * 1024) == -1);
+            
+            for (int i = 0; i < 1000; i++) {
+                logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "line %d", i);
+            }
+            logger_flush();
+            TEST_ASSERT(context_event.fmt != NULL && strcmp(context_event.fmt, "%s") == 0);
+            
+            TEST_ASSERT(logger_set_async(false) == 0);
+            logger_get_stats(&stats);
+            TEST_ASSERT(stats.records_total == total);
+            TEST_ASSERT(logger_set_memory_budget(2 * 1024 * 1024) == 0);
+            TEST_ASSERT(logger_set_memory_budget(0) == 0);
+            logger_cleanup();
+            return 1;
+        }
+
+        /* Messages longer than a record reach the file whole and in order; batches count the cut */
+        int test_async_long_messages(void) {
+            static char message[3001];
+            static char line[4096];
+            unsigned char payload[512];
+            log_stats_t stats;
+            log_batch_t batch;
+            FILE *file = tmpfile();
+            TEST_ASSERT(file != NULL);
+            memset(message, 'x', sizeof(message) - 1);
+            for (size_t i = 0; i < sizeof(payload); i++) {
+                payload[i] = (unsigned char)i;
+            }
+            
+            context_setup();
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            logger_set_lock(test_thread_lock, NULL);
+            TEST_ASSERT(logger_set_async(true) == 0);
+            log_info("before");
+            log_info("%s", message);
+            log_info("after");
+            log_hexdump(LOG_LEVEL_INFO, payload, sizeof(payload), "dump");
+            logger_flush();
+            
+            logger_get_stats(&stats);
+            unsigned long long truncated = stats.records_truncated;
+            logger_batch_begin(&batch);
+            log_batch(&batch, LOG_LEVEL_INFO, "%s", message);
+            logger_batch_commit(&batch);
+            logger_get_stats(&stats);
+            TEST_ASSERT(stats.records_truncated == truncated + 1);
+            logger_cleanup();
+            
+            rewind(file);
+            TEST_ASSERT(fgets(line, sizeof(line), file) && strstr(line, ": before\n") != NULL);
+            TEST_ASSERT(fgets(line, sizeof(line), file) && strlen(line) > 3003);
+            TEST_ASSERT(strncmp(line + strlen(line) - 3003, ": ", 2) == 0);
+            TEST_ASSERT(strncmp(line + strlen(line) - 3001, message, 3000) == 0);
+            TEST_ASSERT(fgets(line, sizeof(line), file) && strstr(line, ": after\n") != NULL);
+            TEST_ASSERT(fgets(line, sizeof(line), file) && strstr(line, ": dump (512 bytes)\n") != NULL);
+            for (int row = 0; row < 32; row++) {
+                char offset[16];
+                snprintf(offset, sizeof(offset), "%08x  ", row * 16);
+                TEST_ASSERT(fgets(line, sizeof(line), file) && strncmp(line, offset, 10) == 0);
+            }
+            fclose(file);
+            return 1;
+        }
+
+        /* A batch committed while lines are queued lands after them */
+        int test_async_batch_order(void) {
+            char line[256];
+            log_batch_t batch;
+            int queued = 0;
+            FILE *file = tmpfile();
+            TEST_ASSERT(file != NULL);
+            
+            context_setup();
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            logger_set_lock(test_thread_lock, NULL);
+            TEST_ASSERT(logger_set_async(true) == 0);
+            for (int i = 0; i < 500; i++) {
+                log_info("queued %d", i);
+            }
+            logger_batch_begin(&batch);
+            log_batch(&batch, LOG_LEVEL_INFO, "batched");
+            TEST_ASSERT(logger_batch_commit(&batch) == 1);
+            logger_cleanup();
+            
+            rewind(file);
+            while (fgets(line, sizeof(line), file)) {
+                if (strstr(line, ": batched\n")) {
+                    break;
+                }
+                queued++;
+            }
+            TEST_ASSERT(queued == 500);
+            fclose(file);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── METRIC TESTS ────────────────────────────┐
+
+        static void *metric_worker(void *arg) {
+            for (int i = 1; i <= 100; i++) {
+                log_counter_add("test.bytes", i);
+            }
+            log_gauge_set("test.depth", *(int*)arg);
+            return NULL;
+        }
+
+        /* Every thread's values merge into one line per metric */
+        int test_metric_report(void) {
+            pthread_t threads[2];
+            int depths[2] = { 3, 9 };
+            logger_init();
+            logger_set_level(LOG_LEVEL_INFO);
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            reset_captured_output();
+            
+            for (int i = 0; i < 2; i++) {
+                TEST_ASSERT(pthread_create(&threads[i], NULL, metric_worker, &depths[i]) == 0);
+            }
+            for (int i = 0; i < 2; i++) {
+                pthread_join(threads[i], NULL);
+            }
+            log_counter_add("test.bytes", 1000);
+            logger_metric_report();
+            TEST_ASSERT(strstr(captured_output, "counter test.bytes: n=201 sum=11100 min=1 max=1000") != NULL);
+            TEST_ASSERT(strstr(captured_output, "gauge test.depth: last=") != NULL);
+            TEST_ASSERT(strstr(captured_output, " n=2 sum=12 min=3 max=9") != NULL);
+            
+            /* Only values recorded since the last report count, min and max start over */
+            reset_captured_output();
+            logger_metric_report();
+            TEST_ASSERT(captured_size == 0);
+            log_counter_add("test.bytes", 5);
+            log_counter_add("test.bytes", 7);
+            logger_metric_report();
+            TEST_ASSERT(strstr(captured_output, "counter test.bytes: n=2 sum=12 min=5 max=7") != NULL);
+            
+            logger_cleanup();
+            return 1;
+        }
+
+        /* The ticker reports on its own and cleanup reports the partial interval */
+        int test_metric_interval(void) {
+            logger_init();
+            logger_set_level(LOG_LEVEL_INFO);
+            logger_add_custom_output(test_output_capture, NULL, LOG_LEVEL_TRACE);
+            logger_set_lock(test_thread_lock, NULL);
+            reset_captured_output();
+            
+            TEST_ASSERT(logger_set_metric_interval(20) == 0);
+            log_gauge_set("test.interval", 42);
+            usleep(100000);
+            TEST_ASSERT(strstr(captured_output, "gauge test.interval: last=42 n=1 ") != NULL);
+            
+            log_gauge_set("test.interval", 7);
+            logger_cleanup();
+            TEST_ASSERT(strstr(captured_output, "gauge test.interval: last=7 n=1 ") != NULL);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── THROTTLING TESTS ────────────────────────────┐
+
+        static int throttle_counts[LOG_LEVEL_FATAL + 1];
+        static char throttle_message[256];
+
+        /* Counts events per level and keeps the latest throttle step */
+        static void throttle_output(log_event_t *event) {
+            char buffer[256];
+            __atomic_add_fetch(&throttle_counts[event->level], 1, __ATOMIC_RELAXED);
+            if (event->function && strcmp(event->function, "throttle") == 0) {
+                vsnprintf(buffer, sizeof(buffer), event->fmt, event->ap);
+                strcpy(throttle_message, buffer);
+            }
+        }
+
+        /* A flood raises the threshold step by step up to ERROR, a quiet spell lowers it again */
+        int test_rate_throttle(void) {
+            log_stats_t stats;
+            memset(throttle_counts, 0, sizeof(throttle_counts));
+            throttle_message[0] = '\0';
+            logger_init();
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_set_level(LOG_LEVEL_TRACE);
+            logger_add_custom_output(throttle_output, NULL, LOG_LEVEL_TRACE);
+            TEST_ASSERT(logger_set_rate_budget(200, 0) == 0);
+            
+            for (int i = 0; i < 400 && logger_throttle_level() < LOG_LEVEL_ERROR; i++) {
+                for (int j = 0; j < 50; j++) {
+                    log_trace("flood %d", j);
+                    log_warn("flood %d", j);
+                }
+                usleep(10000);
+            }
+            TEST_ASSERT(logger_throttle_level() == LOG_LEVEL_ERROR);
+            TEST_ASSERT(strstr(throttle_message, "over budget: dropping WARN and below") != NULL);
+            
+            /* The threshold never passes ERROR */
+            int errors = throttle_counts[LOG_LEVEL_ERROR];
+            int warnings = throttle_counts[LOG_LEVEL_WARN];
+            log_warn("shed");
+            log_error("kept");
+            TEST_ASSERT(throttle_counts[LOG_LEVEL_WARN] == warnings);
+            TEST_ASSERT(throttle_counts[LOG_LEVEL_ERROR] == errors + 1);
+            logger_get_stats(&stats);
+            TEST_ASSERT(stats.records_throttled > 0);
+            
+            for (int i = 0; i < 400 && logger_throttle_level() != LOG_LEVEL_TRACE; i++) {
+                usleep(10000);
+            }
+            TEST_ASSERT(logger_throttle_level() == LOG_LEVEL_TRACE);
+            TEST_ASSERT(strstr(throttle_message, "back under budget: logging TRACE again") != NULL);
+            
+            logger_cleanup();
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── CRASH RING TESTS ────────────────────────────┐
+
+        #define RING_TEST_SLOTS 16
+
+        static const log_ring_slot_t *ring_test_slot(const unsigned char *map, uint64_t seq) {
+            return (const log_ring_slot_t*)(map + ((seq - 1) % (RING_TEST_SLOTS - 1) + 1) * LOGGER_RING_SLOT_SIZE);
+        }
+
+        /* Lines logged right before a SIGKILL are in the file, in sequence order */
+        int test_ring_survives_kill(void) {
+            static unsigned char map[RING_TEST_SLOTS * LOGGER_RING_SLOT_SIZE];
+            const char *path = "test_ring.bin";
+            char expected[LOGGER_RING_SLOT_SIZE];
+            char long_arg[601];
+            int status;
+            remove(path);
+            memset(long_arg, 'x', sizeof(long_arg) - 1);
+            long_arg[sizeof(long_arg) - 1] = '\0';
+            
+            logger_cleanup();
+            pid_t pid = fork();
+            TEST_ASSERT(pid >= 0);
+            if (pid == 0) {
+                logger_init();
+                logger_remove_output(logger_find_output(logger_console_output, stderr));
+                if (logger_add_ring_output(path, sizeof(map), LOG_LEVEL_TRACE) != 0) {
+                    _exit(1);
+                }
+                for (int i = 0; i < 40; i++) {
+                    logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "ring line %d", i);
+                }
+                logger_log(LOG_LEVEL_ERROR, test_file, test_function, test_line, "long %s", long_arg);
+                kill(getpid(), SIGKILL);
+                _exit(1);
+            }
+            TEST_ASSERT(waitpid(pid, &status, 0) == pid);
+            TEST_ASSERT(WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL);
+            
+            FILE *file = fopen(path, "rb");
+            TEST_ASSERT(file != NULL);
+            TEST_ASSERT(fread(map, 1, sizeof(map), file) == sizeof(map));
+            fclose(file);
+            
+            const log_ring_header_t *header = (const log_ring_header_t*)map;
+            TEST_ASSERT(header->magic == LOGGER_RING_MAGIC);
+            TEST_ASSERT(header->slot_count == RING_TEST_SLOTS - 1);
+            
+            /* 40 one-slot lines, then the long line across three slots */
+            for (uint64_t seq = 44 - header->slot_count; seq <= 43; seq++) {
+                TEST_ASSERT(ring_test_slot(map, seq)->seq == seq);
+            }
+            const log_ring_slot_t *slot = ring_test_slot(map, 40);
+            snprintf(expected, sizeof(expected), "INFO  test_file.c:42: ring line 39\n");
+            TEST_ASSERT(slot->flags == 0 && slot->level == LOG_LEVEL_INFO);
+            TEST_ASSERT(slot->length > strlen(expected));
+            TEST_ASSERT(memcmp((const char*)(slot + 1) + slot->length - strlen(expected), expected, strlen(expected)) == 0);
+            TEST_ASSERT(ring_test_slot(map, 41)->flags == 0);
+            TEST_ASSERT(ring_test_slot(map, 42)->flags == LOGGER_RING_CONTINUED);
+            slot = ring_test_slot(map, 43);
+            TEST_ASSERT(slot->flags == LOGGER_RING_CONTINUED);
+            TEST_ASSERT(((const char*)(slot + 1))[slot->length - 1] == '\n');
+            
+            /* A new run keeps the old records and continues the numbering */
+            logger_init();
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            TEST_ASSERT(logger_add_ring_output(path, sizeof(map), LOG_LEVEL_TRACE) == 0);
+            log_info("after restart");
+            logger_cleanup();
+            
+            file = fopen(path, "rb");
+            TEST_ASSERT(file != NULL);
+            TEST_ASSERT(fread(map, 1, sizeof(map), file) == sizeof(map));
+            fclose(file);
+            remove(path);
+            
+            slot = ring_test_slot(map, 44);
+            TEST_ASSERT(slot->seq == 44);
+            snprintf(expected, sizeof(expected), "%.*s", (int)slot->length, (const char*)(slot + 1));
+            TEST_ASSERT(strstr(expected, "after restart\n") != NULL);
+            TEST_ASSERT(ring_test_slot(map, 43)->seq == 43);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── LAYOUT TESTS ────────────────────────────┐
+
+        /* Every conversion renders, and a cached call site renders the same the second time */
+        int test_output_pattern(void) {
+            char line[8192];
+            char expected[256];
+            char big[5001];
+            FILE *file = tmpfile();
+            TEST_ASSERT(file != NULL);
+            memset(big, 'x', sizeof(big) - 1);
+            big[sizeof(big) - 1] = '\0';
+            
+            context_setup();
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            int output = logger_find_output(logger_file_output, file);
+            TEST_ASSERT(logger_set_output_pattern(output, "%d{%Y|%ms} %-5l|%5L|%f:%L [%F] %c <%t %N> %X %% %m%n") == 0);
+            logger_set_thread_name("lay-main");
+            logger_context_set("req_id", "abc");
+            for (int i = 0; i < 2; i++) {
+                logger_log(LOG_LEVEL_WARN, test_file, test_function, test_line, "value %d", i);
+            }
+            logger_context_clear(NULL);
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "%s", big);
+            TEST_ASSERT(logger_set_output_pattern(output, NULL) == 0);
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "default");
+            logger_cleanup();
+            
+            rewind(file);
+            for (int i = 0; i < 2; i++) {
+                TEST_ASSERT(fgets(line, sizeof(line), file) != NULL);
+                TEST_ASSERT(line[4] == '|' && line[8] == ' ');
+                snprintf(expected, sizeof(expected), " WARN |   42|test_file.c:42 [test_function]  <%d lay-main> req_id=abc %% value %d\n",
+                         logger_thread_id(), i);
+                TEST_ASSERT(strcmp(line + 8, expected) == 0);
+            }
+            TEST_ASSERT(fgets(line, sizeof(line), file) != NULL);
+            TEST_ASSERT(strlen(line) > sizeof(big) && strstr(line, big) != NULL);
+            TEST_ASSERT(fgets(line, sizeof(line), file) != NULL);
+            TEST_ASSERT(strstr(line, " INFO  test_file.c:42: default\n") != NULL);
+            fclose(file);
+            return 1;
+        }
+
+        /* Bad patterns and outputs without a text layout are refused */
+        int test_output_pattern_invalid(void) {
+            context_setup();
+            logger_add_console_output(LOG_LEVEL_TRACE);
+            int console = logger_find_output(logger_console_output, stderr);
+            TEST_ASSERT(logger_set_output_pattern(console, "%m%n") == 0);
+            TEST_ASSERT(logger_set_output_pattern(console, "%q") == -1);
+            TEST_ASSERT(logger_set_output_pattern(console, "%d{%H") == -1);
+            TEST_ASSERT(logger_set_output_pattern(logger_find_output(context_capture, NULL), "%m") == -1);
+            TEST_ASSERT(logger_set_output_pattern(-1, "%m") == -1);
+            logger_cleanup();
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── FILTER TESTS ────────────────────────────┐
+
+        /* Each kind of term drops what it should, also for async records */
+        int test_output_filters(void) {
+            char text[2048];
+            FILE *file = tmpfile();
+            TEST_ASSERT(file != NULL);
+            
+            context_setup();
+            logger_add_file_output(file, LOG_LEVEL_TRACE);
+            int output = logger_find_output(logger_file_output, file);
+            TEST_ASSERT(logger_add_output_filter(output, "format^=heartbeat") == 0);
+            TEST_ASSERT(logger_add_output_filter(output, "level<INFO file=net/*.c") == 0);
+            TEST_ASSERT(logger_add_output_filter(output, "function=poll_* format*=\"idle for\"") == 0);
+            TEST_ASSERT(logger_add_output_filter(output, "text*=secret") == 0);
+            
+            for (int i = 0; i < 3; i++) {
+                logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "heartbeat %d", i);
+                logger_log(LOG_LEVEL_DEBUG, "net/conn.c", test_function, test_line, "net debug %d", i);
+                logger_log(LOG_LEVEL_INFO, "net/conn.c", test_function, test_line, "net info %d", i);
+                logger_log(LOG_LEVEL_INFO, test_file, "poll_loop", test_line, "idle for %d ms", i);
+                logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "idle for %d ms", i);
+                logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "token %s", i == 1 ? "secret" : "public");
+            }
+            logger_set_lock(test_thread_lock, NULL);
+            TEST_ASSERT(logger_set_async(true) == 0);
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "heartbeat async");
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "async %s", "secret");
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "async kept");
+            logger_set_async(false);
+            
+            TEST_ASSERT(logger_clear_output_filters(output) == 0);
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "heartbeat cleared");
+            logger_cleanup();
+            
+            size_t length = fread(text, 1, sizeof(text) - 1, (rewind(file), file));
+            text[length] = '\0';
+            fclose(file);
+            TEST_ASSERT(strstr(text, "heartbeat 0") == NULL && strstr(text, "heartbeat async") == NULL);
+            TEST_ASSERT(strstr(text, "net debug") == NULL && strstr(text, "net info 2") != NULL);
+            /* Only the poll_loop copy of the idle line was dropped */
+            const char *idle = strstr(text, "idle for 2 ms");
+            TEST_ASSERT(idle != NULL && strstr(idle + 1, "idle for 2 ms") == NULL);
+            TEST_ASSERT(strstr(text, "secret") == NULL && strstr(text, "token public") != NULL);
+            TEST_ASSERT(strstr(text, "async kept") != NULL && strstr(text, "heartbeat cleared") != NULL);
+            return 1;
+        }
+
+        /* Unknown terms, operators and empty rules are refused */
+        int test_output_filter_invalid(void) {
+            context_setup();
+            int output = logger_find_output(context_capture, NULL);
+            TEST_ASSERT(logger_add_output_filter(output, "") == -1);
+            TEST_ASSERT(logger_add_output_filter(output, "colour=red") == -1);
+            TEST_ASSERT(logger_add_output_filter(output, "level<=LOUD") == -1);
+            TEST_ASSERT(logger_add_output_filter(output, "file^=net") == -1);
+            TEST_ASSERT(logger_add_output_filter(output, "format^=") == -1);
+            TEST_ASSERT(logger_add_output_filter(-1, "level<=INFO") == -1);
+            for (int i = 0; i < 16; i++) {
+                TEST_ASSERT(logger_add_output_filter(output, "level<=TRACE") == 0);
+            }
+            TEST_ASSERT(logger_add_output_filter(output, "level<=TRACE") == -1);
+            logger_cleanup();
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── WATCHDOG TESTS ────────────────────────────┐
+
+        static volatile bool hang_armed, hang_entered, hang_release;
+        static volatile int hang_calls;
+        static char fallback_text[256];
+
+        /* Blocks once when armed, like a write to a hung mount */
+        static void hang_output(log_event_t *event) {
+            (void)event;
+            hang_calls++;
+            if (hang_armed) {
+                hang_armed = false;
+                hang_entered = true;
+                while (!hang_release) {
+                    usleep(1000);
+                }
+            }
+        }
+
+        static void fallback_output(log_event_t *event) {
+            vsnprintf(fallback_text, sizeof(fallback_text), event->fmt, event->ap);
+        }
+
+        static void *hang_worker(void *arg) {
+            (void)arg;
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "stuck");
+            return NULL;
+        }
+
+        /* Log calls keep returning while an output hangs, and the output comes back afterwards */
+        int test_output_watchdog(void) {
+            pthread_t worker;
+            log_stats_t stats;
+            
+            logger_init();
+            logger_set_level(LOG_LEVEL_TRACE);
+            logger_set_lock(test_thread_lock, NULL);
+            logger_remove_output(logger_find_output(logger_console_output, stderr));
+            logger_add_custom_output(hang_output, NULL, LOG_LEVEL_TRACE);
+            logger_add_custom_output(fallback_output, NULL, LOG_LEVEL_ERROR);
+            int hang = logger_find_output(hang_output, NULL);
+            int fallback = logger_find_output(fallback_output, NULL);
+            TEST_ASSERT(logger_set_output_watchdog(50, 1000) == -1);
+            TEST_ASSERT(logger_set_output_watchdog(50, fallback) == 0);
+            
+            hang_armed = true;
+            hang_entered = hang_release = false;
+            TEST_ASSERT(pthread_create(&worker, NULL, hang_worker, NULL) == 0);
+            for (int i = 0; i < 2000 && !logger_output_degraded(hang); i++) {
+                usleep(1000);
+            }
+            TEST_ASSERT(hang_entered && logger_output_degraded(hang));
+            
+            /* The worker holds the lock, yet this returns through the fallback */
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "while hung");
+            TEST_ASSERT(strcmp(fallback_text, "while hung") == 0);
+            logger_flush();
+            
+            hang_release = true;
+            pthread_join(worker, NULL);
+            for (int i = 0; i < 3000 && logger_output_degraded(hang); i++) {
+                usleep(1000);
+            }
+            TEST_ASSERT(!logger_output_degraded(hang));
+            int calls = hang_calls;
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "recovered line");
+            TEST_ASSERT(hang_calls > calls);
+            
+            logger_get_stats(&stats);
+            TEST_ASSERT(stats.records_rerouted >= 1);
+            logger_cleanup();
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── SHARD TESTS ────────────────────────────┐
+
+        #define SHARD_TEST_THREADS 4
+        #define SHARD_TEST_LINES 200
+
+        static void *shard_worker(void *arg) {
+            *(int*)arg = logger_thread_id();
+            for (int i = 0; i < SHARD_TEST_LINES; i++) {
+                logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "shard line %d", i);
+            }
+            return NULL;
+        }
+
+        /* Every thread gets its own file, and sequence numbers order all of them */
+        int test_shard_output(void) {
+            const char *base = "test_shard.log";
+            pthread_t threads[SHARD_TEST_THREADS];
+            int tids[SHARD_TEST_THREADS + 1];
+            char path[64];
+            char line[512];
+            uint64_t low = UINT64_MAX, high = 0, total = 0;
+            
+            context_setup();
+            TEST_ASSERT(logger_set_shard_output(base, LOG_LEVEL_INFO) == 0);
+            for (int i = 0; i < SHARD_TEST_THREADS; i++) {
+                TEST_ASSERT(pthread_create(&threads[i], NULL, shard_worker, &tids[i]) == 0);
+            }
+            for (int i = 0; i < SHARD_TEST_THREADS; i++) {
+                pthread_join(threads[i], NULL);
+            }
+            tids[SHARD_TEST_THREADS] = logger_thread_id();
+            logger_log(LOG_LEVEL_DEBUG, test_file, test_function, test_line, "below the shard level");
+            logger_log(LOG_LEVEL_WARN, test_file, test_function, test_line, "main line");
+            TEST_ASSERT(logger_set_shard_output(NULL, LOG_LEVEL_TRACE) == 0);
+            logger_log(LOG_LEVEL_WARN, test_file, test_function, test_line, "after shards");
+            logger_cleanup();
+            
+            for (int i = 0; i <= SHARD_TEST_THREADS; i++) {
+                log_shard_header_t header;
+                log_shard_record_t record;
+                uint64_t previous = 0;
+                int records = 0;
+                
+                snprintf(path, sizeof(path), "%s.%d", base, tids[i]);
+                FILE *file = fopen(path, "rb");
+                TEST_ASSERT(file != NULL);
+                TEST_ASSERT(fread(&header, sizeof(header), 1, file) == 1);
+                TEST_ASSERT(header.magic == LOGGER_SHARD_MAGIC && header.tid == tids[i]);
+                while (fread(&record, sizeof(record), 1, file) == 1) {
+                    TEST_ASSERT(record.length < sizeof(line));
+                    TEST_ASSERT(fread(line, 1, record.length, file) == record.length);
+                    line[record.length] = '\0';
+                    TEST_ASSERT(record.seq > previous);
+                    previous = record.seq;
+                    low = record.seq < low ? record.seq : low;
+                    high = record.seq > high ? record.seq : high;
+                    if (i < SHARD_TEST_THREADS) {
+                        snprintf(path, sizeof(path), " test_file.c:42: shard line %d\n", records);
+                    } else {
+                        snprintf(path, sizeof(path), " test_file.c:42: main line\n");
+                    }
+                    TEST_ASSERT(strstr(line, path) != NULL);
+                    records++;
+                }
+                fclose(file);
+                snprintf(path, sizeof(path), "%s.%d", base, tids[i]);
+                remove(path);
+                TEST_ASSERT(records == (i < SHARD_TEST_THREADS ? SHARD_TEST_LINES : 1));
+                total += (uint64_t)records;
+            }
+            
+            /* No two records share a sequence number */
+            TEST_ASSERT(total == SHARD_TEST_THREADS * SHARD_TEST_LINES + 1);
+            TEST_ASSERT(high - low + 1 == total);
+            return 1;
+        }
+
+        /* A batch committed with shards on goes to the committing thread's shard */
+        int test_shard_batch(void) {
+            const char *base = "test_shard_batch.log";
+            log_shard_header_t header;
+            log_shard_record_t record;
+            log_batch_t batch;
+            char path[64];
+            char line[512];
+            int records = 0;
+            
+            context_setup();
+            TEST_ASSERT(logger_set_shard_output(base, LOG_LEVEL_INFO) == 0);
+            logger_batch_begin(&batch);
+            log_batch(&batch, LOG_LEVEL_INFO, "batch line %d", 0);
+            log_batch(&batch, LOG_LEVEL_DEBUG, "below the shard level");
+            log_batch(&batch, LOG_LEVEL_WARN, "batch line %d", 1);
+            TEST_ASSERT(logger_batch_commit(&batch) == 2);
+            TEST_ASSERT(logger_set_shard_output(NULL, LOG_LEVEL_TRACE) == 0);
+            logger_cleanup();
+            
+            snprintf(path, sizeof(path), "%s.%d", base, logger_thread_id());
+            FILE *file = fopen(path, "rb");
+            TEST_ASSERT(file != NULL);
+            TEST_ASSERT(fread(&header, sizeof(header), 1, file) == 1);
+            TEST_ASSERT(header.magic == LOGGER_SHARD_MAGIC);
+            while (fread(&record, sizeof(record), 1, file) == 1) {
+                TEST_ASSERT(record.length < sizeof(line));
+                TEST_ASSERT(fread(line, 1, record.length, file) == record.length);
+                line[record.length] = '\0';
+                snprintf(path, sizeof(path), ": batch line %d\n", records);
+                TEST_ASSERT(strstr(line, path) != NULL);
+                records++;
+            }
+            fclose(file);
+            snprintf(path, sizeof(path), "%s.%d", base, logger_thread_id());
+            remove(path);
+            TEST_ASSERT(records == 2);
+            return 1;
+        }
+
+        /* Count a shard's records, checking its header and the text of each line */
+        static int shard_records(const char *path, uint64_t *run, const char *text) {
+            log_shard_header_t header;
+            log_shard_record_t record;
+            char line[512];
+            int records = 0;
+            
+            FILE *file = fopen(path, "rb");
+            if (!file || fread(&header, sizeof(header), 1, file) != 1 || header.magic != LOGGER_SHARD_MAGIC) {
+                if (file) fclose(file);
+                return -1;
+            }
+            while (fread(&record, sizeof(record), 1, file) == 1 && record.length < sizeof(line) &&
+                   fread(line, 1, record.length, file) == record.length) {
+                line[record.length] = '\0';
+                records += strstr(line, text) != NULL;
+            }
+            fclose(file);
+            *run = header.run;
+            return records;
+        }
+
+        /* A shard left by an earlier run with the same tid is replaced; the same run appends */
+        int test_shard_stale_run(void) {
+            const char *base = "test_shard_stale.log";
+            char path[64];
+            uint64_t run = 0;
+            
+            snprintf(path, sizeof(path), "%s.%d", base, logger_thread_id());
+            FILE *file = fopen(path, "wb");
+            TEST_ASSERT(file != NULL);
+            log_shard_header_t stale = { LOGGER_SHARD_MAGIC, logger_thread_id(), 1 };
+            log_shard_record_t record = { .timestamp_ns = 1, .seq = 1, .length = 6 };
+            fwrite(&stale, sizeof(stale), 1, file);
+            fwrite(&record, sizeof(record), 1, file);
+            fwrite("stale\n", 1, 6, file);
+            fclose(file);
+            
+            context_setup();
+            TEST_ASSERT(logger_set_shard_output(base, LOG_LEVEL_INFO) == 0);
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "fresh line");
+            TEST_ASSERT(logger_set_shard_output(NULL, LOG_LEVEL_TRACE) == 0);
+            TEST_ASSERT(shard_records(path, &run, "stale") == 0);
+            TEST_ASSERT(shard_records(path, &run, "fresh line") == 1);
+            TEST_ASSERT(run != 1);
+            
+            TEST_ASSERT(logger_set_shard_output(base, LOG_LEVEL_INFO) == 0);
+            logger_log(LOG_LEVEL_INFO, test_file, test_function, test_line, "fresh line");
+            TEST_ASSERT(logger_set_shard_output(NULL, LOG_LEVEL_TRACE) == 0);
+            logger_cleanup();
+            TEST_ASSERT(shard_records(path, &run, "fresh line") == 2);
+            remove(path);
+            return 1;
+        }
+
+        /* Shards allocate per thread, so they refuse a memory budget and the budget refuses them */
+        int test_shard_memory_budget(void) {
+            char path[64];
+            context_setup();
+            TEST_ASSERT(logger_set_memory_budget(256 * 1024) == 0);
+            TEST_ASSERT(logger_set_shard_output("test_shard_budget.log", LOG_LEVEL_INFO) == -1);
+            TEST_ASSERT(logger_set_shard_output(NULL, LOG_LEVEL_INFO) == 0);
+            TEST_ASSERT(logger_set_memory_budget(0) == 0);
+            
+            TEST_ASSERT(logger_set_shard_output("test_shard_budget.log", LOG_LEVEL_INFO) == 0);
+            TEST_ASSERT(logger_set_memory_budget(256 * 1024) == -1);
+            TEST_ASSERT(logger_set_shard_output(NULL, LOG_LEVEL_INFO) == 0);
+            TEST_ASSERT(logger_set_memory_budget(256 * 1024) == 0);
+            TEST_ASSERT(logger_set_memory_budget(0) == 0);
+            logger_cleanup();
+            
+            snprintf(path, sizeof(path), "test_shard_budget.log.%d", logger_thread_id());
+            remove(path);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── CONTROL SOCKET TESTS ────────────────────────────┐
+
+        /* Send one command and read the whole reply */
+        static int control_request(const char *path, const char *command, char *reply, size_t size) {
+            struct sockaddr_un addr = { .sun_family = AF_UNIX };
+            size_t used = 0;
+            ssize_t n;
+            
+            snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+                write(fd, command, strlen(command)) != (ssize_t)strlen(command)) {
+                if (fd >= 0) close(fd);
+                return -1;
+            }
+            while (used < size - 1 && (n = read(fd, reply + used, size - 1 - used)) > 0) {
+                used += (size_t)n;
+            }
+            reply[used] = '\0';
+            close(fd);
+            return 0;
+        }
+
+        /* Levels, call sites and stats change and read back through the socket */
+        int test_control_socket(void) {
+            char path[64];
+            char reply[2048];
+            snprintf(path, sizeof(path), "/tmp/loggin_ctl_%d.sock", (int)getpid());
+            
+            context_setup();
+            logger_set_level(LOG_LEVEL_INFO);
+            TEST_ASSERT(logger_serve_control(path) == 0);
+            TEST_ASSERT(logger_serve_control(path) == -1);
+            
+            TEST_ASSERT(control_request(path, "level DEBUG\n", reply, sizeof(reply)) == 0);
+            TEST_ASSERT(strcmp(reply, "ok\n") == 0 && logger_get_level() == LOG_LEVEL_DEBUG);
+            TEST_ASSERT(control_request(path, "level LOUD\n", reply, sizeof(reply)) == 0);
+            TEST_ASSERT(strncmp(reply, "error: ", 7) == 0 && logger_get_level() == LOG_LEVEL_DEBUG);
+            TEST_ASSERT(control_request(path, "level INFO\n", reply, sizeof(reply)) == 0);
+            
+            /* A site logs below the level; other lines of the file do not */
+            TEST_ASSERT(control_request(path, "site on src/test_file.c:42\n", reply, sizeof(reply)) == 0);
+            TEST_ASSERT(strcmp(reply, "ok\n") == 0);
+            context_event.fmt = NULL;
+            logger_log(LOG_LEVEL_DEBUG, "/build/src/test_file.c", test_function, test_line, "site on");
+            TEST_ASSERT(context_event.fmt != NULL && strcmp(context_event.fmt, "site on") == 0);
+            context_event.fmt = NULL;
+            logger_log(LOG_LEVEL_DEBUG, "/build/src/test_file.c", test_function, 43, "other line");
+            logger_log(LOG_LEVEL_DEBUG, "/build/src/my_test_file.c", test_function, test_line, "other file");
+            TEST_ASSERT(context_event.fmt == NULL);
+            
+            TEST_ASSERT(control_request(path, "sites\n", reply, sizeof(reply)) == 0);
+            TEST_ASSERT(strcmp(reply, "ok\nsrc/test_file.c:42\n") == 0);
+            TEST_ASSERT(control_request(path, "site off src/test_file.c:42\n", reply, sizeof(reply)) == 0);
+            logger_log(LOG_LEVEL_DEBUG, "/build/src/test_file.c", test_function, test_line, "site off");
+            TEST_ASSERT(context_event.fmt == NULL);
+            TEST_ASSERT(control_request(path, "site off src/test_file.c:42\n", reply, sizeof(reply)) == 0);
+            TEST_ASSERT(strncmp(reply, "error: ", 7) == 0);
+            
+            TEST_ASSERT(control_request(path, "outputs\n", reply, sizeof(reply)) == 0);
+            TEST_ASSERT(strcmp(reply, "ok\n0 custom TRACE\n") == 0);
+            TEST_ASSERT(control_request(path, "stats\n", reply, sizeof(reply)) == 0);
+            TEST_ASSERT(strncmp(reply, "ok\nlevel INFO\n", 14) == 0 && strstr(reply, "\nrecords_dropped ") != NULL);
+            
+            logger_cleanup();
+            TEST_ASSERT(access(path, F_OK) != 0);
+            TEST_ASSERT(logger_set_site_enabled("", 0, true) == -1);
+            return 1;
+        }
+
+        /* Category statements honour an enabled site below their category level */
+        int test_site_enabled_category(void) {
+            log_category_t *net = logger_category("site.net");
+            context_setup();
+            logger_set_category_level("site.net", LOG_LEVEL_WARN);
+            context_event.fmt = NULL;
+            
+            int line = __LINE__ + 2;
+            for (int i = 0; i < 2; i++) {
+                log_cat_debug(net, i ? "site on" : "site off");
+                if (i == 0) {
+                    TEST_ASSERT(context_event.fmt == NULL);
+                    TEST_ASSERT(logger_set_site_enabled(__FILE__, line, true) == 0);
+                }
+            }
+            TEST_ASSERT(context_event.fmt != NULL && strcmp(context_event.fmt, "site on") == 0);
+            TEST_ASSERT(strcmp(context_event.category, "site.net") == 0);
+            
+            context_event.fmt = NULL;
+            log_cat_debug(net, "other line");
+            TEST_ASSERT(context_event.fmt == NULL);
+            TEST_ASSERT(logger_set_site_enabled(__FILE__, line, false) == 0);
+            logger_cleanup();
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── GREP TOOL TESTS ────────────────────────────┐
+
+        #ifndef LOGGIN_TOOLS_DIR
+            #define LOGGIN_TOOLS_DIR "build"
+        #endif
+
+        /* Enough lines for loggin-grep to split the file across threads */
+        #define GREP_TEST_LINES 80000
+
+        /* Run loggin-grep on a file and read everything it prints */
+        static int run_grep(const char *args, const char *path, char *out, size_t size) {
+            char command[512];
+            size_t used = 0;
+            size_t n;
+            snprintf(command, sizeof(command), "%s/loggin-grep %s %s", LOGGIN_TOOLS_DIR, args, path);
+            FILE *pipe = popen(command, "r");
+            if (!pipe) {
+                return -1;
+            }
+            while (used < size - 1 && (n = fread(out + used, 1, size - 1 - used, pipe)) > 0) {
+                used += n;
+            }
+            out[used] = '\0';
+            int status = pclose(pipe);
+            return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        }
+
+        /* Level, time prefix and substring filters agree with a plain scan, in file order */
+        int test_grep_tool(void) {
+            const char *path = "test_grep.log";
+            static const char *levels[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL" };
+            size_t size = (size_t)GREP_TEST_LINES * 64;
+            char *expected = malloc(size);
+            char *out = malloc(size);
+            char line[128];
+            size_t expected_len = 0;
+            int expected_count = 0;
+            FILE *file = fopen(path, "w");
+            TEST_ASSERT(file && expected && out);
+            
+            for (int i = 0; i < GREP_TEST_LINES; i++) {
+                int level = i % 6;
+                int minute = i / (GREP_TEST_LINES / 20);
+                int len = snprintf(line, sizeof(line), "2024-01-15 14:%02d:%02d %-5s app.c:%d: request %d%s\n",
+                                   minute, i % 60, levels[level], 10 + level, i, i % 7 == 0 ? " disk full" : "");
+                fputs(line, file);
+                if (level >= LOG_LEVEL_WARN && minute < 10 && i % 7 == 0) {
+                    memcpy(expected + expected_len, line, (size_t)len);
+                    expected_len += (size_t)len;
+                    expected_count++;
+                }
+            }
+            /* A last line shorter than a timestamp, without a newline */
+            fputs("2024-01-15 14:0", file);
+            fclose(file);
+            expected[expected_len] = '\0';
+            
+            const char *filters = "--min-level WARN --time \"2024-01-15 14:0\" -e disk";
+            char args[128];
+            snprintf(args, sizeof(args), "%s -j 4", filters);
+            TEST_ASSERT(run_grep(args, path, out, size) == 0);
+            TEST_ASSERT(strcmp(out, expected) == 0);
+            
+            snprintf(args, sizeof(args), "-c %s -j 1", filters);
+            TEST_ASSERT(run_grep(args, path, out, size) == 0);
+            TEST_ASSERT(atoi(out) == expected_count);
+            
+            TEST_ASSERT(run_grep("-c --level FATAL -e \"request 1 \"", path, out, size) == 1);
+            TEST_ASSERT(run_grep("--time \"2024-01-15 14:00:00 TRACE\"", path, out, size) == 2);
+            
+            free(expected);
+            free(out);
+            remove(path);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── MAIN TEST RUNNER ────────────────────────────┐
+
+        int main(void) {
+            printf("🧪 Running Logger Test Suite\n");
+            printf("============================\n\n");
+            
+            // Initialize tests
+            tests_run = 0;
+            tests_passed = 0;
+            tests_failed = 0;
+            
+            // Run all tests
+            RUN_TEST(test_logger_init_cleanup);
+            RUN_TEST(test_multiple_init_calls);
+            
+            RUN_TEST(test_logger_set_level);
+            RUN_TEST(test_logger_set_quiet);
+            RUN_TEST(test_logger_set_colors);
+            RUN_TEST(test_logger_set_show_file_line);
+            RUN_TEST(test_logger_set_show_function);
+            RUN_TEST(test_logger_set_lock);
+            
+            RUN_TEST(test_logger_add_console_output);
+            RUN_TEST(test_logger_add_file_output);
+            RUN_TEST(test_logger_add_file_output_invalid);
+            RUN_TEST(test_logger_add_custom_output);
+            RUN_TEST(test_logger_add_custom_output_invalid);
+            
+            RUN_TEST(test_logger_level_to_string);
+            RUN_TEST(test_logger_string_to_level);
+            
+            RUN_TEST(test_logger_log_basic);
+            RUN_TEST(test_logger_log_with_format);
+            RUN_TEST(test_logger_log_level_filtering);
+            
+            RUN_TEST(test_log_trace_macro);
+            RUN_TEST(test_log_info_macro);
+            RUN_TEST(test_log_error_macro);
+            
+            RUN_TEST(test_thread_safety);
+            
+            RUN_TEST(test_empty_message);
+            RUN_TEST(test_null_file_name);
+            
+            RUN_TEST(test_coalesce_repeats);
+            RUN_TEST(test_coalesce_flush);
+            RUN_TEST(test_coalesce_expiry);
+            RUN_TEST(test_coalesce_output_opt_out);
+            
+            RUN_TEST(test_category_inherits_parent);
+            RUN_TEST(test_category_cache_invalidation);
+            
+            RUN_TEST(test_load_config);
+            RUN_TEST(test_load_config_invalid_keeps_previous);
+            RUN_TEST(test_load_config_slots);
+            RUN_TEST(test_watch_config_reload);
+            
+            RUN_TEST(test_memory_budget_no_malloc);
+            RUN_TEST(test_memory_budget_change_keeps_streams);
+            
+            RUN_TEST(test_batch_commit);
+            RUN_TEST(test_batch_not_interleaved);
+            RUN_TEST(test_batch_bounded_drop);
+            
+            RUN_TEST(test_span_report);
+            RUN_TEST(test_span_interval);
+            RUN_TEST(test_span_trace);
+            
+            RUN_TEST(test_tsc_clock);
+            
+            RUN_TEST(test_context_fields);
+            RUN_TEST(test_context_per_thread);
+            RUN_TEST(test_context_file_output);
+            RUN_TEST(test_json_output);
+            RUN_TEST(test_hexdump_layout);
+            RUN_TEST(test_hexdump_disabled);
+            RUN_TEST(test_hexdump_limit);
+            RUN_TEST(test_tcp_reconnect_spool);
+            RUN_TEST(test_tcp_length_framing);
+            RUN_TEST(test_profile_top);
+            RUN_TEST(test_profile_report);
+            RUN_TEST(test_async_priority_lanes);
+            RUN_TEST(test_async_context_and_fatal);
+            RUN_TEST(test_async_format_workers);
+            RUN_TEST(test_async_format_workers_budget);
+            RUN_TEST(test_async_long_messages);
+            RUN_TEST(test_async_batch_order);
+            RUN_TEST(test_metric_report);
+            RUN_TEST(test_metric_interval);
+            RUN_TEST(test_rate_throttle);
+            RUN_TEST(test_output_pattern);
+            RUN_TEST(test_output_pattern_invalid);
+            RUN_TEST(test_output_filters);
+            RUN_TEST(test_output_filter_invalid);
+            RUN_TEST(test_shard_output);
+            RUN_TEST(test_shard_batch);
+            RUN_TEST(test_shard_stale_run);
+            RUN_TEST(test_shard_memory_budget);
+            RUN_TEST(test_output_watchdog);
+            RUN_TEST(test_control_socket);
+            RUN_TEST(test_site_enabled_category);
+            RUN_TEST(test_grep_tool);
+            RUN_TEST(test_ring_survives_kill);
+            RUN_TEST(test_lz_round_trip);
+            RUN_TEST(test_compressed_output);
+            
+            RUN_TEST(test_file_index);
             
             // Print results
             printf("\n============================\n");
@@ -0,0 +1,220 @@
+// logger.test.cpp — Test Suite for the C++ Front End
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#include "../loggin.hpp"
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Last message seen by the capture output */
+    static char captured_output[2048];
+    static int captured_count = 0;
+
+    /* Test counters */
+    static int tests_run = 0;
+    static int tests_passed = 0;
+    static int tests_failed = 0;
+
+    /* Plans are built by the compiler, so their shape can be asserted at compile time */
+    using loggin::detail::compile;
+    using loggin::detail::count_segments;
+    using loggin::detail::type_list;
+
+    static_assert(compile<count_segments("id=%d")>("id=%d", type_list<int>{}).count == 2);
+    static_assert(compile<count_segments("%s took %.2f ms")>("%s took %.2f ms", type_list<const char*, double>{}).count == 4);
+    static_assert(compile<count_segments("100%% done")>("100%% done", type_list<>{}).count == 2);
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── TEST UTILITIES ────────────────────────────┐
+
+        static void test_output_capture(log_event_t *event) {
+            vsnprintf(captured_output, sizeof(captured_output), event->fmt, event->ap);
+            captured_count++;
+        }
+
+        static void setup(log_level_t level) {
+            logger_cleanup();
+            logger_init();
+            logger_set_quiet(false);
+            logger_set_level(level);
+            logger_add_custom_output(test_output_capture, nullptr, LOG_LEVEL_TRACE);
+            captured_output[0] = '\0';
+            captured_count = 0;
+        }
+
+        /* Test runner macro */
+        #define RUN_TEST(test_name) do { \
+            printf("Running test: %s... ", #test_name); \
+            tests_run++; \
+            if (test_name()) { \
+                printf("✅ PASSED\n"); \
+                tests_passed++; \
+            } else { \
+                printf("❌ FAILED\n"); \
+                tests_failed++; \
+            } \
+        } while(0)
+
+        /* Test assertion macro */
+        #define TEST_ASSERT(condition) do { \
+            if (!(condition)) { \
+                printf("Assertion failed: %s\n", #condition); \
+                return 0; \
+            } \
+        } while(0)
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── FORMAT TESTS ────────────────────────────┐
+
+        /* Every conversion renders exactly like printf would */
+        int test_cpp_matches_printf(void) {
+            char expected[256];
+            std::string name = "svc";
+            const char *missing = nullptr;
+            setup(LOG_LEVEL_TRACE);
+
+            LOG_INFO("%d %i %u %ld %zu %x %X %o %c", -42, 7, 7u, 123456789012L, (size_t)9, -1, 255, 8, 'Q');
+            snprintf(expected, sizeof(expected), "%d %i %u %ld %zu %x %X %o %c", -42, 7, 7u, 123456789012L, (size_t)9, -1, 255, 8, 'Q');
+            TEST_ASSERT(strcmp(captured_output, expected) == 0);
+
+            LOG_INFO("[%5d] [%-5d] [%05d] [%+d] [%.3d] [%#x]", 42, 42, 42, 42, 7, 255);
+            snprintf(expected, sizeof(expected), "[%5d] [%-5d] [%05d] [%+d] [%.3d] [%#x]", 42, 42, 42, 42, 7, 255);
+            TEST_ASSERT(strcmp(captured_output, expected) == 0);
+
+            LOG_INFO("%f %.2f %8.3e %g", 3.14159, 2.5, 12345.678, 0.0001);
+            snprintf(expected, sizeof(expected), "%f %.2f %8.3e %g", 3.14159, 2.5, 12345.678, 0.0001);
+            TEST_ASSERT(strcmp(captured_output, expected) == 0);
+
+            LOG_INFO("%s|%-6s|%6s|%.2s|%s|%s %%", name, "ab", "ab", "xyz", std::string_view("view"), missing);
+            TEST_ASSERT(strcmp(captured_output, "svc|ab    |    ab|xy|view|(null) %") == 0);
+            return 1;
+        }
+
+        /* Arguments of disabled statements are never evaluated */
+        int test_cpp_disabled_skips_arguments(void) {
+            int evaluated = 0;
+            setup(LOG_LEVEL_WARN);
+
+            LOG_DEBUG("value %d", ++evaluated);
+            TEST_ASSERT(evaluated == 0);
+            TEST_ASSERT(captured_count == 0);
+
+            LOG_ERROR("value %d", ++evaluated);
+            TEST_ASSERT(evaluated == 1);
+            TEST_ASSERT(strcmp(captured_output, "value 1") == 0);
+            return 1;
+        }
+
+        /* Category statements use the category's level, not the global one */
+        int test_cpp_category(void) {
+            setup(LOG_LEVEL_ERROR);
+            log_category_t *net = logger_category("net");
+            logger_set_category_level("net", LOG_LEVEL_DEBUG);
+
+            LOG_CAT_DEBUG(net, "connected to %s:%u", "db", 5432u);
+            TEST_ASSERT(captured_count == 1);
+            TEST_ASSERT(strcmp(captured_output, "connected to db:5432") == 0);
+
+            LOG_CAT_TRACE(net, "dropped");
+            TEST_ASSERT(captured_count == 1);
+            logger_cleanup();
+            return 1;
+        }
+
+        /* Both statements share one line, so a single site covers them */
+        static const int site_line = __LINE__ + 2;
+        static void site_statements(log_category_t *net, int i) {
+            LOG_DEBUG("plain %d", i); LOG_CAT_DEBUG(net, "category %d", i);
+        }
+
+        /* An enabled site logs below the global and the category level */
+        int test_cpp_site_enabled(void) {
+            setup(LOG_LEVEL_WARN);
+            log_category_t *net = logger_category("net");
+            logger_set_category_level("net", LOG_LEVEL_ERROR);
+
+            site_statements(net, 0);
+            TEST_ASSERT(captured_count == 0);
+
+            TEST_ASSERT(logger_set_site_enabled(__FILE__, site_line, true) == 0);
+            TEST_ASSERT(loggin::enabled(nullptr, LOG_LEVEL_DEBUG, __FILE__, site_line));
+            TEST_ASSERT(!loggin::enabled(nullptr, LOG_LEVEL_DEBUG));
+            site_statements(net, 1);
+            TEST_ASSERT(captured_count == 2);
+            TEST_ASSERT(strcmp(captured_output, "category 1") == 0);
+            LOG_DEBUG("other line");
+            TEST_ASSERT(captured_count == 2);
+
+            TEST_ASSERT(logger_set_site_enabled(__FILE__, site_line, false) == 0);
+            site_statements(net, 2);
+            TEST_ASSERT(captured_count == 2);
+            logger_cleanup();
+            return 1;
+        }
+
+        /* Long messages are cut at the same length as the C path */
+        int test_cpp_truncation(void) {
+            std::string big(3000, 'x');
+            setup(LOG_LEVEL_TRACE);
+
+            LOG_INFO("%s%s", big, big);
+            TEST_ASSERT(strlen(captured_output) == loggin::detail::message_capacity - 1);
+            return 1;
+        }
+
+        /* The RAII span records on scope exit like the C macro */
+        int test_cpp_span(void) {
+            setup(LOG_LEVEL_INFO);
+            for (int i = 0; i < 3; i++) {
+                LOG_SPAN("cpp.span");
+            }
+            logger_span_report();
+            TEST_ASSERT(strstr(captured_output, "span cpp.span: n=3 ") != nullptr);
+            return 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── MAIN TEST RUNNER ────────────────────────────┐
+
+        int main(void) {
+            printf("🧪 Running C++ Front End Test Suite\n");
+            printf("===================================\n\n");
+
+            RUN_TEST(test_cpp_matches_printf);
+            RUN_TEST(test_cpp_disabled_skips_arguments);
+            RUN_TEST(test_cpp_category);
+            RUN_TEST(test_cpp_site_enabled);
+            RUN_TEST(test_cpp_truncation);
+            RUN_TEST(test_cpp_span);
+            logger_cleanup();
+
+            printf("\n===================================\n");
+            printf("📊 Test Results:\n");
+            printf("   Total:  %d\n", tests_run);
+            printf("   Passed: %d ✅\n", tests_passed);
+            printf("   Failed: %d ❌\n", tests_failed);
+
+            if (tests_failed == 0) {
+                printf("\n🎉 All tests passed!\n");
+                return 0;
+            } else {
+                printf("\n💥 Some tests failed!\n");
+                return 1;
+            }
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
@@ -6,30 +6,677 @@
 //
 // Developed with ❤️ by Sebastian Rivera.
 
+#define _GNU_SOURCE
+
 #include "../loggin.h"
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio_ext.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+
+#if defined(__x86_64__)
+    #include <cpuid.h>
+#endif
+
+#if defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
 
 // ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
 
     #define MAX_OUTPUTS 16
+    #define MAX_COALESCE_SITES 256
+    #define MAX_MESSAGE_LEN 1024
+    #define MAX_CATEGORIES 64
+    #define MAX_CONFIG_ERROR 256
+    #define LOGGER_RECORD_SIZE 1024
+    #define LOGGER_STREAM_BUFFER_SIZE 4096
+    #define DEFAULT_MEMORY_BUDGET (1u << 20)
+    #define LOGGER_FRAME_SIZE (64u << 10)
+    #define MAX_SPAN_SITES 64
+    #define SPAN_BUCKETS 252
+    #define TSC_CALIBRATION_NS 1000000000
+    #define DEFAULT_HEXDUMP_LIMIT 4096
+    #define HEXDUMP_LINE_LEN 78
+    #define HEXDUMP_STACK_LINES 64
+    #define PROFILE_SITES 1024
+    #define PROFILE_PROBES 16
+    #define PROFILE_MERGE_SITES 4096
+    #define MAX_METRICS 128
+    #define THROTTLE_CHECK_MS 250
+    #define COALESCE_SWEEPS 4
+    #define ASYNC_CHUNK 64
+    #define ASYNC_LANE_LIMIT 4096
+    #define BOUNDED_THREAD_BLOCKS 32
+    #define MAX_FORMAT_WORKERS 16
+    #define FORMAT_CHUNK_TEXT (ASYNC_CHUNK * LOGGER_RECORD_SIZE)
+    #define TCP_BATCH_MS 20
+    #define TCP_BACKOFF_MIN_MS 100
+    #define TCP_BACKOFF_MAX_MS 10000
+    #define TCP_TIMEOUT_MS 2000
+    #define MAX_CONTEXT_LEN (LOGGER_CONTEXT_MAX * (LOGGER_CONTEXT_KEY_MAX + LOGGER_CONTEXT_VALUE_MAX) + 64)
+    #define LAYOUT_MAX_OPS 48
+    #define LAYOUT_SITES 256
+    #define LAYOUT_SITE_TEXT 112
+    #define LAYOUT_LINE_MAX 4096
+    #define MAX_OUTPUT_FILTERS 16
+    #define FILTER_CACHE_SIZE 256
+    #define WATCHDOG_PROBE_MS 1000
+    #define MAX_CONTROL_SITES 32
+    #define CONTROL_SITE_FILE_MAX 128
+    #define CONTROL_REQUEST_MAX 512
+    #define CONTROL_REPLY_MAX 8192
+
+    /* Sparse time/level index kept next to a file output */
+    typedef struct {
+        FILE *index;
+        uint64_t offset;
+        log_index_entry_t block;
+        unsigned every;
+    } file_index_t;
+
+    /* Operations of a compiled output pattern */
+    typedef enum {
+        LAYOUT_TEXT,
+        LAYOUT_TIME,
+        LAYOUT_MILLIS,
+        LAYOUT_MICROS,
+        LAYOUT_LEVEL,
+        LAYOUT_FILE,
+        LAYOUT_LINE,
+        LAYOUT_FUNCTION,
+        LAYOUT_CATEGORY,
+        LAYOUT_THREAD_ID,
+        LAYOUT_THREAD_NAME,
+        LAYOUT_CONTEXT,
+        LAYOUT_COLOR,
+        LAYOUT_RESET,
+        LAYOUT_MESSAGE,
+        LAYOUT_SITE
+    } layout_op_kind_t;
+
+    /* One step of a compiled pattern; a SITE step covers the `count` call-site steps after it */
+    typedef struct {
+        layout_op_kind_t kind;
+        const char *text;
+        size_t length;
+        int width;
+        bool left;
+        int count;
+        int64_t cached_second;
+        char cached[64];
+        size_t cached_length;
+    } layout_op_t;
+
+    /* Call-site part of a line, rendered once per file and line */
+    typedef struct {
+        const char *file;
+        int line;
+        uint16_t length;
+        char text[LAYOUT_SITE_TEXT];
+    } layout_site_t;
+
+    /* Output pattern compiled into a flat list of steps */
+    typedef struct {
+        layout_op_t ops[LAYOUT_MAX_OPS];
+        int op_count;
+        char *text;
+        layout_site_t sites[LAYOUT_SITES];
+    } output_layout_t;
+
+    /* Drop rule of an output; an event is dropped when every term that is set matches */
+    typedef struct {
+        char *spec;                 /* Owns the strings below */
+        const char *file;
+        const char *function;
+        const char *format_prefix;
+        const char *format_substring;
+        const char *text_substring;
+        size_t format_prefix_len;
+        int level_min;
+        int level_max;
+    } filter_rule_t;
+
+    /* Rules whose level, file, function and format terms matched one call site */
+    typedef struct {
+        const char *fmt;
+        const char *file;
+        const char *function;
+        int line;
+        int level;
+        uint32_t matched;
+    } filter_verdict_t;
+
+    /* Compiled filter stage of an output with its per-call-site verdicts */
+    typedef struct {
+        filter_rule_t rules[MAX_OUTPUT_FILTERS];
+        int count;
+        uint32_t text_rules;
+        filter_verdict_t verdicts[FILTER_CACHE_SIZE];
+    } output_filter_t;
 
     /* Output handler structure */
     typedef struct {
         log_output_fn_t output_fn;
         void *user_data;
+        file_index_t *index;
+        output_layout_t *layout;
+        output_filter_t *filter;
         log_level_t min_level;
         bool active;
+        bool no_coalesce;
+        bool degraded;
+        bool arena_buffer;          /* Stream buffer lives in the record pool arena */
     } output_handler_t;
 
+    /* Repeat tracking for one call site */
+    typedef struct {
+        const char *file;
+        const char *function;
+        uint64_t hash;
+        uint64_t run_start_ms;
+        unsigned repeats;
+        int line;
+        log_level_t level;
+        bool used;
+    } coalesce_site_t;
+
+    /* Captured log record, stored in a fixed-size pool slot */
+    typedef struct log_record {
+        struct log_record *next;
+        uint64_t sequence;
+        int64_t timestamp_ns;
+        const char *format;
+        const char *file;
+        const char *function;
+        const char *category;
+        uint32_t pool_next;
+        uint32_t length;
+        int line;
+        log_level_t level;
+        int thread_id;
+        int context_count;
+        char thread_name[LOGGER_THREAD_NAME_MAX];
+        char message[];             /* Followed by context as key\0value\0 pairs */
+    } log_record_t;
+
+    #define LOGGER_RECORD_CAPACITY (LOGGER_RECORD_SIZE - offsetof(log_record_t, message))
+
+    /* A chunk of async records and the file-layout lines a format worker rendered for them */
+    typedef struct {
+        log_record_t *head;
+        uint32_t offset[ASYNC_CHUNK];
+        uint32_t length[ASYNC_CHUNK];   /* 0 when the line did not fit and is formatted at commit */
+        unsigned layout;                /* Layout flags the lines were rendered with */
+        bool ready;
+        char text[FORMAT_CHUNK_TEXT];
+    } format_chunk_t;
+
+    /* Preallocated record slots and stream buffers */
+    static struct {
+        unsigned char *arena;
+        size_t arena_size;
+        unsigned char *records;
+        uint32_t record_count;
+        uint64_t free_head;
+        uint32_t in_use;
+        uint64_t dropped;
+        uint64_t truncated;
+        uint32_t chunk_slots;   /* Record slots lent to the format chunk ring */
+        bool bounded;
+    } record_pool = {0};
+
+    /* Raw frame waiting for, or being filled before, compression */
+    typedef struct {
+        unsigned char *data;
+        uint32_t size;
+        uint32_t count;
+        int64_t first_ns;
+        int64_t last_ns;
+    } frame_buffer_t;
+
+    /* Double-buffered compressed file output */
+    typedef struct {
+        FILE *file;
+        pthread_t thread;
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        frame_buffer_t frames[2];
+        int active;
+        int sealed;
+        bool stop;
+    } compressed_sink_t;
+
+    /* Outgoing bytes of a TCP output */
+    typedef struct {
+        char *data;
+        uint32_t size;
+        uint32_t count;
+    } tcp_buffer_t;
+
+    /* TCP stream output, spooling to disk while the collector is away */
+    typedef struct {
+        char host[256];
+        char port[16];
+        log_framing_t framing;
+        int fd;
+        int spool_fd;
+        size_t spool_size;
+        size_t spool_limit;
+        unsigned backoff_ms;
+        int64_t next_attempt_ns;
+        int64_t batch_deadline_ns;
+        pthread_t thread;
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        tcp_buffer_t buffers[2];
+        int active;
+        int sealed;
+        bool flush_requested;
+        bool stop;
+    } tcp_sink_t;
+
+    /* Crash ring output: a MAP_SHARED file of fixed-size slots */
+    typedef struct {
+        int fd;
+        unsigned char *map;
+        size_t map_size;
+        uint64_t slot_count;
+        uint64_t next_seq;
+    } ring_sink_t;
+
+    /* Output declared by a configuration file */
+    typedef struct {
+        char path[PATH_MAX];
+        FILE *file;
+        log_level_t level;
+        int slot;
+        bool json;
+    } config_output_t;
+
+    /* Immutable result of parsing a configuration file */
+    typedef struct {
+        unsigned set_mask;
+        log_level_t level;
+        bool quiet;
+        bool use_colors;
+        bool show_file_line;
+        bool show_function;
+        bool show_context;
+        unsigned coalesce_ms;
+        int category_count;
+        struct {
+            char name[LOGGER_CATEGORY_NAME_MAX];
+            log_level_t level;
+        } categories[MAX_CATEGORIES];
+        int output_count;
+        config_output_t outputs[MAX_OUTPUTS];
+    } config_snapshot_t;
+
+    /* Log-linear duration histogram of one span site on one thread, in clock ticks */
+    typedef struct {
+        uint64_t count;
+        uint64_t sum;
+        uint64_t buckets[SPAN_BUCKETS];
+    } span_histogram_t;
+
+    /* Per-thread span histograms, handed to a new thread once their owner exits */
+    typedef struct span_thread {
+        struct span_thread *next;
+        span_histogram_t *histograms[MAX_SPAN_SITES];
+        int tid;
+        bool owned;
+    } span_thread_t;
+
+    /* Events and bytes of one call site on one thread */
+    typedef struct {
+        const char *file;
+        const char *function;
+        int line;
+        log_level_t level;
+        uint64_t events;
+        uint64_t bytes;
+    } profile_site_t;
+
+    /* Per-thread call-site counters, handed to a new thread once their owner exits */
+    typedef struct profile_thread {
+        struct profile_thread *next;
+        profile_site_t sites[PROFILE_SITES];
+        uint64_t other_events;
+        uint64_t other_bytes;
+        unsigned epoch;
+        bool owned;
+    } profile_thread_t;
+
+    /* One metric on one thread; count and sum only grow, min and max restart every interval */
+    typedef struct {
+        uint64_t count;
+        double sum;
+        double min;
+        double max;
+        unsigned interval;
+    } metric_cell_t;
+
+    /* Per-thread log rate counters, handed to a new thread once their owner exits */
+    typedef struct rate_thread {
+        struct rate_thread *next;
+        uint64_t events;
+        uint64_t bytes;
+        uint64_t shed[LOG_LEVEL_ERROR];
+        bool owned;
+    } rate_thread_t;
+
+    /* Shard file of one thread, opened again when the shard generation changes */
+    typedef struct shard_thread {
+        struct shard_thread *next;
+        FILE *file;
+        unsigned generation;
+    } shard_thread_t;
+
+    /* Per-thread metric bank, handed to a new thread once its owner exits */
+    typedef struct metric_thread {
+        struct metric_thread *next;
+        metric_cell_t cells[MAX_METRICS];
+        bool owned;
+    } metric_thread_t;
+
     /* Global logger state */
     static struct {
         log_config_t config;
         output_handler_t outputs[MAX_OUTPUTS];
+        coalesce_site_t coalesce_sites[MAX_COALESCE_SITES];
+        unsigned coalesce_window_ms;
+        config_snapshot_t *file_config;
+        size_t hexdump_limit;
+        bool batching;
         bool initialized;
     } logger_state = {0};
 
+    /* Configuration file watcher */
+    static struct {
+        pthread_t thread;
+        char path[PATH_MAX];
+        char error[MAX_CONFIG_ERROR];
+        int wake_pipe[2];
+        bool running;
+    } config_watch = { .wake_pipe = { -1, -1 } };
+
+    /* Control socket server */
+    static struct {
+        pthread_t thread;
+        char path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+        int listen_fd;
+        int wake_pipe[2];
+        bool running;
+    } control_state = { .listen_fd = -1, .wake_pipe = { -1, -1 } };
+
+    /* Call sites enabled below the global level, published under a sequence counter */
+    static struct {
+        pthread_mutex_t mutex;
+        uint32_t seq;
+        int count;
+        struct {
+            char file[CONTROL_SITE_FILE_MAX];
+            int line;               /* 0 for every line of the file */
+        } sites[MAX_CONTROL_SITES];
+    } control_sites = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+    /* Category registry, kept across init/cleanup so handles stay valid */
+    static struct {
+        log_category_t categories[MAX_CATEGORIES];
+        int count;
+    } category_registry = {
+        .categories = {{ .name = "", .parent = -1, .level = -1 }},
+        .count = 1
+    };
+
+    /* Span sites, per-thread histograms and the trace file */
+    static struct {
+        pthread_mutex_t mutex;
+        log_span_site_t *sites[MAX_SPAN_SITES];
+        int site_count;
+        span_thread_t *threads;
+        uint64_t (*reported)[SPAN_BUCKETS];
+        uint64_t base_ticks;
+        int64_t base_ns;
+        double ns_per_tick;
+        FILE *trace;
+        int pid;
+        bool trace_first;
+    } span_state = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+    /* Background thread shared by periodic reports, throttling, TSC calibration and coalescing */
+    static struct {
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        pthread_t thread;
+        unsigned span_interval_ms;
+        unsigned profile_interval_ms;
+        unsigned profile_top;
+        unsigned metric_interval_ms;
+        unsigned coalesce_ms;       /* Window of the runs to close once they expire */
+        bool throttle;
+        bool calibrate;
+        bool running;
+    } ticker_state = { .mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER };
+
+    /* TSC to wall-clock conversion, published under a sequence counter */
+    static struct {
+        uint32_t seq;
+        bool enabled;
+        uint64_t base_tsc;
+        int64_t base_ns;
+        uint64_t mult;          /* ns per tick, 32.32 fixed point */
+        uint64_t last_tsc;      /* Calibrator only */
+        int64_t last_mono_ns;
+    } tsc_clock;
+
+    /* Broken-down time of the last second this thread formatted */
+    static __thread struct {
+        time_t second;
+        struct tm tm;
+        bool valid;
+    } tm_cache;
+
+    static pthread_key_t span_thread_key;
+    static pthread_once_t span_key_once = PTHREAD_ONCE_INIT;
+    static __thread span_thread_t *span_thread;
+
+    /* Background writer; lane 0 carries ERROR and FATAL, lane 1 everything else */
+    static struct {
+        pthread_mutex_t mutex;
+        pthread_cond_t wake;
+        pthread_cond_t drained;
+        pthread_cond_t space;
+        pthread_cond_t work;
+        pthread_t thread;
+        struct {
+            log_record_t *head;
+            log_record_t *tail;
+            unsigned count;
+        } lanes[2];
+        unsigned busy[2];           /* Chunks taken from a lane and not written yet */
+        bool running;
+        bool stop;
+        
+        /* Format workers and the ring of chunks between them and the writer */
+        pthread_t workers[MAX_FORMAT_WORKERS];
+        format_chunk_t *chunks;
+        bool chunks_pooled;         /* The ring lives in the memory budget's arena */
+        unsigned format_workers;    /* Requested with logger_set_format_workers */
+        unsigned worker_count;      /* Running */
+        unsigned depth;             /* Chunks in flight at most, 0 without workers */
+        uint64_t submitted;
+        uint64_t claimed;
+        uint64_t committed;
+        bool workers_stop;
+    } async_state = { .mutex = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER,
+                      .drained = PTHREAD_COND_INITIALIZER, .space = PTHREAD_COND_INITIALIZER,
+                      .work = PTHREAD_COND_INITIALIZER };
+
+    /* Call-site volume profiler; counters are reset by bumping the epoch */
+    static struct {
+        profile_thread_t *threads;
+        int64_t since_ns;
+        unsigned epoch;
+        bool enabled;
+    } profile_state;
+
+    static pthread_key_t profile_thread_key;
+    static pthread_once_t profile_key_once = PTHREAD_ONCE_INIT;
+    static __thread profile_thread_t *profile_thread;
+
+    /* Metric registry, per-thread banks and the totals the last report saw */
+    static struct {
+        pthread_mutex_t mutex;
+        log_metric_site_t *sites[MAX_METRICS];
+        int count;
+        metric_thread_t *threads;
+        uint64_t reported_count[MAX_METRICS];
+        double reported_sum[MAX_METRICS];
+        double last[MAX_METRICS];
+        unsigned interval;
+    } metric_state = { .mutex = PTHREAD_MUTEX_INITIALIZER, .interval = 1 };
+
+    static pthread_key_t metric_thread_key;
+    static pthread_once_t metric_key_once = PTHREAD_ONCE_INIT;
+    static __thread metric_thread_t *metric_thread;
+    static __thread bool profile_reporting;
+
+    /* Log rate budget; events below `level` are shed while the rate is over it */
+    static struct {
+        pthread_mutex_t mutex;
+        rate_thread_t *threads;
+        uint64_t events_per_sec;
+        uint64_t bytes_per_sec;
+        uint64_t seen_events;
+        uint64_t seen_bytes;
+        uint64_t seen_shed[LOG_LEVEL_ERROR];
+        int64_t seen_ns;
+        int level;
+        bool enabled;
+    } throttle_state = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+    static pthread_key_t rate_thread_key;
+    static pthread_once_t rate_key_once = PTHREAD_ONCE_INIT;
+    static __thread rate_thread_t *rate_thread;
+    static __thread bool throttle_reporting;
+
+    /* Format string of the async or batch record being delivered as "%s" */
+    static __thread const char *record_source_format;
+
+    /* File-layout line a format worker already rendered for the event being delivered */
+    static __thread struct {
+        const log_event_t *event;
+        const char *text;
+        size_t length;
+    } record_rendered_line;
+
+    /* Per-thread shard files; only their owners write them, the list is locked to flush and close */
+    static struct {
+        pthread_mutex_t mutex;
+        shard_thread_t *threads;
+        char path[PATH_MAX];
+        uint64_t seq;
+        uint64_t run;
+        unsigned generation;
+        int level;
+        bool enabled;
+    } shard_state = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+    /* Output stall watchdog; `call` names the output call in flight as (number << 8) | (output + 1) */
+    static struct {
+        pthread_mutex_t mutex;
+        pthread_cond_t cond;
+        pthread_mutex_t fallback_mutex;
+        pthread_t thread;
+        uint64_t call;
+        uint64_t call_count;
+        uint64_t rerouted;
+        uint64_t dropped;
+        unsigned stall_ms;
+        int fallback;
+        int stalled;
+        bool bypass;
+        bool probing;
+        bool running;
+    } watchdog_state = { .mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER,
+                         .fallback_mutex = PTHREAD_MUTEX_INITIALIZER, .fallback = -1 };
+
+    static pthread_key_t shard_thread_key;
+    static pthread_once_t shard_key_once = PTHREAD_ONCE_INIT;
+    static __thread shard_thread_t *shard_thread;
+
+    /* Context fields, kernel thread id and name of the calling thread */
+    static __thread struct {
+        log_context_field_t fields[LOGGER_CONTEXT_MAX];
+        int count;
+        int tid;
+        char name[LOGGER_THREAD_NAME_MAX];
+        bool named;
+    } thread_context;
+
+    static pthread_once_t thread_context_once = PTHREAD_ONCE_INIT;
+
+    /* Bumped whenever a level changes; cached category levels compare against it */
+
+    /* Call sites enabled through logger_set_site_enabled; inline checks skip the table while it is 0 */
+    unsigned logger_site_count = 0;
+
+    /* Forward declarations */
+    static void release_config(config_snapshot_t *config);
+    static void release_output(output_handler_t *output);
+    static void compressed_sink_flush(compressed_sink_t *sink);
+    static void compressed_sink_destroy(compressed_sink_t *sink);
+    static void tcp_sink_flush(tcp_sink_t *sink);
+    static void tcp_sink_destroy(tcp_sink_t *sink);
+    static void ring_sink_destroy(ring_sink_t *sink);
+    static void layout_output(output_layout_t *layout, log_event_t *event);
+    static void layout_free(output_layout_t *layout);
+    static bool filter_drops(output_filter_t *filter, const log_event_t *event, va_list ap);
+    static void filter_free(output_filter_t *filter);
+    static bool parse_level(const char *str, log_level_t *level);
+    static void file_index_close_block(file_index_t *index);
+    static void file_index_note(file_index_t *index, const log_event_t *event, uint64_t bytes);
+    static int ticker_restart(void);
+    static int coalesce_tick(unsigned window_ms);
+    static void resolve_categories(void);
+    static void coalesce_sweep(bool all);
+    static void profile_note(const log_event_t *event, uint64_t bytes);
+    static void rate_note(uint64_t events, uint64_t bytes);
+    static bool throttle_sheds(log_level_t level);
+    static void rate_reserve(void);
+    static void pool_link(void);
+    static void profile_reserve(void);
+    static void throttle_adjust(void);
+    static bool async_enqueue(log_category_t *category, log_level_t level, const char *file, const char *function, int line, const char *fmt, va_list ap);
+    static void async_drain(unsigned lane_mask);
+    static void format_release_chunks(void);
+    static bool shard_write(log_event_t *event, va_list ap);
+    static void shard_flush(void);
+    static bool watchdog_bypass(log_event_t *event, va_list ap);
+    static void watchdog_reroute(int output, log_event_t *event, va_list ap);
+    static size_t render_file_line(char *buf, size_t size, log_event_t *event, va_list ap);
+
+    /* Bytes the built-in stream outputs wrote on this thread */
+    static __thread uint64_t output_bytes_written;
+
     /* Level strings */
     static const char *level_strings[] = {
         "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"
@@ -93,18 +740,21 @@
             logger_state.config.show_file_line = true;
             logger_state.config.show_function = false;
             logger_state.config.lock_fn = NULL;
+            logger_state.hexdump_limit = DEFAULT_HEXDUMP_LIMIT;
             logger_state.config.lock_data = NULL;
             
             /* Add default console output */
             logger_add_console_output(LOG_LEVEL_TRACE);
             
             logger_state.initialized = true;
+            resolve_categories();
         }
 
         /// Cleanup logger resources.
         ///
-        /// Closes any open file handles and resets the logger state.
-        /// Should be called before program termination.
+        /// Flushes pending repeat summaries and resets the logger state.
+        /// File handles passed to `logger_add_file_output` stay owned by the
+        /// caller. Should be called before program termination.
         ///
         /// __Return__
         ///
@@ -114,16 +764,35 @@
                 return;
             }
             
-            /* Close any file outputs */
+            logger_set_async(false);
+            logger_set_format_workers(0);
+            logger_set_span_interval(0);
+            logger_set_profile_interval(0, 0);
+            if (__atomic_load_n(&ticker_state.metric_interval_ms, __ATOMIC_RELAXED)) {
+                /* Summaries of the last, partial interval */
+                logger_set_metric_interval(0);
+                logger_metric_report();
+            }
+            logger_set_rate_budget(0, 0);
+            logger_set_shard_output(NULL, LOG_LEVEL_TRACE);
+            logger_set_output_watchdog(0, -1);
+            logger_set_span_trace(NULL);
+            logger_set_tsc_clock(false);
+            logger_set_coalesce(0);
+            logger_flush();
+            logger_unwatch_config();
+            logger_stop_control();
+            
+            lock_logger();
+            release_config(__atomic_exchange_n(&logger_state.file_config, NULL, __ATOMIC_ACQ_REL));
+            for (int i = 0; i < category_registry.count; i++) {
+                category_registry.categories[i].level = -1;
+            }
+            resolve_categories();
             for (int i = 0; i < MAX_OUTPUTS; i++) {
-                if (logger_state.outputs[i].active && 
-                    logger_state.outputs[i].output_fn == logger_file_output) {
-                    FILE *file = (FILE*)logger_state.outputs[i].user_data;
-                    if (file && file != stdout && file != stderr) {
-                        fclose(file);
-                    }
-                }
+                release_output(&logger_state.outputs[i]);
             }
+            unlock_logger();
             
             memset(&logger_state, 0, sizeof(logger_state));
         }
@@ -145,10 +814,20 @@
         /// - No return value
         void logger_set_level(log_level_t level) {
             lock_logger();
-            logger_state.config.level = level;
+            __atomic_store_n(&logger_state.config.level, level, __ATOMIC_RELAXED);
+            resolve_categories();
             unlock_logger();
         }
 
+        /// Get the current minimum log level.
+        ///
+        /// __Return__
+        ///
+        /// - Global minimum log level
+        log_level_t logger_get_level(void) {
+            return __atomic_load_n(&logger_state.config.level, __ATOMIC_RELAXED);
+        }
+
         /// Enable or disable all logging output.
         ///
         /// When quiet mode is enabled, no messages will be output regardless
@@ -163,7 +842,7 @@
         /// - No return value
         void logger_set_quiet(bool quiet) {
             lock_logger();
-            logger_state.config.quiet = quiet;
+            __atomic_store_n(&logger_state.config.quiet, quiet, __ATOMIC_RELAXED);
             unlock_logger();
         }
 
@@ -220,10 +899,30 @@
             unlock_logger();
         }
 
+        /// Show or hide the thread and its context fields.
+        ///
+        /// When enabled, the console and file outputs add the thread id, the
+        /// thread name and every field set with `logger_context_set` after
+        /// the location. JSON outputs always carry them.
+        ///
+        /// __Parameters__
+        ///
+        /// - `show`: true to show the thread context, false to hide it
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_set_show_context(bool show) {
+            lock_logger();
+            logger_state.config.show_context = show;
+            unlock_logger();
+        }
+
         /// Set thread safety lock function.
         ///
         /// Provides a way to make the logger thread-safe by providing
-        /// custom locking mechanisms.
+        /// custom locking mechanisms. The async writer and configuration
+        /// watching refuse to start without one.
         ///
         /// __Parameters__
         ///
@@ -240,6 +939,267 @@
             unlock_logger();
         }
 
+        /// Enable or disable duplicate-message coalescing.
+        ///
+        /// When enabled, an event whose rendered text matches the previous
+        /// event from the same call site is suppressed. The run is closed with
+        /// a single "last message repeated N times" line once a different
+        /// message arrives at that site, the window expires, or the logger is
+        /// flushed. Expired runs of sites that went quiet are closed by the
+        /// ticker thread, at most a quarter window late. Changing the window
+        /// closes every pending run first.
+        ///
+        /// __Parameters__
+        ///
+        /// - `window_ms`: Longest run to fold into one summary, 0 to disable
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_set_coalesce(unsigned window_ms) {
+            lock_logger();
+            coalesce_sweep(true);
+            logger_state.coalesce_window_ms = window_ms;
+            memset(logger_state.coalesce_sites, 0, sizeof(logger_state.coalesce_sites));
+            unlock_logger();
+            coalesce_tick(window_ms);
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── RECORD POOL ────────────────────────────┐
+
+        /* Free list heads pack an ABA tag above the slot number (1-based, 0 = empty) */
+        #define POOL_HEAD(tag, slot) (((uint64_t)(tag) << 32) | (uint32_t)(slot))
+
+        static log_record_t *pool_slot(uint32_t slot) {
+            return (log_record_t*)(record_pool.records + (size_t)(slot - 1) * LOGGER_RECORD_SIZE);
+        }
+
+        /* Build the pool over a fresh arena, caller guarantees no records are out */
+        static int pool_create(size_t bytes) {
+            size_t stream_bytes = (size_t)MAX_OUTPUTS * LOGGER_STREAM_BUFFER_SIZE;
+            if (bytes < stream_bytes + LOGGER_RECORD_SIZE) {
+                return -1;
+            }
+            
+            unsigned char *arena = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+            if (arena == MAP_FAILED) {
+                return -1;
+            }
+            /* Touch every page now so the first records never fault */
+            memset(arena, 0, bytes);
+            
+            if (record_pool.arena) {
+                munmap(record_pool.arena, record_pool.arena_size);
+            }
+            
+            record_pool.arena = arena;
+            record_pool.arena_size = bytes;
+            record_pool.records = arena + stream_bytes;
+            record_pool.record_count = (uint32_t)((bytes - stream_bytes) / LOGGER_RECORD_SIZE);
+            record_pool.chunk_slots = 0;
+            record_pool.in_use = 0;
+            pool_link();
+            return 0;
+        }
+
+        /* Put every record slot on the free list */
+        static void pool_link(void) {
+            for (uint32_t slot = 1; slot <= record_pool.record_count; slot++) {
+                pool_slot(slot)->pool_next = slot < record_pool.record_count ? slot + 1 : 0;
+            }
+            __atomic_store_n(&record_pool.free_head, POOL_HEAD(0, 1), __ATOMIC_RELEASE);
+        }
+
+        /* Lend the front of the record area to `count` format chunks; the pool must be idle */
+        static format_chunk_t *pool_take_chunks(size_t count) {
+            size_t stream_bytes = (size_t)MAX_OUTPUTS * LOGGER_STREAM_BUFFER_SIZE;
+            uint32_t slots = (uint32_t)((count * sizeof(format_chunk_t) + LOGGER_RECORD_SIZE - 1) / LOGGER_RECORD_SIZE);
+            uint32_t total = record_pool.record_count + record_pool.chunk_slots;
+            
+            /* Keep room for a few chunks of records, or the workers would only cost records */
+            if (__atomic_load_n(&record_pool.in_use, __ATOMIC_ACQUIRE) != 0 || total < slots + 4 * ASYNC_CHUNK) {
+                return NULL;
+            }
+            record_pool.chunk_slots = slots;
+            record_pool.records = record_pool.arena + stream_bytes + (size_t)slots * LOGGER_RECORD_SIZE;
+            record_pool.record_count = total - slots;
+            pool_link();
+            memset(record_pool.arena + stream_bytes, 0, count * sizeof(format_chunk_t));
+            return (format_chunk_t*)(record_pool.arena + stream_bytes);
+        }
+
+        /* Give lent slots back to the records; left for the next budget if records are still out */
+        static void pool_return_chunks(void) {
+            if (!record_pool.chunk_slots || __atomic_load_n(&record_pool.in_use, __ATOMIC_ACQUIRE) != 0) {
+                return;
+            }
+            record_pool.records = record_pool.arena + (size_t)MAX_OUTPUTS * LOGGER_STREAM_BUFFER_SIZE;
+            record_pool.record_count += record_pool.chunk_slots;
+            record_pool.chunk_slots = 0;
+            pool_link();
+        }
+
+        /* Give a stream preallocated stdio buffer; only one without a buffer yet has seen no I/O */
+        static void pool_attach_stream(FILE *file, int slot) {
+            if (record_pool.bounded && file && slot >= 0 && file != stderr && __fbufsize(file) == 0) {
+                setvbuf(file, (char*)record_pool.arena + (size_t)slot * LOGGER_STREAM_BUFFER_SIZE,
+                        _IOFBF, LOGGER_STREAM_BUFFER_SIZE);
+                logger_state.outputs[slot].arena_buffer = true;
+            }
+        }
+
+        /* Take a record slot; never allocates, NULL when the pool is empty or missing */
+        static log_record_t *record_acquire(void) {
+            uint64_t head = __atomic_load_n(&record_pool.free_head, __ATOMIC_ACQUIRE);
+            
+            for (;;) {
+                uint32_t slot = (uint32_t)head;
+                if (slot == 0) {
+                    return NULL;
+                }
+                log_record_t *record = pool_slot(slot);
+                uint64_t next = POOL_HEAD((head >> 32) + 1, record->pool_next);
+                if (__atomic_compare_exchange_n(&record_pool.free_head, &head, next, true,
+                                                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                    __atomic_add_fetch(&record_pool.in_use, 1, __ATOMIC_RELAXED);
+                    record->next = NULL;
+                    return record;
+                }
+            }
+        }
+
+        /* Give a record slot back to the pool */
+        static void record_release(log_record_t *record) {
+            uint32_t slot = (uint32_t)(((unsigned char*)record - record_pool.records) / LOGGER_RECORD_SIZE) + 1;
+            uint64_t head = __atomic_load_n(&record_pool.free_head, __ATOMIC_ACQUIRE);
+            
+            do {
+                record->pool_next = (uint32_t)head;
+            } while (!__atomic_compare_exchange_n(&record_pool.free_head, &head,
+                                                  POOL_HEAD((head >> 32) + 1, slot), true,
+                                                  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+            __atomic_sub_fetch(&record_pool.in_use, 1, __ATOMIC_RELAXED);
+        }
+
+        /* Render a message into a record, truncating to the slot size; false if it did not fit */
+        static bool record_format(log_record_t *record, const char *fmt, va_list ap) {
+            va_list copy;
+            va_copy(copy, ap);
+            int len = vsnprintf(record->message, LOGGER_RECORD_CAPACITY, fmt, copy);
+            va_end(copy);
+            
+            if (len < 0) {
+                len = 0;
+                record->message[0] = '\0';
+            }
+            record->length = (uint32_t)len < LOGGER_RECORD_CAPACITY ? (uint32_t)len : (uint32_t)LOGGER_RECORD_CAPACITY - 1;
+            return (uint32_t)len < LOGGER_RECORD_CAPACITY;
+        }
+
+        /* Make sure buffering features have a pool, sized by default if no budget was set */
+        static int pool_ensure(void) {
+            if (record_pool.arena) {
+                return 0;
+            }
+            return pool_create(DEFAULT_MEMORY_BUDGET);
+        }
+
+        /// Bound the logger's memory and forbid allocation while logging.
+        ///
+        /// Reserves `bytes` up front and touches every page of it. All
+        /// record storage used by buffering outputs comes from this arena, and
+        /// file outputs added afterwards get their stdio buffer from it too,
+        /// so `logger_log` never calls `malloc`. When the arena runs out,
+        /// records are dropped and counted instead of allocating more. Only
+        /// a FILE without I/O yet gets an arena buffer; one that was already
+        /// used keeps its own. A FILE that got an arena buffer belongs to the
+        /// arena: after its output is removed it must not be written again,
+        /// and it must be closed with `fclose` before the budget changes.
+        /// Sharded files allocate per thread, so a budget is refused while
+        /// they are on. Format workers started under a budget take their
+        /// chunks from the record slots.
+        ///
+        /// __Parameters__
+        ///
+        /// - `bytes`: Memory budget, 0 to leave bounded mode
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 if the budget is too small, records are still
+        ///   in flight, an output added under the current budget still uses
+        ///   its buffer, shards are on, format workers use the arena, or the
+        ///   arena cannot be mapped
+        int logger_set_memory_budget(size_t bytes) {
+            int result = 0;
+            
+            lock_logger();
+            
+            if (__atomic_load_n(&record_pool.in_use, __ATOMIC_ACQUIRE) != 0 ||
+                (bytes != 0 && __atomic_load_n(&shard_state.enabled, __ATOMIC_ACQUIRE)) ||
+                (bytes != 0 && __atomic_load_n(&async_state.chunks_pooled, __ATOMIC_ACQUIRE))) {
+                unlock_logger();
+                return -1;
+            }
+            
+            /* A new arena would unmap the stdio buffers of streams that still write */
+            for (int i = 0; bytes != 0 && i < MAX_OUTPUTS; i++) {
+                if (logger_state.outputs[i].active && logger_state.outputs[i].arena_buffer) {
+                    unlock_logger();
+                    return -1;
+                }
+            }
+            
+            if (bytes == 0) {
+                record_pool.bounded = false;
+            } else if ((result = pool_create(bytes)) == 0) {
+                record_pool.bounded = true;
+                
+                /* Per-thread counters cannot be allocated while logging any more */
+                rate_reserve();
+                if (__atomic_load_n(&profile_state.enabled, __ATOMIC_RELAXED)) {
+                    profile_reserve();
+                }
+                
+                /* Load the timezone now, localtime_r would do it on first use */
+                tzset();
+            }
+            
+            unlock_logger();
+            return result;
+        }
+
+        /// Read logger statistics.
+        ///
+        /// __Parameters__
+        ///
+        /// - `stats`: Receives the counters
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_get_stats(log_stats_t *stats) {
+            if (!stats) {
+                return;
+            }
+            
+            memset(stats, 0, sizeof(*stats));
+            stats->memory_budget = record_pool.bounded ? record_pool.arena_size : 0;
+            stats->records_total = record_pool.record_count;
+            stats->records_in_use = __atomic_load_n(&record_pool.in_use, __ATOMIC_RELAXED);
+            stats->records_dropped = __atomic_load_n(&record_pool.dropped, __ATOMIC_RELAXED);
+            stats->records_truncated = __atomic_load_n(&record_pool.truncated, __ATOMIC_RELAXED);
+            stats->records_rerouted = __atomic_load_n(&watchdog_state.rerouted, __ATOMIC_RELAXED);
+            stats->records_stall_dropped = __atomic_load_n(&watchdog_state.dropped, __ATOMIC_RELAXED);
+            for (rate_thread_t *t = __atomic_load_n(&throttle_state.threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+                for (int level = 0; level < LOG_LEVEL_ERROR; level++) {
+                    stats->records_throttled += __atomic_load_n(&t->shed[level], __ATOMIC_RELAXED);
+                }
+            }
+        }
+
     // └────────────────────────────────────────────────────────────────────┘
 
     // ┌──────────────────────────── OUTPUT MANAGEMENT ────────────────────────────┐
@@ -275,7 +1235,35 @@
             if (!file) {
                 return -1;
             }
-            return logger_add_custom_output(logger_file_output, file, level);
+            if (logger_add_custom_output(logger_file_output, file, level) != 0) {
+                return -1;
+            }
+            pool_attach_stream(file, logger_find_output(logger_file_output, file));
+            return 0;
+        }
+
+        /// Add JSON lines output handler.
+        ///
+        /// Writes one JSON object per event, carrying the thread id, thread
+        /// name and context fields alongside the message.
+        ///
+        /// __Parameters__
+        ///
+        /// - `file`: File pointer to write to
+        /// - `level`: Minimum log level for this output
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on failure (no free slots or invalid file)
+        int logger_add_json_output(FILE *file, log_level_t level) {
+            if (!file) {
+                return -1;
+            }
+            if (logger_add_custom_output(logger_json_output, file, level) != 0) {
+                return -1;
+            }
+            pool_attach_stream(file, logger_find_output(logger_json_output, file));
+            return 0;
         }
 
         /// Add custom output handler.
@@ -313,212 +1301,6318 @@
             return -1; /* No free slots */
         }
 
-    // └────────────────────────────────────────────────────────────────────┘
-
-    // ┌──────────────────────────── UTILITY FUNCTIONS ────────────────────────────┐
-
-        /// Convert log level to string representation.
+        /// Find the slot index of a registered output.
         ///
-        /// Returns a human-readable string for the given log level.
+        /// The index is the handle used by the per-output configuration
+        /// functions.
         ///
         /// __Parameters__
         ///
-        /// - `level`: Log level to convert
+        /// - `output_fn`: Output function the output was registered with
+        /// - `user_data`: User data the output was registered with
         ///
         /// __Return__
         ///
-        /// - String representation of the level, or "UNKNOWN" for invalid levels
-        const char* logger_level_to_string(log_level_t level) {
-            if (level >= 0 && level < 6) {
-                return level_strings[level];
+        /// - Output index on success, -1 if no such output is active
+        int logger_find_output(log_output_fn_t output_fn, void *user_data) {
+            int index = -1;
+            
+            lock_logger();
+            
+            for (int i = 0; i < MAX_OUTPUTS; i++) {
+                if (logger_state.outputs[i].active &&
+                    logger_state.outputs[i].output_fn == output_fn &&
+                    logger_state.outputs[i].user_data == user_data) {
+                    index = i;
+                    break;
+                }
             }
-            return "UNKNOWN";
+            
+            unlock_logger();
+            return index;
         }
 
-        /// Convert string to log level.
+        /// Remove a registered output.
         ///
-        /// Parses a string representation of a log level (case-insensitive).
+        /// The output's user data is left untouched; closing a file passed to
+        /// `logger_add_file_output` is still up to the caller.
         ///
         /// __Parameters__
         ///
-        /// - `str`: String to parse (e.g., "INFO", "error", "WARN")
+        /// - `output`: Output index from `logger_find_output`
         ///
         /// __Return__
         ///
-        /// - Corresponding log level, or LOG_LEVEL_INFO for invalid strings
-        log_level_t logger_string_to_level(const char *str) {
-            if (!str) return LOG_LEVEL_INFO;
+        /// - 0 on success, -1 on invalid output index
+        int logger_remove_output(int output) {
+            if (output < 0 || output >= MAX_OUTPUTS) {
+                return -1;
+            }
+            
+            lock_logger();
+            
+            if (!logger_state.outputs[output].active) {
+                unlock_logger();
+                return -1;
+            }
+            release_output(&logger_state.outputs[output]);
+            
+            unlock_logger();
+            return 0;
+        }
+
+        /// Opt a single output in or out of duplicate-message coalescing.
+        ///
+        /// Outputs take part in coalescing by default. An opted-out output
+        /// receives every repeat verbatim and never sees summary lines.
+        ///
+        /// __Parameters__
+        ///
+        /// - `output`: Output index from `logger_find_output`
+        /// - `enabled`: true to coalesce repeats on this output
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on invalid output index
+        int logger_set_output_coalesce(int output, bool enabled) {
+            if (output < 0 || output >= MAX_OUTPUTS) {
+                return -1;
+            }
+            
+            lock_logger();
+            
+            if (!logger_state.outputs[output].active) {
+                unlock_logger();
+                return -1;
+            }
+            logger_state.outputs[output].no_coalesce = !enabled;
+            
+            unlock_logger();
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── PATTERN LAYOUTS ────────────────────────────┐
+
+        static bool layout_is_site_op(layout_op_kind_t kind) {
+            return kind == LAYOUT_TEXT || kind == LAYOUT_FILE || kind == LAYOUT_LINE || kind == LAYOUT_FUNCTION;
+        }
+
+        /* Append a step; text steps point into the layout's own copy of the pattern */
+        static layout_op_t *layout_add(output_layout_t *layout, layout_op_kind_t kind, const char *text, size_t length) {
+            if (layout->op_count >= LAYOUT_MAX_OPS) {
+                return NULL;
+            }
+            layout_op_t *op = &layout->ops[layout->op_count++];
+            memset(op, 0, sizeof(*op));
+            op->kind = kind;
+            op->text = text;
+            op->length = length;
+            op->cached_second = INT64_MIN;
+            return op;
+        }
+
+        /* Split a %d{...} format into strftime pieces and %ms/%us steps */
+        static int layout_compile_time(output_layout_t *layout, char *format) {
+            char *piece = format;
+            
+            for (char *p = format; ; p++) {
+                bool end = *p == '\0';
+                bool fraction = !end && p[0] == '%' && (p[1] == 'm' || p[1] == 'u') && p[2] == 's';
+                if (!end && p[0] == '%' && p[1] == '%') {
+                    p++;
+                    continue;
+                }
+                if (!end && !fraction) {
+                    continue;
+                }
+                
+                if (p > piece) {
+                    char saved = *p;
+                    *p = '\0';
+                    if (!layout_add(layout, LAYOUT_TIME, strdup(piece), (size_t)(p - piece))) {
+                        return -1;
+                    }
+                    *p = saved;
+                }
+                if (end) {
+                    return 0;
+                }
+                if (!layout_add(layout, p[1] == 'm' ? LAYOUT_MILLIS : LAYOUT_MICROS, NULL, 0)) {
+                    return -1;
+                }
+                p += 2;
+                piece = p + 1;
+            }
+        }
+
+        /* Free the strftime pieces, which are the only separately allocated texts */
+        static void layout_free(output_layout_t *layout) {
+            for (int i = 0; i < layout->op_count; i++) {
+                if (layout->ops[i].kind == LAYOUT_TIME) {
+                    free((char*)layout->ops[i].text);
+                }
+            }
+            free(layout->text);
+            free(layout);
+        }
+
+        /* Compile a pattern, then fold each run of call-site steps under a SITE step */
+        static output_layout_t *layout_compile(const char *pattern) {
+            output_layout_t *layout = calloc(1, sizeof(*layout));
+            char *text = layout ? strdup(pattern) : NULL;
+            if (!text) {
+                free(layout);
+                return NULL;
+            }
+            layout->text = text;
+            
+            output_layout_t flat;
+            flat.op_count = 0;
+            char *p = text;
+            bool ok = true;
+            
+            while (*p && ok) {
+                if (*p != '%') {
+                    char *start = p;
+                    while (*p && *p != '%') {
+                        p++;
+                    }
+                    ok = layout_add(&flat, LAYOUT_TEXT, start, (size_t)(p - start)) != NULL;
+                    continue;
+                }
+                
+                p++;
+                bool left = *p == '-';
+                p += left;
+                int width = 0;
+                while (*p >= '0' && *p <= '9') {
+                    width = width * 10 + (*p++ - '0');
+                }
+                
+                layout_op_kind_t kind;
+                switch (*p) {
+                    case '%': kind = LAYOUT_TEXT; break;
+                    case 'd': kind = LAYOUT_TIME; break;
+                    case 'l': kind = LAYOUT_LEVEL; break;
+                    case 'f': kind = LAYOUT_FILE; break;
+                    case 'L': kind = LAYOUT_LINE; break;
+                    case 'F': kind = LAYOUT_FUNCTION; break;
+                    case 'c': kind = LAYOUT_CATEGORY; break;
+                    case 't': kind = LAYOUT_THREAD_ID; break;
+                    case 'N': kind = LAYOUT_THREAD_NAME; break;
+                    case 'X': kind = LAYOUT_CONTEXT; break;
+                    case 'C': kind = LAYOUT_COLOR; break;
+                    case 'R': kind = LAYOUT_RESET; break;
+                    case 'm': kind = LAYOUT_MESSAGE; break;
+                    case 'n': kind = LAYOUT_TEXT; break;
+                    default: ok = false; continue;
+                }
+                
+                if (*p == 'd') {
+                    char *format = NULL;
+                    if (p[1] == '{') {
+                        format = p + 2;
+                        char *close = strchr(format, '}');
+                        if (!close) {
+                            ok = false;
+                            continue;
+                        }
+                        *close = '\0';
+                        p = close;
+                    }
+                    char *owned = strdup(format ? format : "%Y-%m-%d %H:%M:%S");
+                    ok = owned && layout_compile_time(&flat, owned) == 0;
+                    free(owned);
+                    p++;
+                    continue;
+                }
+                
+                layout_op_t *op = layout_add(&flat, kind, *p == 'n' ? "\n" : *p == '%' ? "%" : NULL, 1);
+                if (op) {
+                    op->width = width;
+                    op->left = left;
+                }
+                ok = op != NULL;
+                p++;
+            }
+            
+            /* Runs of text, file, line and function steps become one cached piece per call site */
+            for (int i = 0; i < flat.op_count && ok; ) {
+                int run = 0;
+                bool site = false;
+                while (i + run < flat.op_count && layout_is_site_op(flat.ops[i + run].kind)) {
+                    site = site || flat.ops[i + run].kind != LAYOUT_TEXT;
+                    run++;
+                }
+                if (site) {
+                    layout_op_t *op = layout_add(layout, LAYOUT_SITE, NULL, 0);
+                    ok = op != NULL;
+                    if (op) {
+                        op->count = run;
+                    }
+                } else {
+                    run = run ? run : 1;
+                }
+                for (int j = 0; j < run && ok; j++) {
+                    ok = layout->op_count < LAYOUT_MAX_OPS;
+                    if (ok) {
+                        layout->ops[layout->op_count++] = flat.ops[i + j];
+                    }
+                }
+                i += run;
+            }
+            
+            if (!ok) {
+                for (int i = 0; i < flat.op_count; i++) {
+                    if (flat.ops[i].kind == LAYOUT_TIME) {
+                        free((char*)flat.ops[i].text);
+                    }
+                }
+                layout->op_count = 0;
+                layout_free(layout);
+                return NULL;
+            }
+            return layout;
+        }
+
+        /* Copy `value` into `out`, padded to the step's width; like snprintf, returns the full length */
+        static size_t layout_pad(char *out, size_t room, const layout_op_t *op, const char *value, size_t length) {
+            size_t pad = op->width > 0 && (size_t)op->width > length ? (size_t)op->width - length : 0;
+            if (length + pad >= room) {
+                return length + pad;
+            }
+            if (!op->left) {
+                memset(out, ' ', pad);
+            }
+            memcpy(out + (op->left ? 0 : pad), value, length);
+            if (op->left) {
+                memset(out + length, ' ', pad);
+            }
+            return length + pad;
+        }
+
+        /* Render one step other than the message and SITE steps */
+        static size_t layout_render(layout_op_t *op, char *out, size_t room, const log_event_t *event) {
+            char scratch[MAX_CONTEXT_LEN];
+            const char *value = scratch;
+            size_t length = 0;
+            int64_t ns = event->timestamp_ns;
+            
+            switch (op->kind) {
+                case LAYOUT_TEXT:
+                    value = op->text;
+                    length = op->length;
+                    break;
+                case LAYOUT_TIME:
+                    /* strftime only runs when the second changes */
+                    if (op->cached_second != ns / 1000000000) {
+                        op->cached_length = strftime(op->cached, sizeof(op->cached), op->text, event->time);
+                        op->cached_second = ns / 1000000000;
+                    }
+                    value = op->cached;
+                    length = op->cached_length;
+                    break;
+                case LAYOUT_MILLIS:
+                    length = (size_t)snprintf(scratch, sizeof(scratch), "%03d", (int)(ns % 1000000000 / 1000000));
+                    break;
+                case LAYOUT_MICROS:
+                    length = (size_t)snprintf(scratch, sizeof(scratch), "%06d", (int)(ns % 1000000000 / 1000));
+                    break;
+                case LAYOUT_LEVEL:
+                    value = level_strings[event->level];
+                    length = strlen(value);
+                    break;
+                case LAYOUT_FILE:
+                    value = event->file ? event->file : "";
+                    length = strlen(value);
+                    break;
+                case LAYOUT_LINE:
+                    length = (size_t)snprintf(scratch, sizeof(scratch), "%d", event->line);
+                    break;
+                case LAYOUT_FUNCTION:
+                    value = event->function ? event->function : "";
+                    length = strlen(value);
+                    break;
+                case LAYOUT_CATEGORY:
+                    value = event->category ? event->category : "";
+                    length = strlen(value);
+                    break;
+                case LAYOUT_THREAD_ID:
+                    length = (size_t)snprintf(scratch, sizeof(scratch), "%d", event->thread_id);
+                    break;
+                case LAYOUT_THREAD_NAME:
+                    value = event->thread_name ? event->thread_name : "";
+                    length = strlen(value);
+                    break;
+                case LAYOUT_CONTEXT:
+                    for (int i = 0; i < event->context_count && length < sizeof(scratch); i++) {
+                        int n = snprintf(scratch + length, sizeof(scratch) - length, "%s%s=%s", i ? " " : "",
+                                         event->context[i].key, event->context[i].value);
+                        length = n > 0 && length + (size_t)n < sizeof(scratch) ? length + (size_t)n : sizeof(scratch) - 1;
+                    }
+                    break;
+                case LAYOUT_COLOR:
+                    value = level_colors[event->level];
+                    length = strlen(value);
+                    break;
+                case LAYOUT_RESET:
+                    value = color_reset;
+                    length = strlen(value);
+                    break;
+                default:
+                    break;
+            }
+            return layout_pad(out, room, op, value, length);
+        }
+
+        /* Cached text of a SITE step's call-site steps, or NULL when it is too long to cache */
+        static layout_site_t *layout_site(output_layout_t *layout, layout_op_t *site_op, const log_event_t *event) {
+            uint64_t hash = ((uint64_t)(uintptr_t)event->file ^ ((uint64_t)(unsigned)event->line << 40)) * 0x9e3779b97f4a7c15ull;
+            layout_site_t *site = &layout->sites[(hash >> 40) % LAYOUT_SITES];
+            
+            if (site->length && site->file == event->file && site->line == event->line) {
+                return site;
+            }
+            
+            size_t length = 0;
+            for (int i = 1; i <= site_op->count; i++) {
+                length += layout_render(site_op + i, site->text + length, sizeof(site->text) - length, event);
+                if (length >= sizeof(site->text)) {
+                    site->length = 0;
+                    return NULL;
+                }
+            }
+            site->file = event->file;
+            site->line = event->line;
+            site->length = (uint16_t)length;
+            return length ? site : NULL;
+        }
+
+        /* Write the line for one event: steps go into a stack buffer and out in a single fwrite */
+        static void layout_output(output_layout_t *layout, log_event_t *event) {
+            FILE *stream = (FILE*)event->user_data;
+            char buf[LAYOUT_LINE_MAX];
+            size_t pos = 0;
+            uint64_t written = 0;
+            
+            for (int i = 0; i < layout->op_count; i++) {
+                layout_op_t *op = &layout->ops[i];
+                
+                /* Every step but the message fits in what is left after a partial write */
+                if (sizeof(buf) - pos < MAX_CONTEXT_LEN + 64) {
+                    written += fwrite(buf, 1, pos, stream);
+                    pos = 0;
+                }
+                
+                if (op->kind == LAYOUT_SITE) {
+                    layout_site_t *site = layout_site(layout, op, event);
+                    if (site) {
+                        memcpy(buf + pos, site->text, site->length);
+                        pos += site->length;
+                    } else {
+                        for (int j = 1; j <= op->count; j++) {
+                            size_t n = layout_render(op + j, buf + pos, sizeof(buf) - pos, event);
+                            pos += n < sizeof(buf) - pos ? n : 0;
+                        }
+                    }
+                    i += op->count;
+                } else if (op->kind == LAYOUT_MESSAGE) {
+                    va_list copy;
+                    va_copy(copy, event->ap);
+                    int n = vsnprintf(buf + pos, sizeof(buf) - pos, event->fmt, event->ap);
+                    if (n > 0 && (size_t)n < sizeof(buf) - pos) {
+                        pos += (size_t)n;
+                    } else if (n > 0) {
+                        /* Too long for the buffer, let stdio take it directly */
+                        written += fwrite(buf, 1, pos, stream);
+                        pos = 0;
+                        int direct = vfprintf(stream, event->fmt, copy);
+                        written += direct > 0 ? (uint64_t)direct : 0;
+                    }
+                    va_end(copy);
+                } else {
+                    size_t n = layout_render(op, buf + pos, sizeof(buf) - pos, event);
+                    pos += n < sizeof(buf) - pos ? n : 0;
+                }
+            }
+            
+            written += fwrite(buf, 1, pos, stream);
+            if (!logger_state.batching) {
+                fflush(stream);
+            }
+            output_bytes_written += written;
+        }
+
+        /// Give a console or file output its own line pattern.
+        ///
+        /// The pattern is compiled once into a flat list of steps. Runs of
+        /// file, line and function steps (and the text between them) are
+        /// rendered once per call site and then copied, and the date is
+        /// only reformatted when the second changes, so a pattern costs
+        /// no more than the built-in layouts.
+        ///
+        /// Conversions, each with an optional `-` and width as in `%-5l`:
+        /// `%d{fmt}` date (strftime plus `%ms`/`%us`, default
+        /// `%Y-%m-%d %H:%M:%S`), `%l` level, `%f` file, `%L` line,
+        /// `%F` function, `%c` category, `%t` thread id, `%N` thread name,
+        /// `%X` context fields, `%C`/`%R` level color and reset, `%m`
+        /// message, `%n` newline, `%%` percent sign.
+        ///
+        /// __Parameters__
+        ///
+        /// - `output`: Output index from `logger_find_output`
+        /// - `pattern`: Line pattern, or NULL for the built-in layout
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on an invalid output, output type or pattern
+        int logger_set_output_pattern(int output, const char *pattern) {
+            if (output < 0 || output >= MAX_OUTPUTS) {
+                return -1;
+            }
+            
+            output_layout_t *layout = NULL;
+            if (pattern && !(layout = layout_compile(pattern))) {
+                return -1;
+            }
+            
+            lock_logger();
+            
+            output_handler_t *out = &logger_state.outputs[output];
+            if (!out->active || (out->output_fn != logger_console_output && out->output_fn != logger_file_output)) {
+                unlock_logger();
+                if (layout) layout_free(layout);
+                return -1;
+            }
+            output_layout_t *previous = out->layout;
+            out->layout = layout;
+            
+            unlock_logger();
+            
+            if (previous) {
+                layout_free(previous);
+            }
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── OUTPUT FILTERS ────────────────────────────┐
+
+        /* Split one `key<op>value` term off `*cursor`; quoted values may hold spaces */
+        static bool filter_next_term(char **cursor, char **key, char **op, char **value) {
+            char *p = *cursor;
+            while (*p == ' ' || *p == '\t') {
+                p++;
+            }
+            if (!*p) {
+                return false;
+            }
+            
+            *key = p;
+            while (*p && strchr("<>=^*", *p) == NULL && *p != ' ') {
+                p++;
+            }
+            char *op_start = p;
+            while (*p && strchr("<>=^*", *p)) {
+                p++;
+            }
+            *op = strndup(op_start, (size_t)(p - op_start));
+            *op_start = '\0';
+            
+            if (*p == '"') {
+                *value = ++p;
+                while (*p && *p != '"') {
+                    p++;
+                }
+            } else {
+                *value = p;
+                while (*p && *p != ' ' && *p != '\t') {
+                    p++;
+                }
+            }
+            if (*p) {
+                *p++ = '\0';
+            }
+            *cursor = p;
+            return true;
+        }
+
+        /* Parse a rule into its terms; strings point into the rule's own copy of the spec */
+        static int filter_compile(filter_rule_t *rule, const char *spec) {
+            memset(rule, 0, sizeof(*rule));
+            rule->level_min = LOG_LEVEL_TRACE;
+            rule->level_max = LOG_LEVEL_FATAL;
+            rule->spec = strdup(spec);
+            if (!rule->spec) {
+                return -1;
+            }
+            
+            char *cursor = rule->spec, *key, *op, *value;
+            int terms = 0;
+            while (filter_next_term(&cursor, &key, &op, &value)) {
+                log_level_t level;
+                bool ok = op != NULL && *value;
+                
+                if (ok && strcmp(key, "level") == 0 && parse_level(value, &level)) {
+                    if (strcmp(op, "<=") == 0 || strcmp(op, "<") == 0) {
+                        rule->level_max = (int)level - (op[1] == '\0');
+                    } else if (strcmp(op, ">=") == 0 || strcmp(op, ">") == 0) {
+                        rule->level_min = (int)level + (op[1] == '\0');
+                    } else if (strcmp(op, "=") == 0) {
+                        rule->level_min = rule->level_max = (int)level;
+                    } else {
+                        ok = false;
+                    }
+                } else if (ok && strcmp(key, "file") == 0 && strcmp(op, "=") == 0) {
+                    rule->file = value;
+                } else if (ok && strcmp(key, "function") == 0 && strcmp(op, "=") == 0) {
+                    rule->function = value;
+                } else if (ok && strcmp(key, "format") == 0 && strcmp(op, "^=") == 0) {
+                    rule->format_prefix = value;
+                    rule->format_prefix_len = strlen(value);
+                } else if (ok && strcmp(key, "format") == 0 && strcmp(op, "*=") == 0) {
+                    rule->format_substring = value;
+                } else if (ok && strcmp(key, "text") == 0 && strcmp(op, "*=") == 0) {
+                    rule->text_substring = value;
+                } else {
+                    ok = false;
+                }
+                
+                free(op);
+                if (!ok) {
+                    free(rule->spec);
+                    rule->spec = NULL;
+                    return -1;
+                }
+                terms++;
+            }
+            
+            if (terms == 0) {
+                free(rule->spec);
+                rule->spec = NULL;
+                return -1;
+            }
+            return 0;
+        }
+
+        static void filter_free(output_filter_t *filter) {
+            for (int i = 0; i < filter->count; i++) {
+                free(filter->rules[i].spec);
+            }
+            free(filter);
+        }
+
+        /* Level, file, function and format terms only depend on the call site */
+        static bool filter_site_matches(const filter_rule_t *rule, const log_event_t *event, const char *format) {
+            if ((int)event->level < rule->level_min || (int)event->level > rule->level_max) {
+                return false;
+            }
+            if (rule->file && fnmatch(rule->file, event->file ? event->file : "", 0) != 0) {
+                return false;
+            }
+            if (rule->function && fnmatch(rule->function, event->function ? event->function : "", 0) != 0) {
+                return false;
+            }
+            if (rule->format_prefix && strncmp(format, rule->format_prefix, rule->format_prefix_len) != 0) {
+                return false;
+            }
+            if (rule->format_substring && !strstr(format, rule->format_substring)) {
+                return false;
+            }
+            return true;
+        }
+
+        /* One cache lookup for most events; only rules with a text term render the message */
+        static bool filter_drops(output_filter_t *filter, const log_event_t *event, va_list ap) {
+            const char *format = record_source_format ? record_source_format : event->fmt;
+            uint64_t hash = ((uint64_t)(uintptr_t)format ^ ((uint64_t)(unsigned)event->line << 32)) * 0x9e3779b97f4a7c15ull;
+            filter_verdict_t *verdict = &filter->verdicts[(hash >> 40) % FILTER_CACHE_SIZE];
+            
+            /* Identical format literals are merged, so the format alone does not name a call site */
+            if (verdict->fmt != format || verdict->file != event->file || verdict->function != event->function ||
+                verdict->line != event->line || verdict->level != (int)event->level) {
+                verdict->matched = 0;
+                for (int i = 0; i < filter->count; i++) {
+                    if (filter_site_matches(&filter->rules[i], event, format ? format : "")) {
+                        verdict->matched |= 1u << i;
+                    }
+                }
+                verdict->fmt = format;
+                verdict->file = event->file;
+                verdict->function = event->function;
+                verdict->line = event->line;
+                verdict->level = (int)event->level;
+            }
+            
+            if (verdict->matched & ~filter->text_rules) {
+                return true;
+            }
+            if (!verdict->matched) {
+                return false;
+            }
+            
+            char message[MAX_MESSAGE_LEN];
+            va_list copy;
+            va_copy(copy, ap);
+            vsnprintf(message, sizeof(message), event->fmt, copy);
+            va_end(copy);
+            for (int i = 0; i < filter->count; i++) {
+                if ((verdict->matched & (1u << i)) && strstr(message, filter->rules[i].text_substring)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /// Add a drop rule to an output.
+        ///
+        /// A rule is a list of terms separated by spaces. An event that
+        /// matches every term of any rule never reaches the output. Rules
+        /// are parsed once here. Each output caches which rules a call site
+        /// (format string, file, function, line and level) matches, so dropping a
+        /// message costs one lookup and it is never formatted.
+        ///
+        /// Terms: `level<=DEBUG` (also `<`, `=`, `>=`, `>`), `file=GLOB`,
+        /// `function=GLOB`, `format^=PREFIX` and `format*=SUBSTRING` on the
+        /// format string. `text*=SUBSTRING` matches the formatted message
+        /// and so formats every event the other terms let through. Values
+        /// with spaces go in double quotes.
+        ///
+        /// __Parameters__
+        ///
+        /// - `output`: Output index from `logger_find_output`
+        /// - `rule`: Rule text, e.g. `"format^=heartbeat level<=INFO"`
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on an invalid output or rule, or when the output has MAX_OUTPUT_FILTERS rules
+        int logger_add_output_filter(int output, const char *rule) {
+            filter_rule_t compiled;
+            if (output < 0 || output >= MAX_OUTPUTS || !rule || filter_compile(&compiled, rule) != 0) {
+                return -1;
+            }
+            
+            lock_logger();
+            
+            output_handler_t *out = &logger_state.outputs[output];
+            if (!out->active) {
+                unlock_logger();
+                free(compiled.spec);
+                return -1;
+            }
+            if (!out->filter) {
+                out->filter = calloc(1, sizeof(*out->filter));
+            }
+            if (!out->filter || out->filter->count >= MAX_OUTPUT_FILTERS) {
+                unlock_logger();
+                free(compiled.spec);
+                return -1;
+            }
+            
+            output_filter_t *filter = out->filter;
+            if (compiled.text_substring) {
+                filter->text_rules |= 1u << filter->count;
+            }
+            filter->rules[filter->count++] = compiled;
+            /* Cached verdicts do not know the new rule */
+            memset(filter->verdicts, 0, sizeof(filter->verdicts));
+            
+            unlock_logger();
+            return 0;
+        }
+
+        /// Remove every drop rule of an output.
+        ///
+        /// __Parameters__
+        ///
+        /// - `output`: Output index from `logger_find_output`
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on an invalid output
+        int logger_clear_output_filters(int output) {
+            if (output < 0 || output >= MAX_OUTPUTS) {
+                return -1;
+            }
+            
+            lock_logger();
+            output_handler_t *out = &logger_state.outputs[output];
+            output_filter_t *filter = out->active ? out->filter : NULL;
+            bool active = out->active;
+            out->filter = NULL;
+            unlock_logger();
+            
+            if (filter) {
+                filter_free(filter);
+            }
+            return active ? 0 : -1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── CATEGORIES ────────────────────────────┐
+
+        /* Look up a category by exact name, caller holds the lock */
+        static int find_category(const char *name, size_t len) {
+            for (int i = 1; i < category_registry.count; i++) {
+                const char *candidate = category_registry.categories[i].name;
+                if (strncmp(candidate, name, len) == 0 && candidate[len] == '\0') {
+                    return i;
+                }
+            }
+            return len == 0 ? 0 : -1;
+        }
+
+        /* Look up or create a category and its parents, caller holds the lock */
+        static int intern_category(const char *name) {
+            size_t len = strlen(name);
+            int parent = 0;
+            
+            if (len >= LOGGER_CATEGORY_NAME_MAX) {
+                return -1;
+            }
+            
+            /* Walk "a", "a.b", "a.b.c" so every ancestor exists */
+            for (size_t end = 0; end <= len; end++) {
+                if (name[end] != '.' && name[end] != '\0') {
+                    continue;
+                }
+                
+                int index = find_category(name, end);
+                if (index < 0) {
+                    if (category_registry.count >= MAX_CATEGORIES) {
+                        return -1;
+                    }
+                    index = category_registry.count;
+                    log_category_t *cat = &category_registry.categories[index];
+                    memcpy(cat->name, name, end);
+                    cat->name[end] = '\0';
+                    cat->parent = parent;
+                    cat->level = -1;
+                    cat->effective_level = category_registry.categories[parent].effective_level;
+                    category_registry.count++;
+                }
+                parent = index;
+            }
+            return parent;
+        }
+
+        /// Get a named log category.
+        ///
+        /// Category names are dot-separated paths such as `net.http`. A
+        /// category without an explicit level inherits its parent's, and
+        /// top-level categories inherit the global level. Missing parents are
+        /// created on the way. Handles stay valid for the life of the process.
+        ///
+        /// __Parameters__
+        ///
+        /// - `name`: Dot-separated category name
+        ///
+        /// __Return__
+        ///
+        /// - Category handle; the root category if the name is too long or
+        ///   the registry is full
+        log_category_t *logger_category(const char *name) {
+            int index;
+            
+            if (!name) {
+                return &category_registry.categories[0];
+            }
+            
+            lock_logger();
+            index = intern_category(name);
+            unlock_logger();
+            
+            return &category_registry.categories[index < 0 ? 0 : index];
+        }
+
+        /// Set the level of a category and everything below it.
+        ///
+        /// Descendants without their own explicit level pick up the new level
+        /// right away.
+        ///
+        /// __Parameters__
+        ///
+        /// - `name`: Dot-separated category name
+        /// - `level`: Minimum log level for the category
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on invalid name or full registry
+        int logger_set_category_level(const char *name, log_level_t level) {
+            if (!name || !*name) {
+                return -1;
+            }
+            
+            lock_logger();
+            
+            int index = intern_category(name);
+            if (index < 0) {
+                unlock_logger();
+                return -1;
+            }
+            category_registry.categories[index].level = (int)level;
+            resolve_categories();
+            
+            unlock_logger();
+            return 0;
+        }
+
+        /// Remove the explicit level of a category.
+        ///
+        /// The category goes back to inheriting its parent's level.
+        ///
+        /// __Parameters__
+        ///
+        /// - `name`: Dot-separated category name
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 if the category does not exist
+        int logger_clear_category_level(const char *name) {
+            if (!name || !*name) {
+                return -1;
+            }
+            
+            lock_logger();
+            
+            int index = find_category(name, strlen(name));
+            if (index <= 0) {
+                unlock_logger();
+                return -1;
+            }
+            category_registry.categories[index].level = -1;
+            resolve_categories();
+            
+            unlock_logger();
+            return 0;
+        }
+
+        /* Resolve every effective level, caller holds the lock; parents sit before their children */
+        static void resolve_categories(void) {
+            for (int i = 0; i < category_registry.count; i++) {
+                log_category_t *cat = &category_registry.categories[i];
+                int level = cat->level;
+                if (level < 0) {
+                    level = cat->parent >= 0 ? (int)category_registry.categories[cat->parent].effective_level
+                                             : (int)logger_state.config.level;
+                }
+                __atomic_store_n(&cat->effective_level, (log_level_t)level, __ATOMIC_RELAXED);
+            }
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── CONFIGURATION FILE ────────────────────────────┐
+
+        /* Bits of config_snapshot_t.set_mask */
+        enum {
+            CONFIG_SET_LEVEL          = 1 << 0,
+            CONFIG_SET_QUIET          = 1 << 1,
+            CONFIG_SET_COLORS         = 1 << 2,
+            CONFIG_SET_SHOW_FILE_LINE = 1 << 3,
+            CONFIG_SET_SHOW_FUNCTION  = 1 << 4,
+            CONFIG_SET_COALESCE       = 1 << 5,
+            CONFIG_SET_SHOW_CONTEXT   = 1 << 6
+        };
+
+        /* Close files a snapshot opened and free it */
+        static void release_config(config_snapshot_t *config) {
+            if (!config) {
+                return;
+            }
+            for (int i = 0; i < config->output_count; i++) {
+                if (config->outputs[i].file) {
+                    fclose(config->outputs[i].file);
+                }
+            }
+            free(config);
+        }
+
+        /* Strip leading and trailing whitespace in place */
+        static char *trim(char *str) {
+            while (*str == ' ' || *str == '\t') {
+                str++;
+            }
+            char *end = str + strlen(str);
+            while (end > str && (end[-1] == ' ' || end[-1] == '\t' ||
+                                 end[-1] == '\n' || end[-1] == '\r')) {
+                *--end = '\0';
+            }
+            return str;
+        }
+
+        /* Strict level parser, unlike logger_string_to_level */
+        static bool parse_level(const char *str, log_level_t *level) {
+            for (int i = 0; i < 6; i++) {
+                if (strcasecmp(str, level_strings[i]) == 0) {
+                    *level = (log_level_t)i;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static bool parse_bool(const char *str, bool *value) {
+            if (strcasecmp(str, "true") == 0 || strcasecmp(str, "on") == 0 || strcmp(str, "1") == 0) {
+                *value = true;
+                return true;
+            }
+            if (strcasecmp(str, "false") == 0 || strcasecmp(str, "off") == 0 || strcmp(str, "0") == 0) {
+                *value = false;
+                return true;
+            }
+            return false;
+        }
+
+        /* Parse one `key = value` line into the snapshot */
+        static const char *parse_config_line(config_snapshot_t *config, char *key, char *value) {
+            bool flag;
+            
+            if (strcmp(key, "level") == 0) {
+                if (!parse_level(value, &config->level)) return "unknown level";
+                config->set_mask |= CONFIG_SET_LEVEL;
+            } else if (strcmp(key, "quiet") == 0) {
+                if (!parse_bool(value, &flag)) return "expected true or false";
+                config->quiet = flag;
+                config->set_mask |= CONFIG_SET_QUIET;
+            } else if (strcmp(key, "colors") == 0) {
+                if (!parse_bool(value, &flag)) return "expected true or false";
+                config->use_colors = flag;
+                config->set_mask |= CONFIG_SET_COLORS;
+            } else if (strcmp(key, "show_file_line") == 0) {
+                if (!parse_bool(value, &flag)) return "expected true or false";
+                config->show_file_line = flag;
+                config->set_mask |= CONFIG_SET_SHOW_FILE_LINE;
+            } else if (strcmp(key, "show_function") == 0) {
+                if (!parse_bool(value, &flag)) return "expected true or false";
+                config->show_function = flag;
+                config->set_mask |= CONFIG_SET_SHOW_FUNCTION;
+            } else if (strcmp(key, "show_context") == 0) {
+                if (!parse_bool(value, &flag)) return "expected true or false";
+                config->show_context = flag;
+                config->set_mask |= CONFIG_SET_SHOW_CONTEXT;
+            } else if (strcmp(key, "coalesce_ms") == 0) {
+                char *end;
+                unsigned long ms = strtoul(value, &end, 10);
+                if (*value == '\0' || *end != '\0' || ms > UINT_MAX) return "expected milliseconds";
+                config->coalesce_ms = (unsigned)ms;
+                config->set_mask |= CONFIG_SET_COALESCE;
+            } else if (strncmp(key, "category.", 9) == 0) {
+                const char *name = key + 9;
+                if (!*name || strlen(name) >= LOGGER_CATEGORY_NAME_MAX) return "invalid category name";
+                if (config->category_count >= MAX_CATEGORIES) return "too many categories";
+                int i = config->category_count;
+                if (!parse_level(value, &config->categories[i].level)) return "unknown level";
+                strcpy(config->categories[i].name, name);
+                config->category_count++;
+            } else if (strcmp(key, "output") == 0) {
+                /* output = console LEVEL | output = file PATH LEVEL | output = json PATH LEVEL */
+                if (config->output_count >= MAX_OUTPUTS) return "too many outputs";
+                config_output_t *out = &config->outputs[config->output_count];
+                char *kind = strtok(value, " \t");
+                char *arg1 = strtok(NULL, " \t");
+                char *arg2 = strtok(NULL, " \t");
+                if (!kind || !arg1) return "expected output kind and level";
+                if (strcmp(kind, "console") == 0 && !arg2) {
+                    if (!parse_level(arg1, &out->level)) return "unknown level";
+                } else if ((strcmp(kind, "file") == 0 || strcmp(kind, "json") == 0) && arg2) {
+                    if (!parse_level(arg2, &out->level)) return "unknown level";
+                    if (strlen(arg1) >= sizeof(out->path)) return "path too long";
+                    strcpy(out->path, arg1);
+                    out->json = kind[0] == 'j';
+                } else {
+                    return "unknown output";
+                }
+                out->slot = -1;
+                config->output_count++;
+            } else {
+                return "unknown key";
+            }
+            return NULL;
+        }
+
+        /* Parse a whole file; NULL with `error` filled on failure */
+        static config_snapshot_t *parse_config(const char *path, char *error, size_t error_size) {
+            FILE *file = fopen(path, "r");
+            if (!file) {
+                snprintf(error, error_size, "%s: %s", path, strerror(errno));
+                return NULL;
+            }
+            
+            config_snapshot_t *config = calloc(1, sizeof(*config));
+            if (!config) {
+                fclose(file);
+                snprintf(error, error_size, "%s: out of memory", path);
+                return NULL;
+            }
+            
+            char buf[PATH_MAX + 128];
+            int line_no = 0;
+            const char *problem = NULL;
+            
+            while (!problem && fgets(buf, sizeof(buf), file)) {
+                line_no++;
+                char *line = trim(buf);
+                if (*line == '\0' || *line == '#') {
+                    continue;
+                }
+                char *eq = strchr(line, '=');
+                if (!eq) {
+                    problem = "expected key = value";
+                    break;
+                }
+                *eq = '\0';
+                problem = parse_config_line(config, trim(line), trim(eq + 1));
+            }
+            fclose(file);
+            
+            /* Open every file up front so a bad path rejects the whole reload */
+            for (int i = 0; !problem && i < config->output_count; i++) {
+                config_output_t *out = &config->outputs[i];
+                if (out->path[0] && !(out->file = fopen(out->path, "a"))) {
+                    snprintf(error, error_size, "%s: %s: %s", path, out->path, strerror(errno));
+                    release_config(config);
+                    return NULL;
+                }
+            }
+            
+            if (problem) {
+                snprintf(error, error_size, "%s:%d: %s", path, line_no, problem);
+                release_config(config);
+                return NULL;
+            }
+            return config;
+        }
+
+        /* Whether a slot still holds the output a snapshot added there */
+        static bool config_owns_slot(const config_output_t *out) {
+            const output_handler_t *handler = out->slot >= 0 ? &logger_state.outputs[out->slot] : NULL;
+            log_output_fn_t fn = !out->file ? logger_console_output : out->json ? logger_json_output : logger_file_output;
+            return handler && handler->active && handler->output_fn == fn &&
+                   handler->user_data == (out->file ? (void*)out->file : (void*)stderr);
+        }
+
+        /* Swap in a parsed snapshot in one critical section; -1 leaves everything as it was */
+        static int apply_config(config_snapshot_t *config) {
+            lock_logger();
+            
+            config_snapshot_t *previous = logger_state.file_config;
+            
+            /* The new outputs must fit in the free slots plus the ones the previous file gives back */
+            int free_slots = 0;
+            for (int slot = 0; slot < MAX_OUTPUTS; slot++) {
+                free_slots += !logger_state.outputs[slot].active;
+            }
+            for (int i = 0; previous && i < previous->output_count; i++) {
+                free_slots += config_owns_slot(&previous->outputs[i]);
+            }
+            if (free_slots < config->output_count) {
+                unlock_logger();
+                return -1;
+            }
+            
+            /* Drop what the previous file declared; slots since reused by the caller are left alone */
+            if (previous) {
+                for (int i = 0; i < previous->output_count; i++) {
+                    if (config_owns_slot(&previous->outputs[i])) {
+                        release_output(&logger_state.outputs[previous->outputs[i].slot]);
+                    }
+                }
+                for (int i = 0; i < previous->category_count; i++) {
+                    const char *name = previous->categories[i].name;
+                    int index = find_category(name, strlen(name));
+                    if (index > 0) {
+                        category_registry.categories[index].level = -1;
+                    }
+                }
+            }
+            
+            if (config->set_mask & CONFIG_SET_LEVEL) {
+                __atomic_store_n(&logger_state.config.level, config->level, __ATOMIC_RELAXED);
+            }
+            if (config->set_mask & CONFIG_SET_QUIET) {
+                __atomic_store_n(&logger_state.config.quiet, config->quiet, __ATOMIC_RELAXED);
+            }
+            if (config->set_mask & CONFIG_SET_COLORS) {
+                logger_state.config.use_colors = config->use_colors;
+            }
+            if (config->set_mask & CONFIG_SET_SHOW_FILE_LINE) {
+                logger_state.config.show_file_line = config->show_file_line;
+            }
+            if (config->set_mask & CONFIG_SET_SHOW_FUNCTION) {
+                logger_state.config.show_function = config->show_function;
+            }
+            if (config->set_mask & CONFIG_SET_SHOW_CONTEXT) {
+                logger_state.config.show_context = config->show_context;
+            }
+            if (config->set_mask & CONFIG_SET_COALESCE) {
+                coalesce_sweep(true);
+                logger_state.coalesce_window_ms = config->coalesce_ms;
+            }
+            
+            for (int i = 0; i < config->category_count; i++) {
+                int index = intern_category(config->categories[i].name);
+                if (index > 0) {
+                    category_registry.categories[index].level = (int)config->categories[i].level;
+                }
+            }
+            
+            for (int i = 0; i < config->output_count; i++) {
+                config_output_t *out = &config->outputs[i];
+                for (int slot = 0; slot < MAX_OUTPUTS; slot++) {
+                    if (!logger_state.outputs[slot].active) {
+                        logger_state.outputs[slot].output_fn = !out->file ? logger_console_output :
+                                                               out->json ? logger_json_output : logger_file_output;
+                        logger_state.outputs[slot].user_data = out->file ? (void*)out->file : (void*)stderr;
+                        logger_state.outputs[slot].min_level = out->level;
+                        logger_state.outputs[slot].active = true;
+                        pool_attach_stream(out->file, slot);
+                        out->slot = slot;
+                        break;
+                    }
+                }
+            }
+            
+            __atomic_store_n(&logger_state.file_config, config, __ATOMIC_RELEASE);
+            resolve_categories();
+            
+            unlock_logger();
+            
+            if (config->set_mask & CONFIG_SET_COALESCE) {
+                coalesce_tick(config->coalesce_ms);
+            }
+            
+            /* No output references the old files any more */
+            release_config(previous);
+            return 0;
+        }
+
+        /// Load levels, categories and outputs from a configuration file.
+        ///
+        /// The file holds `key = value` lines; `#` starts a comment. Known keys
+        /// are `level`, `quiet`, `colors`, `show_file_line`, `show_function`,
+        /// `show_context`, `coalesce_ms`, `category.<name>` and `output`
+        /// (`console LEVEL`, `file PATH LEVEL` or `json PATH LEVEL`). The file is parsed and its outputs opened before
+        /// anything changes, so an invalid file leaves the running
+        /// configuration untouched. Loading again replaces the categories and
+        /// outputs the previous file declared, except outputs the caller has
+        /// removed since; a file whose outputs do not fit in the free slots
+        /// is refused. Files of replaced outputs are closed, so loading while
+        /// other threads log needs a lock installed with `logger_set_lock`.
+        ///
+        /// __Parameters__
+        ///
+        /// - `path`: Configuration file to read
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on failure (see `logger_config_error`)
+        int logger_load_config(const char *path) {
+            char error[MAX_CONFIG_ERROR];
+            
+            if (!path) {
+                return -1;
+            }
+            if (!logger_state.initialized) {
+                logger_init();
+            }
+            
+            config_snapshot_t *config = parse_config(path, error, sizeof(error));
+            if (!config) {
+                lock_logger();
+                memcpy(config_watch.error, error, sizeof(error));
+                unlock_logger();
+                return -1;
+            }
+            
+            if (apply_config(config) != 0) {
+                lock_logger();
+                snprintf(config_watch.error, sizeof(config_watch.error), "%s: no free slot for %d outputs",
+                         path, config->output_count);
+                unlock_logger();
+                release_config(config);
+                return -1;
+            }
+            return 0;
+        }
+
+        /// Get the error from the last failed configuration load.
+        ///
+        /// __Return__
+        ///
+        /// - Message of the form `path:line: problem`, empty if none failed
+        const char *logger_config_error(void) {
+            return config_watch.error;
+        }
+
+        /* Watcher thread: reload whenever the file is rewritten or replaced */
+        static void *config_watch_main(void *arg) {
+            int fd = (int)(intptr_t)arg;
+            char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+            const char *base = strrchr(config_watch.path, '/');
+            base = base ? base + 1 : config_watch.path;
+            
+            struct pollfd fds[2] = {
+                { .fd = fd, .events = POLLIN },
+                { .fd = config_watch.wake_pipe[0], .events = POLLIN }
+            };
+            
+            while (poll(fds, 2, -1) >= 0 || errno == EINTR) {
+                if (fds[1].revents) {
+                    break;
+                }
+                if (!(fds[0].revents & POLLIN)) {
+                    continue;
+                }
+                
+                ssize_t len = read(fd, events, sizeof(events));
+                bool changed = false;
+                for (ssize_t off = 0; off < len; ) {
+                    const struct inotify_event *ev = (const struct inotify_event*)(events + off);
+                    if (ev->len && strcmp(ev->name, base) == 0) {
+                        changed = true;
+                    }
+                    off += (ssize_t)(sizeof(*ev) + ev->len);
+                }
+                
+                if (changed && logger_load_config(config_watch.path) != 0) {
+                    log_error("config reload failed, keeping previous configuration: %s",
+                              logger_config_error());
+                }
+            }
+            
+            close(fd);
+            return NULL;
+        }
+
+        /// Watch a configuration file and apply edits live.
+        ///
+        /// Loads the file once, then reloads it from a background thread each
+        /// time it is written or replaced (editors that save via rename are
+        /// covered). A reload that fails is logged and the previous
+        /// configuration stays in place.
+        ///
+        /// A reload replaces outputs and closes the files they wrote to
+        /// while other threads may be logging, so a lock must be installed
+        /// with `logger_set_lock` first. The watch is set up before the
+        /// first load, so a failed call leaves the configuration unchanged.
+        ///
+        /// __Parameters__
+        ///
+        /// - `path`: Configuration file to watch
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on failure (no lock, watch setup or initial load)
+        int logger_watch_config(const char *path) {
+            char dir[PATH_MAX];
+            
+            if (!path || strlen(path) >= sizeof(config_watch.path) || config_watch.running ||
+                !logger_state.config.lock_fn) {
+                return -1;
+            }
+            
+            strcpy(config_watch.path, path);
+            strcpy(dir, path);
+            char *slash = strrchr(dir, '/');
+            if (slash == dir) {
+                dir[1] = '\0';
+            } else if (slash) {
+                *slash = '\0';
+            } else {
+                strcpy(dir, ".");
+            }
+            
+            int inotify_fd = inotify_init1(IN_CLOEXEC);
+            if (inotify_fd < 0) {
+                return -1;
+            }
+            if (inotify_add_watch(inotify_fd, dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+                pipe(config_watch.wake_pipe) != 0) {
+                close(inotify_fd);
+                return -1;
+            }
+            
+            /* Nothing is applied until the watch is in place; edits made during the load are picked up after */
+            if (logger_load_config(path) != 0 ||
+                pthread_create(&config_watch.thread, NULL, config_watch_main, (void*)(intptr_t)inotify_fd) != 0) {
+                close(inotify_fd);
+                close(config_watch.wake_pipe[0]);
+                close(config_watch.wake_pipe[1]);
+                config_watch.wake_pipe[0] = config_watch.wake_pipe[1] = -1;
+                return -1;
+            }
+            
+            config_watch.running = true;
+            return 0;
+        }
+
+        /// Stop watching the configuration file.
+        ///
+        /// The configuration that is currently applied stays in effect.
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_unwatch_config(void) {
+            if (!config_watch.running) {
+                return;
+            }
+            
+            ssize_t ignored = write(config_watch.wake_pipe[1], "x", 1);
+            (void)ignored;
+            pthread_join(config_watch.thread, NULL);
+            
+            close(config_watch.wake_pipe[0]);
+            close(config_watch.wake_pipe[1]);
+            config_watch.wake_pipe[0] = config_watch.wake_pipe[1] = -1;
+            config_watch.running = false;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── CONTROL SOCKET ────────────────────────────┐
+
+        /* `file` names the site when it ends with `site` on a path boundary */
+        static bool control_site_matches(const char *site, int site_line, const char *file, int line) {
+            size_t site_len = strnlen(site, CONTROL_SITE_FILE_MAX);
+            size_t file_len = file ? strlen(file) : 0;
+            if ((site_line && site_line != line) || site_len == 0 || site_len > file_len) {
+                return false;
+            }
+            const char *tail = file + file_len - site_len;
+            return memcmp(tail, site, site_len) == 0 && (tail == file || tail[-1] == '/');
+        }
+
+        /// Check whether a call site was enabled below its level.
+        ///
+        /// Called through `logger_site_enabled`, which skips the call while
+        /// no site is enabled.
+        ///
+        /// __Parameters__
+        ///
+        /// - `file`: Source file of the call, as in `__FILE__`
+        /// - `line`: Line of the call
+        ///
+        /// __Return__
+        ///
+        /// - true if a site enabled with `logger_set_site_enabled` matches
+        bool logger_site_lookup(const char *file, int line) {
+            for (;;) {
+                uint32_t seq = __atomic_load_n(&control_sites.seq, __ATOMIC_ACQUIRE);
+                if (seq & 1) {
+                    continue;
+                }
+                bool found = false;
+                int count = __atomic_load_n(&control_sites.count, __ATOMIC_RELAXED);
+                for (int i = 0; i < count && !found; i++) {
+                    found = control_site_matches(control_sites.sites[i].file, control_sites.sites[i].line, file, line);
+                }
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&control_sites.seq, __ATOMIC_RELAXED) == seq) {
+                    return found;
+                }
+            }
+        }
+
+        /// Log one call site, or one file, below the global level.
+        ///
+        /// Meant for turning on the DEBUG lines of one spot in a running
+        /// process, usually through `loggin-ctl`. Works for plain, category
+        /// and C++ statements alike.
+        ///
+        /// __Parameters__
+        ///
+        /// - `file`: Source file as in `__FILE__`, or a trailing part of it such as `conn.c`
+        /// - `line`: Line of the call, or 0 for every line of the file
+        /// - `enabled`: true to enable the site, false to remove it
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on an invalid file, a full table or a site that is not enabled
+        int logger_set_site_enabled(const char *file, int line, bool enabled) {
+            if (!file || !*file || strlen(file) >= CONTROL_SITE_FILE_MAX || line < 0) {
+                return -1;
+            }
+            
+            pthread_mutex_lock(&control_sites.mutex);
+            int index = -1;
+            for (int i = 0; i < control_sites.count; i++) {
+                if (control_sites.sites[i].line == line && strcmp(control_sites.sites[i].file, file) == 0) {
+                    index = i;
+                }
+            }
+            int count = control_sites.count;
+            if ((enabled && index < 0 && count >= MAX_CONTROL_SITES) || (!enabled && index < 0)) {
+                pthread_mutex_unlock(&control_sites.mutex);
+                return -1;
+            }
+            
+            __atomic_store_n(&control_sites.seq, control_sites.seq + 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            if (enabled && index < 0) {
+                strcpy(control_sites.sites[count].file, file);
+                control_sites.sites[count].line = line;
+                count++;
+            } else if (!enabled) {
+                control_sites.sites[index] = control_sites.sites[--count];
+            }
+            __atomic_store_n(&control_sites.count, count, __ATOMIC_RELAXED);
+            __atomic_store_n(&control_sites.seq, control_sites.seq + 1, __ATOMIC_RELEASE);
+            __atomic_store_n(&logger_site_count, (unsigned)count, __ATOMIC_RELAXED);
+            
+            pthread_mutex_unlock(&control_sites.mutex);
+            return 0;
+        }
+
+        /* Append to a reply; text that does not fit is cut */
+        static void control_reply(char *reply, size_t *len, const char *fmt, ...) {
+            va_list ap;
+            va_start(ap, fmt);
+            int n = vsnprintf(reply + *len, CONTROL_REPLY_MAX - *len, fmt, ap);
+            va_end(ap);
+            *len += n > 0 ? (size_t)n : 0;
+            *len = *len < CONTROL_REPLY_MAX ? *len : CONTROL_REPLY_MAX - 1;
+        }
+
+        static const char *control_output_kind(const output_handler_t *out) {
+            if (out->output_fn == logger_console_output) return "console";
+            if (out->output_fn == logger_file_output) return "file";
+            if (out->output_fn == logger_json_output) return "json";
+            if (out->output_fn == logger_compressed_output) return "compressed";
+            if (out->output_fn == logger_tcp_output) return "tcp";
+            if (out->output_fn == logger_ring_output) return "ring";
+            return "custom";
+        }
+
+        static void control_list_outputs(char *reply, size_t *len) {
+            /* A hung output holds the lock, but then the table cannot change either */
+            bool locked = !__atomic_load_n(&watchdog_state.bypass, __ATOMIC_ACQUIRE);
+            if (locked) {
+                lock_logger();
+            }
+            for (int i = 0; i < MAX_OUTPUTS; i++) {
+                const output_handler_t *out = &logger_state.outputs[i];
+                if (!out->active) {
+                    continue;
+                }
+                control_reply(reply, len, "%d %s %s%s%s%s", i, control_output_kind(out), level_strings[out->min_level],
+                              __atomic_load_n(&out->degraded, __ATOMIC_ACQUIRE) ? " degraded" : "",
+                              out->layout ? " pattern" : "", out->no_coalesce ? " no-coalesce" : "");
+                if (out->filter) {
+                    control_reply(reply, len, " filters=%d", out->filter->count);
+                }
+                control_reply(reply, len, "\n");
+            }
+            if (locked) {
+                unlock_logger();
+            }
+        }
+
+        static void control_stats(char *reply, size_t *len) {
+            log_stats_t stats;
+            logger_get_stats(&stats);
+            control_reply(reply, len, "level %s\n", level_strings[logger_get_level()]);
+            control_reply(reply, len, "memory_budget %zu\n", stats.memory_budget);
+            control_reply(reply, len, "records_total %lu\n", stats.records_total);
+            control_reply(reply, len, "records_in_use %lu\n", stats.records_in_use);
+            control_reply(reply, len, "records_dropped %llu\n", stats.records_dropped);
+            control_reply(reply, len, "records_truncated %llu\n", stats.records_truncated);
+            control_reply(reply, len, "records_throttled %llu\n", stats.records_throttled);
+            control_reply(reply, len, "records_rerouted %llu\n", stats.records_rerouted);
+            control_reply(reply, len, "records_stall_dropped %llu\n", stats.records_stall_dropped);
+            control_reply(reply, len, "throttle_level %s\n", level_strings[logger_throttle_level()]);
+        }
+
+        /* Split FILE[:LINE]; a missing line means the whole file */
+        static bool control_parse_site(char *spec, int *line) {
+            char *colon = strrchr(spec, ':');
+            *line = 0;
+            if (colon) {
+                char *end;
+                long value = strtol(colon + 1, &end, 10);
+                if (*end || value <= 0 || value > INT_MAX) {
+                    return false;
+                }
+                *colon = '\0';
+                *line = (int)value;
+            }
+            return *spec != '\0';
+        }
+
+        /* Run one request line; the reply starts with "ok" or "error: ..." */
+        static void control_execute(char *request, char *reply, size_t *len) {
+            char *save = NULL;
+            char *words[4] = { NULL };
+            int count = 0;
+            for (char *word = strtok_r(request, " \t\r\n", &save); word; word = strtok_r(NULL, " \t\r\n", &save)) {
+                if (count == 4) {
+                    control_reply(reply, len, "error: too many arguments\n");
+                    return;
+                }
+                words[count++] = word;
+            }
+            
+            log_level_t level;
+            int line;
+            const char *command = count ? words[0] : "";
+            
+            if (strcmp(command, "level") == 0 && count == 1) {
+                control_reply(reply, len, "ok\n%s\n", level_strings[logger_get_level()]);
+            } else if (strcmp(command, "level") == 0 && count == 2 && parse_level(words[1], &level)) {
+                logger_set_level(level);
+                control_reply(reply, len, "ok\n");
+            } else if (strcmp(command, "category") == 0 && count == 3 && strcmp(words[2], "clear") == 0) {
+                if (logger_clear_category_level(words[1]) == 0) {
+                    control_reply(reply, len, "ok\n");
+                } else {
+                    control_reply(reply, len, "error: no category %s\n", words[1]);
+                }
+            } else if (strcmp(command, "category") == 0 && count == 3 && parse_level(words[2], &level)) {
+                if (logger_set_category_level(words[1], level) == 0) {
+                    control_reply(reply, len, "ok\n");
+                } else {
+                    control_reply(reply, len, "error: cannot set category %s\n", words[1]);
+                }
+            } else if (strcmp(command, "site") == 0 && count == 3 && (strcmp(words[1], "on") == 0 || strcmp(words[1], "off") == 0) &&
+                       control_parse_site(words[2], &line)) {
+                if (logger_set_site_enabled(words[2], line, words[1][1] == 'n') == 0) {
+                    control_reply(reply, len, "ok\n");
+                } else {
+                    control_reply(reply, len, "error: cannot turn %s site %s\n", words[1], words[2]);
+                }
+            } else if (strcmp(command, "sites") == 0 && count == 1) {
+                control_reply(reply, len, "ok\n");
+                pthread_mutex_lock(&control_sites.mutex);
+                for (int i = 0; i < control_sites.count; i++) {
+                    control_reply(reply, len, control_sites.sites[i].line ? "%s:%d\n" : "%s\n",
+                                  control_sites.sites[i].file, control_sites.sites[i].line);
+                }
+                pthread_mutex_unlock(&control_sites.mutex);
+            } else if (strcmp(command, "outputs") == 0 && count == 1) {
+                control_reply(reply, len, "ok\n");
+                control_list_outputs(reply, len);
+            } else if (strcmp(command, "stats") == 0 && count == 1) {
+                control_reply(reply, len, "ok\n");
+                control_stats(reply, len);
+            } else if (strcmp(command, "flush") == 0 && count == 1) {
+                logger_flush();
+                control_reply(reply, len, "ok\n");
+            } else {
+                control_reply(reply, len, "error: usage: level [LEVEL] | category NAME LEVEL|clear | "
+                                          "site on|off FILE[:LINE] | sites | outputs | stats | flush\n");
+            }
+        }
+
+        /* One request per connection; a client that stalls is dropped after a second */
+        static void control_serve_client(int fd) {
+            char request[CONTROL_REQUEST_MAX];
+            char reply[CONTROL_REPLY_MAX];
+            size_t used = 0;
+            size_t len = 0;
+            
+            while (used < sizeof(request) - 1 && !memchr(request, '\n', used)) {
+                struct pollfd pfd = { .fd = fd, .events = POLLIN };
+                if (poll(&pfd, 1, 1000) <= 0) {
+                    break;
+                }
+                ssize_t n = read(fd, request + used, sizeof(request) - 1 - used);
+                if (n <= 0) {
+                    break;
+                }
+                used += (size_t)n;
+            }
+            request[used] = '\0';
+            
+            control_execute(request, reply, &len);
+            for (size_t off = 0; off < len; ) {
+                ssize_t n = send(fd, reply + off, len - off, MSG_NOSIGNAL);
+                if (n <= 0) {
+                    break;
+                }
+                off += (size_t)n;
+            }
+            close(fd);
+        }
+
+        static void *control_main(void *arg) {
+            (void)arg;
+            struct pollfd fds[2] = {
+                { .fd = control_state.listen_fd, .events = POLLIN },
+                { .fd = control_state.wake_pipe[0], .events = POLLIN }
+            };
+            
+            while (poll(fds, 2, -1) >= 0 || errno == EINTR) {
+                if (fds[1].revents) {
+                    break;
+                }
+                if (fds[0].revents & POLLIN) {
+                    int fd = accept4(control_state.listen_fd, NULL, NULL, SOCK_CLOEXEC);
+                    if (fd >= 0) {
+                        control_serve_client(fd);
+                    }
+                }
+            }
+            return NULL;
+        }
+
+        /// Serve the control socket used by `loggin-ctl`.
+        ///
+        /// Creates a unix socket, readable and writable by the owner only,
+        /// and answers one text request per connection from a background
+        /// thread: read or set the level, set category levels, enable
+        /// single call sites below the level, list outputs and read
+        /// stats. Changes go through the same functions as the API, and
+        /// the logging path never polls for them.
+        ///
+        /// __Parameters__
+        ///
+        /// - `socket_path`: Path of the socket; an old socket file there is replaced
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 if already serving or the socket cannot be set up
+        int logger_serve_control(const char *socket_path) {
+            struct sockaddr_un addr = { .sun_family = AF_UNIX };
+            
+            if (!socket_path || strlen(socket_path) >= sizeof(addr.sun_path) || control_state.running) {
+                return -1;
+            }
+            strcpy(addr.sun_path, socket_path);
+            
+            int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (fd < 0) {
+                return -1;
+            }
+            unlink(socket_path);
+            if (fchmod(fd, 0600) != 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+                chmod(socket_path, 0600) != 0 || listen(fd, 8) != 0 || pipe(control_state.wake_pipe) != 0) {
+                close(fd);
+                unlink(socket_path);
+                return -1;
+            }
+            
+            strcpy(control_state.path, socket_path);
+            control_state.listen_fd = fd;
+            if (pthread_create(&control_state.thread, NULL, control_main, NULL) != 0) {
+                close(fd);
+                unlink(socket_path);
+                close(control_state.wake_pipe[0]);
+                close(control_state.wake_pipe[1]);
+                control_state.listen_fd = control_state.wake_pipe[0] = control_state.wake_pipe[1] = -1;
+                return -1;
+            }
+            
+            control_state.running = true;
+            return 0;
+        }
+
+        /// Stop serving the control socket and remove it.
+        ///
+        /// Levels and sites changed through the socket stay in effect.
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_stop_control(void) {
+            if (!control_state.running) {
+                return;
+            }
+            
+            ssize_t ignored = write(control_state.wake_pipe[1], "x", 1);
+            (void)ignored;
+            pthread_join(control_state.thread, NULL);
+            
+            close(control_state.listen_fd);
+            unlink(control_state.path);
+            close(control_state.wake_pipe[0]);
+            close(control_state.wake_pipe[1]);
+            control_state.listen_fd = control_state.wake_pipe[0] = control_state.wake_pipe[1] = -1;
+            control_state.running = false;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── UTILITY FUNCTIONS ────────────────────────────┐
+
+        /// Convert log level to string representation.
+        ///
+        /// Returns a human-readable string for the given log level.
+        ///
+        /// __Parameters__
+        ///
+        /// - `level`: Log level to convert
+        ///
+        /// __Return__
+        ///
+        /// - String representation of the level, or "UNKNOWN" for invalid levels
+        const char* logger_level_to_string(log_level_t level) {
+            if (level >= 0 && level < 6) {
+                return level_strings[level];
+            }
+            return "UNKNOWN";
+        }
+
+        /// Convert string to log level.
+        ///
+        /// Parses a string representation of a log level (case-insensitive).
+        ///
+        /// __Parameters__
+        ///
+        /// - `str`: String to parse (e.g., "INFO", "error", "WARN")
+        ///
+        /// __Return__
+        ///
+        /// - Corresponding log level, or LOG_LEVEL_INFO for invalid strings
+        log_level_t logger_string_to_level(const char *str) {
+            if (!str) return LOG_LEVEL_INFO;
+            
+            for (int i = 0; i < 6; i++) {
+                if (strcasecmp(str, level_strings[i]) == 0) {
+                    return (log_level_t)i;
+                }
+            }
+            return LOG_LEVEL_INFO;
+        }
+
+        /* Write `text` as a quoted JSON string, returns the bytes written */
+        static int write_json_string(FILE *file, const char *text) {
+            int written = 2;
+            fputc('"', file);
+            for (const unsigned char *p = (const unsigned char*)(text ? text : ""); *p; p++) {
+                if (*p == '"' || *p == '\\') {
+                    fputc('\\', file);
+                    fputc(*p, file);
+                    written += 2;
+                } else if (*p < 0x20) {
+                    fprintf(file, "\\u%04x", *p);
+                    written += 6;
+                } else {
+                    fputc(*p, file);
+                    written++;
+                }
+            }
+            fputc('"', file);
+            return written;
+        }
+
+        /* Monotonic nanoseconds for span calibration */
+        static int64_t monotonic_ns(void) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── CLOCK ────────────────────────────┐
+
+        /* Wall-clock ns for an event: TSC conversion when enabled, clock_gettime otherwise */
+        static int64_t clock_now_ns(void) {
+#if defined(__x86_64__)
+            while (__atomic_load_n(&tsc_clock.enabled, __ATOMIC_RELAXED)) {
+                uint32_t seq = __atomic_load_n(&tsc_clock.seq, __ATOMIC_ACQUIRE);
+                if (seq & 1) {
+                    continue;
+                }
+                uint64_t base_tsc = __atomic_load_n(&tsc_clock.base_tsc, __ATOMIC_RELAXED);
+                int64_t base_ns = __atomic_load_n(&tsc_clock.base_ns, __ATOMIC_RELAXED);
+                uint64_t mult = __atomic_load_n(&tsc_clock.mult, __ATOMIC_RELAXED);
+                uint64_t tsc = __builtin_ia32_rdtsc();
+                __atomic_thread_fence(__ATOMIC_ACQUIRE);
+                if (__atomic_load_n(&tsc_clock.seq, __ATOMIC_RELAXED) == seq) {
+                    /* Another core may read slightly behind the base, hence signed */
+                    return base_ns + (int64_t)(((__int128)(int64_t)(tsc - base_tsc) * (__int128)mult) >> 32);
+                }
+            }
+#endif
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+        }
+
+        /* localtime_r once per second per thread, copied out for every event */
+        static struct tm *event_time(int64_t timestamp_ns, struct tm *tm_buf) {
+            time_t second = (time_t)(timestamp_ns / 1000000000);
+            if (!tm_cache.valid || tm_cache.second != second) {
+                localtime_r(&second, &tm_cache.tm);
+                tm_cache.second = second;
+                tm_cache.valid = true;
+            }
+            *tm_buf = tm_cache.tm;
+            return tm_buf;
+        }
+
+#if defined(__x86_64__)
+
+        /* Constant rate across P-states and running through C-states (CPUID 8000_0007h EDX bit 8) */
+        static bool tsc_invariant(void) {
+            unsigned eax, ebx, ecx, edx;
+            if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+                return false;
+            }
+            __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+            return (edx & (1u << 8)) != 0;
+        }
+
+        /* Read the TSC between two clock reads and keep the tightest of a few tries */
+        static void tsc_sample(uint64_t *tsc, int64_t *mono_ns, int64_t *real_ns) {
+            int64_t best = INT64_MAX;
+            for (int i = 0; i < 3; i++) {
+                struct timespec real;
+                int64_t before = monotonic_ns();
+                uint64_t ticks = __builtin_ia32_rdtsc();
+                clock_gettime(CLOCK_REALTIME, &real);
+                int64_t after = monotonic_ns();
+                if (after - before < best) {
+                    best = after - before;
+                    *tsc = ticks;
+                    *mono_ns = before + (after - before) / 2;
+                    *real_ns = (int64_t)real.tv_sec * 1000000000 + real.tv_nsec;
+                }
+            }
+        }
+
+        static void tsc_publish(uint64_t base_tsc, int64_t base_ns, double ns_per_tick) {
+            uint32_t seq = tsc_clock.seq;
+            __atomic_store_n(&tsc_clock.seq, seq + 1, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            __atomic_store_n(&tsc_clock.base_tsc, base_tsc, __ATOMIC_RELAXED);
+            __atomic_store_n(&tsc_clock.base_ns, base_ns, __ATOMIC_RELAXED);
+            __atomic_store_n(&tsc_clock.mult, (uint64_t)(ns_per_tick * 4294967296.0), __ATOMIC_RELAXED);
+            __atomic_store_n(&tsc_clock.seq, seq + 2, __ATOMIC_RELEASE);
+        }
+
+#endif
+
+        /* Re-measure the tick rate and steer the conversion back onto the wall clock */
+        static void tsc_calibrate(void) {
+#if defined(__x86_64__)
+            uint64_t tsc;
+            int64_t mono_ns, real_ns;
+            tsc_sample(&tsc, &mono_ns, &real_ns);
+            if (tsc <= tsc_clock.last_tsc) {
+                return;
+            }
+            
+            double ns_per_tick = (double)(mono_ns - tsc_clock.last_mono_ns) / (double)(tsc - tsc_clock.last_tsc);
+            int64_t current = tsc_clock.base_ns +
+                              (int64_t)(((__int128)(int64_t)(tsc - tsc_clock.base_tsc) * (__int128)tsc_clock.mult) >> 32);
+            int64_t error = real_ns - current;
+            
+            if (error > 1000000 || error < -1000000) {
+                /* Wall clock was stepped, follow it */
+                tsc_publish(tsc, real_ns, ns_per_tick);
+            } else {
+                /* Stay continuous and absorb the error over the next period */
+                tsc_publish(tsc, current, ns_per_tick * (1.0 + (double)error / TSC_CALIBRATION_NS));
+            }
+            tsc_clock.last_tsc = tsc;
+            tsc_clock.last_mono_ns = mono_ns;
+#endif
+        }
+
+        /// Take event timestamps from the CPU timestamp counter.
+        ///
+        /// Replaces the `clock_gettime` call per event with a TSC read,
+        /// converted to wall time through a calibration the background
+        /// ticker refreshes every second. Only available on x86-64 CPUs
+        /// with an invariant TSC; enabling spends ~2 ms measuring the rate.
+        ///
+        /// __Parameters__
+        ///
+        /// - `enabled`: true to use the TSC, false for `clock_gettime`
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 if the CPU has no invariant TSC
+        int logger_set_tsc_clock(bool enabled) {
+            if (!enabled) {
+                __atomic_store_n(&tsc_clock.enabled, false, __ATOMIC_RELAXED);
+                pthread_mutex_lock(&ticker_state.mutex);
+                ticker_state.calibrate = false;
+                pthread_mutex_unlock(&ticker_state.mutex);
+                ticker_restart();
+                return 0;
+            }
+            
+#if defined(__x86_64__)
+            if (!tsc_invariant()) {
+                return -1;
+            }
+            
+            uint64_t tsc0, tsc1;
+            int64_t mono0, mono1, real0, real1;
+            tsc_sample(&tsc0, &mono0, &real0);
+            do {
+                tsc_sample(&tsc1, &mono1, &real1);
+            } while (mono1 - mono0 < 2000000 || tsc1 <= tsc0);
+            
+            pthread_mutex_lock(&ticker_state.mutex);
+            tsc_publish(tsc1, real1, (double)(mono1 - mono0) / (double)(tsc1 - tsc0));
+            tsc_clock.last_tsc = tsc1;
+            tsc_clock.last_mono_ns = mono1;
+            __atomic_store_n(&tsc_clock.enabled, true, __ATOMIC_RELEASE);
+            ticker_state.calibrate = true;
+            pthread_mutex_unlock(&ticker_state.mutex);
+            
+            return ticker_restart();
+#else
+            return -1;
+#endif
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── THREAD CONTEXT ────────────────────────────┐
+
+        /* A forked child keeps the parent's TLS, so its cached id must go */
+        static void thread_context_forget_tid(void) {
+            thread_context.tid = 0;
+        }
+
+        static void thread_context_setup(void) {
+            pthread_atfork(NULL, NULL, thread_context_forget_tid);
+        }
+
+        /// Kernel id of the calling thread.
+        ///
+        /// The id is looked up once per thread and cached in thread-local
+        /// storage, so events pay a TLS read rather than a system call.
+        ///
+        /// __Return__
+        ///
+        /// - Thread id as shown by `ps -L` and `top -H`
+        int logger_thread_id(void) {
+            if (__builtin_expect(thread_context.tid == 0, 0)) {
+                pthread_once(&thread_context_once, thread_context_setup);
+                thread_context.tid = (int)syscall(SYS_gettid);
+            }
+            return thread_context.tid;
+        }
+
+        /// Name the calling thread in log output.
+        ///
+        /// Also sets the kernel thread name, which is cut to 15 characters,
+        /// so debuggers and `top` agree with the log. Threads that never call
+        /// this show the name they were given with `pthread_setname_np`.
+        ///
+        /// __Parameters__
+        ///
+        /// - `name`: Thread name, NULL or empty to show none
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_set_thread_name(const char *name) {
+            size_t len = name ? strnlen(name, LOGGER_THREAD_NAME_MAX - 1) : 0;
+            memcpy(thread_context.name, name ? name : "", len);
+            thread_context.name[len] = '\0';
+            thread_context.named = true;
+            if (len) {
+                pthread_setname_np(pthread_self(), thread_context.name);
+            }
+        }
+
+        /// Attach a key/value field to every event of the calling thread.
+        ///
+        /// Fields live in fixed thread-local slots, so setting and clearing
+        /// them never allocates. Setting an existing key replaces its value;
+        /// values longer than the slot are truncated.
+        ///
+        /// __Parameters__
+        ///
+        /// - `key`: Field name, shorter than `LOGGER_CONTEXT_KEY_MAX`
+        /// - `value`: Field value, NULL to clear the field
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on an invalid key or when all slots are taken
+        int logger_context_set(const char *key, const char *value) {
+            if (!key || !*key || strlen(key) >= LOGGER_CONTEXT_KEY_MAX) {
+                return -1;
+            }
+            if (!value) {
+                logger_context_clear(key);
+                return 0;
+            }
+            
+            int i = 0;
+            while (i < thread_context.count && strcmp(thread_context.fields[i].key, key) != 0) {
+                i++;
+            }
+            if (i == LOGGER_CONTEXT_MAX) {
+                return -1;
+            }
+            
+            log_context_field_t *field = &thread_context.fields[i];
+            size_t len = strnlen(value, LOGGER_CONTEXT_VALUE_MAX - 1);
+            memcpy(field->value, value, len);
+            field->value[len] = '\0';
+            if (i == thread_context.count) {
+                strcpy(field->key, key);
+                thread_context.count++;
+            }
+            return 0;
+        }
+
+        /// Remove a field from the calling thread's context.
+        ///
+        /// __Parameters__
+        ///
+        /// - `key`: Field to remove, NULL to remove every field
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_context_clear(const char *key) {
+            if (!key) {
+                thread_context.count = 0;
+                return;
+            }
+            
+            for (int i = 0; i < thread_context.count; i++) {
+                if (strcmp(thread_context.fields[i].key, key) == 0) {
+                    /* Keep the remaining fields in the order they were set */
+                    memmove(&thread_context.fields[i], &thread_context.fields[i + 1],
+                            (size_t)(thread_context.count - i - 1) * sizeof(thread_context.fields[0]));
+                    thread_context.count--;
+                    return;
+                }
+            }
+        }
+
+        /* Point an event at the calling thread's id, name and fields */
+        static const char *thread_context_name(void) {
+            if (__builtin_expect(!thread_context.named, 0)) {
+                pthread_getname_np(pthread_self(), thread_context.name, sizeof(thread_context.name));
+                thread_context.named = true;
+            }
+            return thread_context.name[0] ? thread_context.name : NULL;
+        }
+
+        static void attach_context(log_event_t *event) {
+            event->thread_id = logger_thread_id();
+            event->thread_name = thread_context_name();
+            event->context = thread_context.fields;
+            event->context_count = thread_context.count;
+        }
+
+        /* Render " [tid name] key=value ..." for the text outputs */
+        static size_t render_context(char *buf, size_t size, const log_event_t *event) {
+            int len = snprintf(buf, size, event->thread_name ? "[%d %s]" : "[%d]",
+                               event->thread_id, event->thread_name);
+            for (int i = 0; i < event->context_count && len > 0 && (size_t)len < size; i++) {
+                len += snprintf(buf + len, size - (size_t)len, " %s=%s",
+                                event->context[i].key, event->context[i].value);
+            }
+            return len > 0 && (size_t)len < size ? (size_t)len : size - 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── MAIN LOGGING ────────────────────────────┐
+
+        /* Initialize event with current time */
+        static void init_event(log_event_t *event, struct tm *tm_buf, void *user_data) {
+            if (!event->time) {
+                event->timestamp_ns = clock_now_ns();
+                event->time = event_time(event->timestamp_ns, tm_buf);
+            }
+            event->user_data = user_data;
+        }
+
+        /* Hand an event to one output */
+        static void output_call(output_handler_t *out, log_event_t *event, struct tm *tm_buf, va_list ap) {
+            init_event(event, tm_buf, out->user_data);
+            uint64_t bytes_before = output_bytes_written;
+            va_copy(event->ap, ap);
+            if (out->layout) {
+                layout_output(out->layout, event);
+            } else {
+                out->output_fn(event);
+            }
+            va_end(event->ap);
+            
+            if (out->index) {
+                file_index_note(out->index, event, output_bytes_written - bytes_before);
+            }
+        }
+
+        /* Deliver an event to every output that accepts its level */
+        static void dispatch_event(log_event_t *event, int coalesce_mode, va_list ap) {
+            struct tm tm_buf;
+            
+            /* Records written by another thread carry their producer's context */
+            if (!event->thread_id) {
+                attach_context(event);
+            }
+            
+            for (int i = 0; i < MAX_OUTPUTS; i++) {
+                output_handler_t *out = &logger_state.outputs[i];
+                
+                if (!out->active || event->level < out->min_level) {
+                    continue;
+                }
+                if (out->filter && filter_drops(out->filter, event, ap)) {
+                    continue;
+                }
+                /* 1: only non-coalescing outputs, 2: only coalescing outputs */
+                if ((coalesce_mode == 1 && !out->no_coalesce) ||
+                    (coalesce_mode == 2 && out->no_coalesce)) {
+                    continue;
+                }
+                if (__atomic_load_n(&out->degraded, __ATOMIC_ACQUIRE)) {
+                    watchdog_reroute(i, event, ap);
+                    continue;
+                }
+                
+                /* The watchdog sees the same call number for too long when this call hangs */
+                bool watched = __atomic_load_n(&watchdog_state.stall_ms, __ATOMIC_RELAXED) != 0;
+                if (watched) {
+                    __atomic_store_n(&watchdog_state.call, (++watchdog_state.call_count << 8) | (uint64_t)(i + 1), __ATOMIC_RELEASE);
+                }
+                output_call(out, event, &tm_buf, ap);
+                if (watched) {
+                    __atomic_store_n(&watchdog_state.call, 0, __ATOMIC_RELEASE);
+                    /* Callers stop bypassing the lock before this thread goes on to the fallback */
+                    if (__atomic_load_n(&watchdog_state.bypass, __ATOMIC_ACQUIRE)) {
+                        pthread_mutex_lock(&watchdog_state.fallback_mutex);
+                        __atomic_store_n(&watchdog_state.bypass, false, __ATOMIC_RELEASE);
+                        pthread_mutex_unlock(&watchdog_state.fallback_mutex);
+                    }
+                }
+            }
+        }
+
+        /* Variadic shim so internally generated lines reach the outputs */
+        static void dispatch_line(log_event_t *event, int coalesce_mode, ...) {
+            va_list ap;
+            va_start(ap, coalesce_mode);
+            dispatch_event(event, coalesce_mode, ap);
+            va_end(ap);
+        }
+
+        /* Monotonic milliseconds for repeat windows */
+        static uint64_t monotonic_ms(void) {
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+        }
+
+        /* FNV-1a over a byte range */
+        static uint64_t hash_bytes(uint64_t h, const void *data, size_t len) {
+            const unsigned char *p = (const unsigned char*)data;
+            for (size_t i = 0; i < len; i++) {
+                h ^= p[i];
+                h *= 1099511628211ull;
+            }
+            return h;
+        }
+
+        /* Emit the summary line for a site's pending run, if any */
+        static void close_coalesce_run(coalesce_site_t *site) {
+            if (site->repeats == 0) {
+                return;
+            }
+            
+            log_event_t event = {
+                .fmt = "last message repeated %u times",
+                .file = site->file,
+                .function = site->function,
+                .line = site->line,
+                .level = site->level,
+                .time = NULL,
+                .user_data = NULL
+            };
+            dispatch_line(&event, 2, site->repeats);
+            site->repeats = 0;
+        }
+
+        /* Find or claim the repeat slot for a call site */
+        static coalesce_site_t *coalesce_site(const char *file, int line) {
+            uint64_t key = hash_bytes(14695981039346656037ull, &file, sizeof(file));
+            key = hash_bytes(key, &line, sizeof(line));
+            
+            for (unsigned probe = 0; probe < MAX_COALESCE_SITES; probe++) {
+                coalesce_site_t *site = &logger_state.coalesce_sites[(key + probe) % MAX_COALESCE_SITES];
+                if (!site->used) {
+                    site->used = true;
+                    site->file = file;
+                    site->line = line;
+                    return site;
+                }
+                if (site->file == file && site->line == line) {
+                    return site;
+                }
+            }
+            return NULL; /* Table full, site is not coalesced */
+        }
+
+        /* Decide whether an event repeats its site's previous message */
+        static bool coalesce_event(log_event_t *event, va_list ap) {
+            char message[MAX_MESSAGE_LEN];
+            va_list copy;
+            
+            coalesce_site_t *site = coalesce_site(event->file, event->line);
+            if (!site) {
+                return false;
+            }
+            
+            va_copy(copy, ap);
+            int len = vsnprintf(message, sizeof(message), event->fmt, copy);
+            va_end(copy);
+            if (len < 0) {
+                return false;
+            }
+            if ((size_t)len >= sizeof(message)) {
+                len = sizeof(message) - 1;
+            }
+            
+            uint64_t hash = hash_bytes(14695981039346656037ull, message, (size_t)len);
+            hash = hash_bytes(hash, &event->level, sizeof(event->level));
+            uint64_t now = monotonic_ms();
+            
+            if (site->hash == hash &&
+                now - site->run_start_ms < logger_state.coalesce_window_ms) {
+                if (site->repeats++ == 0) {
+                    site->function = event->function;
+                    site->level = event->level;
+                }
+                return true;
+            }
+            
+            close_coalesce_run(site);
+            site->hash = hash;
+            site->run_start_ms = now;
+            return false;
+        }
+
+        /* Close every pending run, or only those whose window has passed; caller holds the lock */
+        static void coalesce_sweep(bool all) {
+            uint64_t now = monotonic_ms();
+            for (int i = 0; i < MAX_COALESCE_SITES; i++) {
+                coalesce_site_t *site = &logger_state.coalesce_sites[i];
+                if (site->used && site->repeats &&
+                    (all || now - site->run_start_ms >= logger_state.coalesce_window_ms)) {
+                    close_coalesce_run(site);
+                }
+            }
+        }
+
+        /* Coalesce and dispatch one event, caller holds the lock */
+        static void deliver_event(log_event_t *event, va_list ap) {
+            /* Repeats still reach outputs that opted out of coalescing */
+            if (logger_state.coalesce_window_ms && coalesce_event(event, ap)) {
+                dispatch_event(event, 1, ap);
+                return;
+            }
+            
+            /* Process all active outputs */
+            dispatch_event(event, 0, ap);
+        }
+
+        /* Shared path behind logger_logv and logger_log_cat */
+        static void log_message(log_category_t *category, log_level_t level, const char *file, const char *function, int line, const char *fmt, va_list ap) {
+            if (!logger_state.initialized) {
+                logger_init();
+            }
+            
+            log_event_t event = {
+                .fmt = fmt,
+                .file = file,
+                .function = function,
+                .line = line,
+                .level = level,
+                .category = category ? category->name : NULL,
+                .time = NULL,
+                .user_data = NULL
+            };
+            
+            /* Thresholds are read without the lock so reloads never stall callers */
+            if (__atomic_load_n(&logger_state.config.quiet, __ATOMIC_RELAXED)) {
+                return;
+            }
+            /* Category levels and their sites were already checked by the caller */
+            if (!category && level < __atomic_load_n(&logger_state.config.level, __ATOMIC_RELAXED) &&
+                !logger_site_enabled(file, line)) {
+                return;
+            }
+            if (throttle_sheds(level)) {
+                return;
+            }
+            
+            /* Shards replace the outputs and need neither the lock nor the writer */
+            if (__atomic_load_n(&shard_state.enabled, __ATOMIC_ACQUIRE)) {
+                uint64_t bytes_before = output_bytes_written;
+                if ((int)level >= __atomic_load_n(&shard_state.level, __ATOMIC_RELAXED) && shard_write(&event, ap)) {
+                    rate_note(1, output_bytes_written - bytes_before);
+                    if (__atomic_load_n(&profile_state.enabled, __ATOMIC_RELAXED)) {
+                        profile_note(&event, output_bytes_written - bytes_before);
+                    }
+                }
+                return;
+            }
+            
+            /* A hung output holds the lock; go straight to the fallback instead of queueing behind it */
+            if (__atomic_load_n(&watchdog_state.bypass, __ATOMIC_ACQUIRE) && watchdog_bypass(&event, ap)) {
+                rate_note(1, 0);
+                return;
+            }
+            
+            if (__atomic_load_n(&async_state.running, __ATOMIC_ACQUIRE) &&
+                async_enqueue(category, level, file, function, line, fmt, ap)) {
+                rate_note(1, 0);
+                return;
+            }
+            
+            lock_logger();
+            uint64_t bytes_before = output_bytes_written;
+            deliver_event(&event, ap);
+            uint64_t bytes = output_bytes_written - bytes_before;
+            unlock_logger();
+            
+            rate_note(1, bytes);
+            if (__atomic_load_n(&profile_state.enabled, __ATOMIC_RELAXED)) {
+                profile_note(&event, bytes);
+            }
+        }
+
+        /// Main logging function.
+        ///
+        /// Processes a log message and sends it to all appropriate output handlers.
+        /// This is the core function that all logging macros ultimately call.
+        ///
+        /// __Parameters__
+        ///
+        /// - `level`: Log level of the message
+        /// - `file`: Source file name (usually __FILE__)
+        /// - `function`: Function name (usually __FUNCTION__)
+        /// - `line`: Line number (usually __LINE__)
+        /// - `fmt`: printf-style format string
+        /// - `...`: Variable arguments for the format string
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_log(log_level_t level, const char *file, const char *function, int line, const char *fmt, ...) {
+            va_list ap;
+            va_start(ap, fmt);
+            logger_logv(level, file, function, line, fmt, ap);
+            va_end(ap);
+        }
+
+        /// Main logging function, `va_list` variant.
+        ///
+        /// Same as `logger_log` for callers that already hold a `va_list`.
+        ///
+        /// __Parameters__
+        ///
+        /// - `level`: Log level of the message
+        /// - `file`: Source file name (usually __FILE__)
+        /// - `function`: Function name (usually __FUNCTION__)
+        /// - `line`: Line number (usually __LINE__)
+        /// - `fmt`: printf-style format string
+        /// - `ap`: Arguments for the format string
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_logv(log_level_t level, const char *file, const char *function, int line, const char *fmt, va_list ap) {
+            log_message(NULL, level, file, function, line, fmt, ap);
+        }
+
+        /// Category logging function.
+        ///
+        /// Called by the `log_cat_*` macros once `logger_category_enabled`
+        /// has accepted the level, so the global threshold is not consulted
+        /// again.
+        ///
+        /// __Parameters__
+        ///
+        /// - `category`: Category the message belongs to
+        /// - `level`: Log level of the message
+        /// - `file`: Source file name (usually __FILE__)
+        /// - `function`: Function name (usually __FUNCTION__)
+        /// - `line`: Line number (usually __LINE__)
+        /// - `fmt`: printf-style format string
+        /// - `...`: Variable arguments for the format string
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_log_cat(log_category_t *category, log_level_t level, const char *file, const char *function, int line, const char *fmt, ...) {
+            va_list ap;
+            va_start(ap, fmt);
+            log_message(category, level, file, function, line, fmt, ap);
+            va_end(ap);
+        }
+
+        /// Flush pending logger state.
+        ///
+        /// Emits the "repeated N times" summary of every open coalescing run,
+        /// writes out partially filled compressed frames, starts writeback of
+        /// crash rings and closes the current block of every file index.
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_flush(void) {
+            /* The lock is held by a hung output call */
+            if (__atomic_load_n(&watchdog_state.bypass, __ATOMIC_ACQUIRE)) {
+                return;
+            }
+            
+            /* The writer needs the lock to empty its lanes */
+            async_drain(3);
+            shard_flush();
+            
+            lock_logger();
+            
+            coalesce_sweep(true);
+            
+            for (int i = 0; i < MAX_OUTPUTS; i++) {
+                if (logger_state.outputs[i].active &&
+                    logger_state.outputs[i].output_fn == logger_compressed_output) {
+                    compressed_sink_flush(logger_state.outputs[i].user_data);
+                }
+                if (logger_state.outputs[i].active &&
+                    logger_state.outputs[i].output_fn == logger_tcp_output) {
+                    tcp_sink_flush(logger_state.outputs[i].user_data);
+                }
+                if (logger_state.outputs[i].active &&
+                    logger_state.outputs[i].output_fn == logger_ring_output) {
+                    ring_sink_t *ring = logger_state.outputs[i].user_data;
+                    msync(ring->map, ring->map_size, MS_ASYNC);
+                }
+                if (logger_state.outputs[i].index) {
+                    file_index_close_block(logger_state.outputs[i].index);
+                }
+            }
+            
+            unlock_logger();
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── HEXDUMP ────────────────────────────┐
+
+        /* Hex digits and printable ASCII of 16 bytes, 32 + 16 characters */
+        static void hexdump_convert(const unsigned char *bytes, char *hex, char *ascii) {
+        #if defined(__SSE2__)
+            __m128i v = _mm_loadu_si128((const __m128i*)bytes);
+            __m128i low_nibble = _mm_set1_epi8(0x0f);
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low_nibble);
+            __m128i lo = _mm_and_si128(v, low_nibble);
+            
+            /* Interleave so each byte becomes its high digit then its low digit */
+            __m128i nibbles[2] = { _mm_unpacklo_epi8(hi, lo), _mm_unpackhi_epi8(hi, lo) };
+            for (int i = 0; i < 2; i++) {
+                __m128i letter = _mm_cmpgt_epi8(nibbles[i], _mm_set1_epi8(9));
+                __m128i digits = _mm_add_epi8(nibbles[i], _mm_set1_epi8('0'));
+                digits = _mm_add_epi8(digits, _mm_and_si128(letter, _mm_set1_epi8('a' - '0' - 10)));
+                _mm_storeu_si128((__m128i*)(hex + 16 * i), digits);
+            }
+            
+            /* Signed compares also reject bytes from 0x80 up */
+            __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f)),
+                                              _mm_cmplt_epi8(v, _mm_set1_epi8(0x7f)));
+            __m128i shown = _mm_or_si128(_mm_and_si128(printable, v),
+                                         _mm_andnot_si128(printable, _mm_set1_epi8('.')));
+            _mm_storeu_si128((__m128i*)ascii, shown);
+        #else
+            static const char digits[] = "0123456789abcdef";
+            for (int i = 0; i < 16; i++) {
+                hex[2 * i] = digits[bytes[i] >> 4];
+                hex[2 * i + 1] = digits[bytes[i] & 0x0f];
+                ascii[i] = bytes[i] >= 0x20 && bytes[i] < 0x7f ? (char)bytes[i] : '.';
+            }
+        #endif
+        }
+
+        /* One `hexdump -C` line for up to 16 bytes, without the newline */
+        static char *hexdump_line(char *out, size_t offset, const unsigned char *bytes, size_t count) {
+            static const char digits[] = "0123456789abcdef";
+            unsigned char padded[16] = {0};
+            char hex[32];
+            char ascii[16];
+            
+            if (count < 16) {
+                memcpy(padded, bytes, count);
+                bytes = padded;
+            }
+            hexdump_convert(bytes, hex, ascii);
+            
+            for (int shift = 28; shift >= 0; shift -= 4) {
+                *out++ = digits[(offset >> shift) & 0x0f];
+            }
+            *out++ = ' ';
+            for (size_t i = 0; i < 16; i++) {
+                out[0] = ' ';
+                if (i == 8) {
+                    *++out = ' ';
+                }
+                if (i < count) {
+                    out[1] = hex[2 * i];
+                    out[2] = hex[2 * i + 1];
+                } else {
+                    out[1] = ' ';
+                    out[2] = ' ';
+                }
+                out += 3;
+            }
+            *out++ = ' ';
+            *out++ = ' ';
+            *out++ = '|';
+            memcpy(out, ascii, count);
+            out += count;
+            *out++ = '|';
+            return out;
+        }
+
+        /// Log a binary buffer as one multi-line hexdump record.
+        ///
+        /// Called by the `log_hexdump` macro. Renders the classic offset,
+        /// hex and ASCII columns into a single message, converting 16 bytes
+        /// at a time with SSE2 where available. Returns before touching the
+        /// data when `level` is below the threshold. Dumps longer than the
+        /// limit set with `logger_set_hexdump_limit` end with a line counting
+        /// the bytes left out.
+        ///
+        /// __Parameters__
+        ///
+        /// - `level`: Log level of the record
+        /// - `file`: Source file name (usually __FILE__)
+        /// - `function`: Function name (usually __FUNCTION__)
+        /// - `line`: Line number (usually __LINE__)
+        /// - `data`: Bytes to dump
+        /// - `size`: Number of bytes at `data`
+        /// - `label`: Title of the dump, may be NULL
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_hexdump(log_level_t level, const char *file, const char *function, int line,
+                            const void *data, size_t size, const char *label) {
+            char stack_buf[64 + (HEXDUMP_STACK_LINES + 1) * (HEXDUMP_LINE_LEN + 1)];
+            
+            if (__atomic_load_n(&logger_state.config.quiet, __ATOMIC_RELAXED) ||
+                level < __atomic_load_n(&logger_state.config.level, __ATOMIC_RELAXED) || throttle_sheds(level)) {
+                return;
+            }
+            if (!data) {
+                size = 0;
+            }
+            
+            size_t limit = __atomic_load_n(&logger_state.hexdump_limit, __ATOMIC_RELAXED);
+            size_t shown = limit && size > limit ? limit : size;
+            size_t lines = (shown + 15) / 16;
+            char *buf = stack_buf;
+            
+            /* Big dumps need the heap, which bounded-memory mode rules out */
+            if (lines > HEXDUMP_STACK_LINES) {
+                buf = record_pool.bounded ? NULL : malloc(64 + (lines + 1) * (HEXDUMP_LINE_LEN + 1));
+                if (!buf) {
+                    buf = stack_buf;
+                    lines = HEXDUMP_STACK_LINES;
+                    shown = lines * 16;
+                }
+            }
+            
+            char *out = buf + snprintf(buf, 64, "%.40s (%zu bytes)", label ? label : "hexdump", size);
+            for (size_t i = 0; i < lines; i++) {
+                *out++ = '\n';
+                out = hexdump_line(out, i * 16, (const unsigned char*)data + i * 16,
+                                   shown - i * 16 < 16 ? shown - i * 16 : 16);
+            }
+            if (shown < size) {
+                out += sprintf(out, "\n... %zu more bytes", size - shown);
+            }
+            *out = '\0';
+            
+            logger_log(level, file, function, line, "%s", buf);
+            if (buf != stack_buf) {
+                free(buf);
+            }
+        }
+
+        /// Limit how many bytes a hexdump shows.
+        ///
+        /// __Parameters__
+        ///
+        /// - `bytes`: Largest dump rendered in full, 0 for no limit
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_set_hexdump_limit(size_t bytes) {
+            __atomic_store_n(&logger_state.hexdump_limit, bytes, __ATOMIC_RELAXED);
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── BATCH LOGGING ────────────────────────────┐
+
+        /* Pool slots go back to the free list, overflow records came from malloc */
+        static bool record_in_pool(const log_record_t *record) {
+            const unsigned char *p = (const unsigned char*)record;
+            return record_pool.records && p >= record_pool.records &&
+                   p < record_pool.records + (size_t)record_pool.record_count * LOGGER_RECORD_SIZE;
+        }
+
+        /* Pool slot first; only unbounded mode may fall back to the heap */
+        static log_record_t *batch_record_acquire(void) {
+            log_record_t *record = record_acquire();
+            if (record || record_pool.bounded) {
+                return record;
+            }
+            record = malloc(LOGGER_RECORD_SIZE);
+            if (record) {
+                record->next = NULL;
+            }
+            return record;
+        }
+
+        /* Copy the calling thread's id, name and context fields into a record */
+        static void record_capture_context(log_record_t *record) {
+            const char *name = thread_context_name();
+            char *out = record->message + record->length + 1;
+            char *end = (char*)record + LOGGER_RECORD_SIZE;
+            
+            record->thread_id = logger_thread_id();
+            snprintf(record->thread_name, sizeof(record->thread_name), "%s", name ? name : "");
+            record->context_count = 0;
+            for (int i = 0; i < thread_context.count; i++) {
+                size_t key = strlen(thread_context.fields[i].key) + 1;
+                size_t value = strlen(thread_context.fields[i].value) + 1;
+                if ((size_t)(end - out) < key + value) {
+                    break; /* Long messages leave no room, the message wins */
+                }
+                memcpy(out, thread_context.fields[i].key, key);
+                memcpy(out + key, thread_context.fields[i].value, value);
+                out += key + value;
+                record->context_count++;
+            }
+        }
+
+        /* Rebuild the event a record was captured from */
+        static void record_event(const log_record_t *record, log_event_t *event, log_context_field_t *fields, struct tm *tm_buf) {
+            const char *in = record->message + record->length + 1;
+            
+            for (int i = 0; i < record->context_count; i++) {
+                snprintf(fields[i].key, sizeof(fields[i].key), "%s", in);
+                in += strlen(in) + 1;
+                snprintf(fields[i].value, sizeof(fields[i].value), "%s", in);
+                in += strlen(in) + 1;
+            }
+            
+            memset(event, 0, sizeof(*event));
+            event->fmt = "%s";
+            event->file = record->file;
+            event->function = record->function;
+            event->line = record->line;
+            event->level = record->level;
+            event->category = record->category;
+            event->timestamp_ns = record->timestamp_ns;
+            event->time = event_time(record->timestamp_ns, tm_buf);
+            event->thread_id = record->thread_id;
+            event->thread_name = record->thread_name[0] ? record->thread_name : NULL;
+            event->context = fields;
+            event->context_count = record->context_count;
+        }
+
+        /* Variadic shim so a rendered record goes through coalescing as "%s" */
+        static void deliver_line(log_event_t *event, ...) {
+            va_list ap;
+            va_start(ap, event);
+            deliver_event(event, ap);
+            va_end(ap);
+        }
+
+        /* Same shim for a rendered record bound for the calling thread's shard */
+        static bool shard_line(log_event_t *event, ...) {
+            va_list ap;
+            va_start(ap, event);
+            bool written = shard_write(event, ap);
+            va_end(ap);
+            return written;
+        }
+
+        /* One flush per stream after a batch instead of one per line */
+        static void flush_streams(void) {
+            for (int i = 0; i < MAX_OUTPUTS; i++) {
+                output_handler_t *out = &logger_state.outputs[i];
+                if (out->active && !__atomic_load_n(&out->degraded, __ATOMIC_ACQUIRE) &&
+                    (out->output_fn == logger_file_output || out->output_fn == logger_console_output ||
+                     out->output_fn == logger_json_output)) {
+                    fflush((FILE*)out->user_data);
+                }
+            }
+        }
+
+        /// Start collecting a batch of events.
+        ///
+        /// Events added to the batch are rendered right away into record
+        /// slots and only reach the outputs on `logger_batch_commit`, all
+        /// under one lock so no other thread's lines land in between.
+        ///
+        /// __Parameters__
+        ///
+        /// - `batch`: Caller-owned batch to reset
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_batch_begin(log_batch_t *batch) {
+            if (!batch) {
+                return;
+            }
+            
+            memset(batch, 0, sizeof(*batch));
+            
+            lock_logger();
+            pool_ensure();
+            unlock_logger();
+        }
+
+        /// Add an event to a batch.
+        ///
+        /// Applies the global level now and captures the timestamp and the
+        /// formatted message. Takes no lock. In bounded-memory mode an event
+        /// that finds the record pool empty is dropped and counted, otherwise
+        /// it is stored on the heap. A message longer than a record (about
+        /// 960 bytes) is cut to fit and counted in `records_truncated`.
+        ///
+        /// __Parameters__
+        ///
+        /// - `batch`: Batch started with `logger_batch_begin`
+        /// - `level`: Log level of the message
+        /// - `file`: Source file name (usually __FILE__)
+        /// - `function`: Function name (usually __FUNCTION__)
+        /// - `line`: Line number (usually __LINE__)
+        /// - `fmt`: printf-style format string
+        /// - `...`: Variable arguments for the format string
+        ///
+        /// __Return__
+        ///
+        /// - 0 if the event was added or filtered by level, -1 if it was dropped
+        int logger_batch_add(log_batch_t *batch, log_level_t level, const char *file, const char *function, int line, const char *fmt, ...) {
+            if (!batch || !fmt) {
+                return -1;
+            }
+            if (level < __atomic_load_n(&logger_state.config.level, __ATOMIC_RELAXED) || throttle_sheds(level)) {
+                return 0;
+            }
+            
+            log_record_t *record = batch_record_acquire();
+            if (!record) {
+                batch->dropped++;
+                __atomic_add_fetch(&record_pool.dropped, 1, __ATOMIC_RELAXED);
+                return -1;
+            }
+            
+            record->timestamp_ns = clock_now_ns();
+            
+            va_list ap;
+            va_start(ap, fmt);
+            if (!record_format(record, fmt, ap)) {
+                __atomic_add_fetch(&record_pool.truncated, 1, __ATOMIC_RELAXED);
+            }
+            va_end(ap);
+            record_capture_context(record);
+            
+            record->sequence = batch->count;
+            record->format = fmt;
+            record->file = file;
+            record->function = function;
+            record->category = NULL;
+            record->line = line;
+            record->level = level;
+            record->next = NULL;
+            
+            if (batch->tail) {
+                ((log_record_t*)batch->tail)->next = record;
+            } else {
+                batch->head = record;
+            }
+            batch->tail = record;
+            batch->count++;
+            return 0;
+        }
+
+        /// Deliver a batch to the outputs.
+        ///
+        /// Takes the lock once, passes every event to the outputs in the
+        /// order it was added and flushes each built-in stream a single time
+        /// at the end. With the async writer running, lines already queued
+        /// are written first. With shard output on, the events go to the
+        /// calling thread's shard instead, like single events. The batch is
+        /// empty afterwards; its `dropped` count is kept until the next
+        /// `logger_batch_begin`.
+        ///
+        /// __Parameters__
+        ///
+        /// - `batch`: Batch to deliver
+        ///
+        /// __Return__
+        ///
+        /// - Number of events delivered
+        int logger_batch_commit(log_batch_t *batch) {
+            int delivered = 0;
+            
+            if (!batch) {
+                return 0;
+            }
+            if (!logger_state.initialized) {
+                logger_init();
+            }
+            
+            if (batch->head && !__atomic_load_n(&logger_state.config.quiet, __ATOMIC_RELAXED) &&
+                __atomic_load_n(&shard_state.enabled, __ATOMIC_ACQUIRE)) {
+                uint64_t batch_bytes = output_bytes_written;
+                
+                for (log_record_t *record = batch->head; record; record = record->next) {
+                    if ((int)record->level < __atomic_load_n(&shard_state.level, __ATOMIC_RELAXED)) {
+                        continue;
+                    }
+                    log_context_field_t fields[LOGGER_CONTEXT_MAX];
+                    struct tm tm_buf;
+                    log_event_t event;
+                    record_event(record, &event, fields, &tm_buf);
+                    uint64_t bytes_before = output_bytes_written;
+                    if (shard_line(&event, record->message)) {
+                        if (__atomic_load_n(&profile_state.enabled, __ATOMIC_RELAXED)) {
+                            profile_note(&event, output_bytes_written - bytes_before);
+                        }
+                        delivered++;
+                    }
+                }
+                
+                rate_note((uint64_t)delivered, output_bytes_written - batch_bytes);
+            } else if (batch->head && !__atomic_load_n(&logger_state.config.quiet, __ATOMIC_RELAXED)) {
+                uint64_t batch_bytes = output_bytes_written;
+                
+                /* Lines this thread queued before the batch must not be overtaken */
+                if (__atomic_load_n(&async_state.running, __ATOMIC_ACQUIRE)) {
+                    async_drain(3);
+                }
+                lock_logger();
+                logger_state.batching = true;
+                
+                for (log_record_t *record = batch->head; record; record = record->next) {
+                    log_context_field_t fields[LOGGER_CONTEXT_MAX];
+                    struct tm tm_buf;
+                    log_event_t event;
+                    record_event(record, &event, fields, &tm_buf);
+                    uint64_t bytes_before = output_bytes_written;
+                    record_source_format = record->format;
+                    deliver_line(&event, record->message);
+                    record_source_format = NULL;
+                    if (__atomic_load_n(&profile_state.enabled, __ATOMIC_RELAXED)) {
+                        profile_note(&event, output_bytes_written - bytes_before);
+                    }
+                    delivered++;
+                }
+                
+                logger_state.batching = false;
+                flush_streams();
+                unlock_logger();
+                rate_note((uint64_t)delivered, output_bytes_written - batch_bytes);
+            }
+            
+            logger_batch_discard(batch);
+            return delivered;
+        }
+
+        /// Throw away a batch without delivering it.
+        ///
+        /// __Parameters__
+        ///
+        /// - `batch`: Batch to empty
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_batch_discard(log_batch_t *batch) {
+            if (!batch) {
+                return;
+            }
+            
+            log_record_t *record = batch->head;
+            while (record) {
+                log_record_t *next = record->next;
+                if (record_in_pool(record)) {
+                    record_release(record);
+                } else {
+                    free(record);
+                }
+                record = next;
+            }
+            
+            batch->head = NULL;
+            batch->tail = NULL;
+            batch->count = 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── ASYNC WRITER ────────────────────────────┐
+
+        static int async_lane(log_level_t level) {
+            return level >= LOG_LEVEL_ERROR ? 0 : 1;
+        }
+
+        /* Queue an event for the writer; false sends it down the synchronous path instead */
+        static bool async_enqueue(log_category_t *category, log_level_t level, const char *file, const char *function, int line, const char *fmt, va_list ap) {
+            int lane = async_lane(level);
+            
+            /* Low-priority records may use half the pool at most, the rest is kept for errors */
+            unsigned limit = record_pool.bounded ? record_pool.record_count / 2 : ASYNC_LANE_LIMIT;
+            if (lane == 1 && __atomic_load_n(&async_state.lanes[1].count, __ATOMIC_RELAXED) >= limit) {
+                if (record_pool.bounded) {
+                    __atomic_add_fetch(&record_pool.dropped, 1, __ATOMIC_RELAXED);
+                    return true;
+                }
+                
+                /* Without a memory bound a full lane slows the producer down like the synchronous path would */
+                pthread_mutex_lock(&async_state.mutex);
+                while (async_state.running && async_state.lanes[1].count >= limit) {
+                    pthread_cond_wait(&async_state.space, &async_state.mutex);
+                }
+                bool running = async_state.running;
+                pthread_mutex_unlock(&async_state.mutex);
+                if (!running) {
+                    return false;
+                }
+            }
+            
+            log_record_t *record = batch_record_acquire();
+            if (!record) {
+                if (lane == 0) {
+                    return false; /* Errors are never dropped */
+                }
+                __atomic_add_fetch(&record_pool.dropped, 1, __ATOMIC_RELAXED);
+                return true;
+            }
+            
+            record->timestamp_ns = clock_now_ns();
+            
+            /* A message longer than a record is written in full on the synchronous path, after what is queued */
+            if (!record_format(record, fmt, ap)) {
+                if (record_in_pool(record)) {
+                    record_release(record);
+                } else {
+                    free(record);
+                }
+                async_drain(3);
+                return false;
+            }
+            record_capture_context(record);
+            record->format = fmt;
+            record->file = file;
+            record->function = function;
+            record->category = category ? category->name : NULL;
+            record->line = line;
+            record->level = level;
+            record->next = NULL;
+            
+            pthread_mutex_lock(&async_state.mutex);
+            if (async_state.lanes[lane].tail) {
+                async_state.lanes[lane].tail->next = record;
+            } else {
+                async_state.lanes[lane].head = record;
+            }
+            async_state.lanes[lane].tail = record;
+            __atomic_store_n(&async_state.lanes[lane].count, async_state.lanes[lane].count + 1, __ATOMIC_RELAXED);
+            pthread_cond_signal(&async_state.wake);
+            pthread_mutex_unlock(&async_state.mutex);
+            
+            /* The process may not outlive a fatal record, so wait until it is written */
+            if (level == LOG_LEVEL_FATAL) {
+                async_drain(1);
+            }
+            return true;
+        }
+
+        /* Wait until the lanes in `lane_mask` (bit per lane) are empty and written */
+        static void async_drain(unsigned lane_mask) {
+            pthread_mutex_lock(&async_state.mutex);
+            while (async_state.running &&
+                   (((lane_mask & 1) && (async_state.lanes[0].head || async_state.busy[0])) ||
+                    ((lane_mask & 2) && (async_state.lanes[1].head || async_state.busy[1])))) {
+                pthread_cond_wait(&async_state.drained, &async_state.mutex);
+            }
+            pthread_mutex_unlock(&async_state.mutex);
+        }
+
+        /* Layout settings the file line depends on */
+        static unsigned file_layout_flags(void) {
+            return (__atomic_load_n(&logger_state.config.show_function, __ATOMIC_RELAXED) ? 1u : 0u) |
+                   (__atomic_load_n(&logger_state.config.show_context, __ATOMIC_RELAXED) ? 2u : 0u);
+        }
+
+        /* Write a chain of records under one lock and one flush per stream */
+        static void async_write(log_record_t *record, const format_chunk_t *chunk) {
+            uint64_t chain_bytes = output_bytes_written;
+            lock_logger();
+            logger_state.batching = true;
+            
+            /* Lines rendered before a layout change are formatted again */
+            bool rendered = chunk && chunk->layout == file_layout_flags();
+            for (int i = 0; record; i++) {
+                log_record_t *next = record->next;
+                log_context_field_t fields[LOGGER_CONTEXT_MAX];
+                struct tm tm_buf;
+                log_event_t event;
+                
+                record_event(record, &event, fields, &tm_buf);
+                uint64_t bytes_before = output_bytes_written;
+                if (rendered && chunk->length[i]) {
+                    record_rendered_line.event = &event;
+                    record_rendered_line.text = chunk->text + chunk->offset[i];
+                    record_rendered_line.length = chunk->length[i];
+                }
+                record_source_format = record->format;
+                deliver_line(&event, record->message);
+                record_source_format = NULL;
+                record_rendered_line.event = NULL;
+                if (__atomic_load_n(&profile_state.enabled, __ATOMIC_RELAXED)) {
+                    profile_note(&event, output_bytes_written - bytes_before);
+                }
+                
+                if (record_in_pool(record)) {
+                    record_release(record);
+                } else {
+                    free(record);
+                }
+                record = next;
+            }
+            logger_state.batching = false;
+            flush_streams();
+            unlock_logger();
+            
+            /* The producers already counted the events */
+            rate_note(0, output_bytes_written - chain_bytes);
+        }
+
+        /* Variadic shim so a record's message renders as "%s" */
+        static size_t render_record_line(char *buf, size_t size, log_event_t *event, ...) {
+            va_list ap;
+            va_start(ap, event);
+            size_t len = render_file_line(buf, size, event, ap);
+            va_end(ap);
+            return len;
+        }
+
+        /* Render the file-layout line of every record in a chunk, outside the logger lock */
+        static void format_chunk(format_chunk_t *chunk) {
+            unsigned layout = file_layout_flags();
+            size_t used = 0;
+            int i = 0;
+            
+            for (log_record_t *record = chunk->head; record; record = record->next, i++) {
+                log_context_field_t fields[LOGGER_CONTEXT_MAX];
+                struct tm tm_buf;
+                log_event_t event;
+                
+                record_event(record, &event, fields, &tm_buf);
+                size_t len = render_record_line(chunk->text + used, sizeof(chunk->text) - used, &event, record->message);
+                chunk->offset[i] = (uint32_t)used;
+                chunk->length[i] = len < sizeof(chunk->text) - used ? (uint32_t)len : 0;
+                used += chunk->length[i];
+            }
+            chunk->layout = file_layout_flags() == layout ? layout : ~0u;
+        }
+
+        /* Format worker: claims submitted chunks in order and renders them in parallel with the others */
+        static void *format_main(void *arg) {
+            (void)arg;
+            pthread_mutex_lock(&async_state.mutex);
+            
+            for (;;) {
+                while (async_state.claimed == async_state.submitted && !async_state.workers_stop) {
+                    pthread_cond_wait(&async_state.work, &async_state.mutex);
+                }
+                if (async_state.claimed == async_state.submitted) {
+                    break;
+                }
+                format_chunk_t *chunk = &async_state.chunks[async_state.claimed++ % async_state.depth];
+                pthread_mutex_unlock(&async_state.mutex);
+                
+                format_chunk(chunk);
+                
+                pthread_mutex_lock(&async_state.mutex);
+                chunk->ready = true;
+                pthread_cond_signal(&async_state.wake);
+            }
+            
+            pthread_mutex_unlock(&async_state.mutex);
+            return NULL;
+        }
+
+        /* Start the requested workers with two chunks in flight each; fewer if threads or memory run out */
+        static void format_start(void) {
+            async_state.worker_count = 0;
+            async_state.depth = 0;
+            async_state.submitted = async_state.claimed = async_state.committed = 0;
+            async_state.workers_stop = false;
+            if (async_state.format_workers == 0) {
+                return;
+            }
+            
+            /* Under a memory budget the ring is carved out of the record slots instead of the heap */
+            lock_logger();
+            bool pooled = record_pool.bounded;
+            async_state.chunks = pooled ? pool_take_chunks(2 * async_state.format_workers) :
+                                          calloc(2 * async_state.format_workers, sizeof(format_chunk_t));
+            __atomic_store_n(&async_state.chunks_pooled, pooled && async_state.chunks, __ATOMIC_RELEASE);
+            unlock_logger();
+            if (!async_state.chunks) {
+                return;
+            }
+            async_state.depth = 2 * async_state.format_workers;
+            while (async_state.worker_count < async_state.format_workers &&
+                   pthread_create(&async_state.workers[async_state.worker_count], NULL, format_main, NULL) == 0) {
+                async_state.worker_count++;
+            }
+            async_state.depth = 2 * async_state.worker_count;
+            if (async_state.worker_count == 0) {
+                format_release_chunks();
+            }
+        }
+
+        /* Free the chunk ring, or give it back to the record slots */
+        static void format_release_chunks(void) {
+            if (async_state.chunks_pooled) {
+                lock_logger();
+                pool_return_chunks();
+                __atomic_store_n(&async_state.chunks_pooled, false, __ATOMIC_RELEASE);
+                unlock_logger();
+            } else {
+                free(async_state.chunks);
+            }
+            async_state.chunks = NULL;
+        }
+
+        /* Stop the workers once the writer has written every chunk */
+        static void format_stop(void) {
+            pthread_mutex_lock(&async_state.mutex);
+            async_state.workers_stop = true;
+            pthread_cond_broadcast(&async_state.work);
+            pthread_mutex_unlock(&async_state.mutex);
+            
+            for (unsigned i = 0; i < async_state.worker_count; i++) {
+                pthread_join(async_state.workers[i], NULL);
+            }
+            if (async_state.chunks) {
+                format_release_chunks();
+            }
+            async_state.worker_count = 0;
+            async_state.depth = 0;
+        }
+
+        /* Writer thread: the whole error lane first, then low-priority records a chunk at a time */
+        static void *async_main(void *arg) {
+            (void)arg;
+            pthread_mutex_lock(&async_state.mutex);
+            
+            for (;;) {
+                /* Errors skip the format workers and go out ahead of the chunks still in flight */
+                if (async_state.lanes[0].head) {
+                    log_record_t *errors = async_state.lanes[0].head;
+                    async_state.lanes[0].head = NULL;
+                    async_state.lanes[0].tail = NULL;
+                    __atomic_store_n(&async_state.lanes[0].count, 0, __ATOMIC_RELAXED);
+                    async_state.busy[0]++;
+                    pthread_mutex_unlock(&async_state.mutex);
+                    
+                    async_write(errors, NULL);
+                    
+                    pthread_mutex_lock(&async_state.mutex);
+                    async_state.busy[0]--;
+                    pthread_cond_broadcast(&async_state.drained);
+                    continue;
+                }
+                
+                /* Reorder stage: chunks reach the outputs in the order they left the lane */
+                format_chunk_t *oldest = async_state.committed != async_state.submitted ?
+                                         &async_state.chunks[async_state.committed % async_state.depth] : NULL;
+                if (oldest && oldest->ready) {
+                    pthread_mutex_unlock(&async_state.mutex);
+                    async_write(oldest->head, oldest);
+                    pthread_mutex_lock(&async_state.mutex);
+                    oldest->ready = false;
+                    async_state.committed++;
+                    async_state.busy[1]--;
+                    pthread_cond_broadcast(&async_state.drained);
+                    continue;
+                }
+                
+                bool full = async_state.depth && async_state.submitted - async_state.committed == async_state.depth;
+                if (!async_state.lanes[1].head || full) {
+                    if (!oldest) {
+                        pthread_cond_broadcast(&async_state.drained);
+                        if (async_state.stop) {
+                            break;
+                        }
+                    }
+                    pthread_cond_wait(&async_state.wake, &async_state.mutex);
+                    continue;
+                }
+                
+                /* Other records leave room for errors every chunk */
+                log_record_t *head = async_state.lanes[1].head;
+                log_record_t *last = head;
+                unsigned taken = 1;
+                while (last->next && taken < ASYNC_CHUNK) {
+                    last = last->next;
+                    taken++;
+                }
+                async_state.lanes[1].head = last->next;
+                if (!last->next) {
+                    async_state.lanes[1].tail = NULL;
+                }
+                last->next = NULL;
+                __atomic_store_n(&async_state.lanes[1].count, async_state.lanes[1].count - taken, __ATOMIC_RELAXED);
+                async_state.busy[1]++;
+                pthread_cond_broadcast(&async_state.space);
+                
+                /* With workers the chunk is numbered and rendered first, the writer goes on taking chunks */
+                if (async_state.depth) {
+                    format_chunk_t *chunk = &async_state.chunks[async_state.submitted++ % async_state.depth];
+                    chunk->head = head;
+                    pthread_cond_signal(&async_state.work);
+                    continue;
+                }
+                pthread_mutex_unlock(&async_state.mutex);
+                
+                async_write(head, NULL);
+                
+                pthread_mutex_lock(&async_state.mutex);
+                async_state.busy[1]--;
+                pthread_cond_broadcast(&async_state.drained);
+            }
+            
+            pthread_mutex_unlock(&async_state.mutex);
+            return NULL;
+        }
+
+        /// Write events from a background thread.
+        ///
+        /// Callers only format the message into a record and queue it, so a
+        /// slow disk no longer holds them up. Records travel in two lanes:
+        /// ERROR and FATAL in one, everything else in the other. The writer
+        /// always empties the error lane first and flushes it right away,
+        /// and takes other records at most 64 at a time so an error never
+        /// waits behind a flood of trace lines. Order is kept within a lane;
+        /// an error may be written before lower-level lines logged just
+        /// before it. FATAL calls return once their record is written.
+        /// When the low-priority lane is full (4096 records) callers wait
+        /// for the writer to catch up; in bounded-memory mode the lane holds
+        /// half the record pool and extra records are dropped and counted
+        /// instead. Errors fall back to writing directly when no record is
+        /// free. A message longer than a record (about 960 bytes) is not
+        /// queued: the caller waits for the queue to drain and writes it
+        /// directly, in full. Batches are still written by
+        /// the committing thread.
+        ///
+        /// Those direct writes reach the same outputs as the writer thread,
+        /// so a lock must be installed with `logger_set_lock` first, and kept
+        /// while the writer runs.
+        ///
+        /// __Parameters__
+        ///
+        /// - `enabled`: true to start the writer, false to drain and stop it
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 if no lock is installed or the writer thread cannot be started
+        int logger_set_async(bool enabled) {
+            pthread_mutex_lock(&async_state.mutex);
+            
+            if (enabled && !async_state.running) {
+                if (!logger_state.config.lock_fn) {
+                    pthread_mutex_unlock(&async_state.mutex);
+                    return -1;
+                }
+                if (!logger_state.initialized) {
+                    pthread_mutex_unlock(&async_state.mutex);
+                    logger_init();
+                    pthread_mutex_lock(&async_state.mutex);
+                }
+                lock_logger();
+                pool_ensure();
+                unlock_logger();
+                
+                async_state.stop = false;
+                format_start();
+                if (pthread_create(&async_state.thread, NULL, async_main, NULL) != 0) {
+                    pthread_mutex_unlock(&async_state.mutex);
+                    format_stop();
+                    return -1;
+                }
+                __atomic_store_n(&async_state.running, true, __ATOMIC_RELEASE);
+            } else if (!enabled && async_state.running) {
+                /* New events take the synchronous path while the writer drains */
+                __atomic_store_n(&async_state.running, false, __ATOMIC_RELEASE);
+                async_state.stop = true;
+                pthread_cond_signal(&async_state.wake);
+                pthread_cond_broadcast(&async_state.space);
+                pthread_mutex_unlock(&async_state.mutex);
+                pthread_join(async_state.thread, NULL);
+                format_stop();
+                
+                /* Callers that saw the writer running just before it stopped */
+                for (int lane = 0; lane < 2; lane++) {
+                    pthread_mutex_lock(&async_state.mutex);
+                    log_record_t *late = async_state.lanes[lane].head;
+                    async_state.lanes[lane].head = NULL;
+                    async_state.lanes[lane].tail = NULL;
+                    async_state.lanes[lane].count = 0;
+                    pthread_mutex_unlock(&async_state.mutex);
+                    if (late) {
+                        async_write(late, NULL);
+                    }
+                }
+                return 0;
+            }
+            
+            pthread_mutex_unlock(&async_state.mutex);
+            return 0;
+        }
+
+        /// Render async lines on a pool of format worker threads.
+        ///
+        /// With one writer thread, building the text of each line
+        /// (timestamp, header and message) caps the async throughput. With
+        /// workers, the writer numbers each chunk of up to 64 records it
+        /// takes from the lanes and hands it to the pool. Workers render the
+        /// file-layout lines of whole chunks in parallel, and the writer
+        /// hands the chunks to the outputs strictly in their numbered order,
+        /// so the written order is the same as without workers. File,
+        /// compressed, TCP and crash ring outputs copy the rendered lines.
+        /// Console, JSON, pattern and custom outputs still format on the
+        /// writer. Errors skip the workers: the writer writes them itself,
+        /// ahead of the chunks in flight. Under a memory budget the chunks
+        /// (a little over 64 KiB each, two per worker) are taken from the record
+        /// slots, and no workers start if that would leave fewer than 256
+        /// records. A running writer is drained and restarted to apply the
+        /// new count.
+        ///
+        /// __Parameters__
+        ///
+        /// - `workers`: Number of worker threads, 0 to render on the writer
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 if `workers` is above 16 or the writer cannot be restarted
+        int logger_set_format_workers(unsigned workers) {
+            if (workers > MAX_FORMAT_WORKERS) {
+                return -1;
+            }
+            
+            bool running = __atomic_load_n(&async_state.running, __ATOMIC_ACQUIRE);
+            if (running) {
+                logger_set_async(false);
+            }
+            pthread_mutex_lock(&async_state.mutex);
+            async_state.format_workers = workers;
+            pthread_mutex_unlock(&async_state.mutex);
+            return running ? logger_set_async(true) : 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── BUILT-IN OUTPUTS ────────────────────────────┐
+
+        /* Drop an output slot, tearing down outputs the logger owns */
+        static void release_output(output_handler_t *output) {
+            if (output->active && output->output_fn == logger_compressed_output) {
+                compressed_sink_destroy(output->user_data);
+            }
+            if (output->active && output->output_fn == logger_tcp_output) {
+                tcp_sink_destroy(output->user_data);
+            }
+            if (output->active && output->output_fn == logger_ring_output) {
+                ring_sink_destroy(output->user_data);
+            }
+            if (output->index) {
+                file_index_close_block(output->index);
+                free(output->index);
+            }
+            if (output->layout) {
+                layout_free(output->layout);
+            }
+            if (output->filter) {
+                filter_free(output->filter);
+            }
+            memset(output, 0, sizeof(*output));
+        }
+
+        /* Format a line in the file output layout, snprintf-style return */
+        static size_t render_file_line(char *buf, size_t size, log_event_t *event, va_list ap) {
+            char time_buf[64];
+            char context[MAX_CONTEXT_LEN] = "";
+            size_t len;
+            
+            if (record_rendered_line.event == event) {
+                len = record_rendered_line.length;
+                if (len < size) {
+                    memcpy(buf, record_rendered_line.text, len);
+                    buf[len] = '\0';
+                }
+                return len;
+            }
+            
+            strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", event->time);
+            if (logger_state.config.show_context) {
+                context[0] = ' ';
+                render_context(context + 1, sizeof(context) - 1, event);
+            }
+            if (logger_state.config.show_function) {
+                len = (size_t)snprintf(buf, size, "%s %-5s %s:%d [%s]%s: ", time_buf, level_strings[event->level],
+                                       event->file, event->line, event->function, context);
+            } else {
+                len = (size_t)snprintf(buf, size, "%s %-5s %s:%d%s: ", time_buf, level_strings[event->level],
+                                       event->file, event->line, context);
+            }
+            
+            int msg = vsnprintf(len < size ? buf + len : NULL, len < size ? size - len : 0, event->fmt, ap);
+            len += msg > 0 ? (size_t)msg : 0;
+            if (len + 1 < size) {
+                buf[len] = '\n';
+                buf[len + 1] = '\0';
+            }
+            return len + 1;
+        }
+
+        /// Built-in console output function.
+        ///
+        /// Formats and outputs log messages to console with colors and
+        /// customizable formatting options.
+        ///
+        /// __Parameters__
+        ///
+        /// - `event`: Log event to output
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_console_output(log_event_t *event) {
+            FILE *stream = (FILE*)event->user_data;
+            char time_buf[32];
+            int written = 0;
+            
+            /* Format timestamp */
+            strftime(time_buf, sizeof(time_buf), "%H:%M:%S", event->time);
+            
+            /* Print timestamp and level */
+            if (logger_state.config.use_colors) {
+                written += fprintf(stream, "%s %s%-5s%s ", 
+                        time_buf, 
+                        level_colors[event->level], 
+                        level_strings[event->level], 
+                        color_reset);
+            } else {
+                written += fprintf(stream, "%s %-5s ", time_buf, level_strings[event->level]);
+            }
+            
+            /* Print file and line if enabled */
+            if (logger_state.config.show_file_line) {
+                if (logger_state.config.use_colors) {
+                    written += fprintf(stream, "%s%s:%d:%s ", 
+                            color_reset, event->file, event->line, color_reset);
+                } else {
+                    written += fprintf(stream, "%s:%d: ", event->file, event->line);
+                }
+            }
+            
+            /* Print function if enabled */
+            if (logger_state.config.show_function) {
+                if (logger_state.config.use_colors) {
+                    written += fprintf(stream, "%s[%s]%s ", 
+                            color_reset, event->function, color_reset);
+                } else {
+                    written += fprintf(stream, "[%s] ", event->function);
+                }
+            }
+            
+            /* Print thread and context fields if enabled */
+            if (logger_state.config.show_context) {
+                char context[MAX_CONTEXT_LEN];
+                render_context(context, sizeof(context), event);
+                written += fprintf(stream, "%s ", context);
+            }
+            
+            /* Print the actual message */
+            written += vfprintf(stream, event->fmt, event->ap);
+            written += fprintf(stream, "\n");
+            if (!logger_state.batching) {
+                fflush(stream);
+            }
+            
+            output_bytes_written += (uint64_t)(written > 0 ? written : 0);
+        }
+
+        /// Built-in file output function.
+        ///
+        /// Formats and outputs log messages to files with detailed timestamps
+        /// and no color codes.
+        ///
+        /// __Parameters__
+        ///
+        /// - `event`: Log event to output
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_file_output(log_event_t *event) {
+            FILE *file = (FILE*)event->user_data;
+            char time_buf[64];
+            int written = 0;
+            
+            /* Rendered by a format worker, only the copy is left */
+            if (record_rendered_line.event == event) {
+                output_bytes_written += fwrite(record_rendered_line.text, 1, record_rendered_line.length, file);
+                if (!logger_state.batching) {
+                    fflush(file);
+                }
+                return;
+            }
+            
+            /* Format timestamp with date */
+            strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", event->time);
+            
+            /* Print to file */
+            written += fprintf(file, "%s %-5s %s:%d", 
+                    time_buf, 
+                    level_strings[event->level], 
+                    event->file, 
+                    event->line);
+            
+            if (logger_state.config.show_function) {
+                written += fprintf(file, " [%s]", event->function);
+            }
+            
+            if (logger_state.config.show_context) {
+                char context[MAX_CONTEXT_LEN];
+                render_context(context, sizeof(context), event);
+                written += fprintf(file, " %s", context);
+            }
+            
+            written += fprintf(file, ": ");
+            written += vfprintf(file, event->fmt, event->ap);
+            written += fprintf(file, "\n");
+            if (!logger_state.batching) {
+                fflush(file);
+            }
+            
+            output_bytes_written += (uint64_t)(written > 0 ? written : 0);
+        }
+
+        /// Built-in JSON lines output function.
+        ///
+        /// Writes each event as one JSON object on its own line, with the
+        /// thread id, thread name and context fields as separate members so
+        /// log pipelines can index them without parsing the message.
+        ///
+        /// __Parameters__
+        ///
+        /// - `event`: Log event to output
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_json_output(log_event_t *event) {
+            FILE *file = (FILE*)event->user_data;
+            char time_buf[64];
+            char stack_message[MAX_MESSAGE_LEN];
+            char *message = stack_message;
+            int written = 0;
+            va_list copy;
+            
+            strftime(time_buf, sizeof(time_buf), "%Y-%m-%dT%H:%M:%S", event->time);
+            va_copy(copy, event->ap);
+            int len = vsnprintf(message, sizeof(stack_message), event->fmt, event->ap);
+            /* Multi-line records such as hexdumps outgrow the stack buffer */
+            if (len >= (int)sizeof(stack_message) && !record_pool.bounded && (message = malloc((size_t)len + 1))) {
+                vsnprintf(message, (size_t)len + 1, event->fmt, copy);
+            } else {
+                message = stack_message;
+            }
+            va_end(copy);
+            
+            written += fprintf(file, "{\"ts_ns\":%lld,\"time\":\"%s\",\"level\":\"%s\",\"file\":",
+                               (long long)event->timestamp_ns, time_buf, level_strings[event->level]);
+            written += write_json_string(file, event->file);
+            written += fprintf(file, ",\"line\":%d,\"function\":", event->line);
+            written += write_json_string(file, event->function);
+            if (event->category) {
+                written += fprintf(file, ",\"category\":");
+                written += write_json_string(file, event->category);
+            }
+            written += fprintf(file, ",\"tid\":%d", event->thread_id);
+            if (event->thread_name) {
+                written += fprintf(file, ",\"thread\":");
+                written += write_json_string(file, event->thread_name);
+            }
+            written += fprintf(file, ",\"msg\":");
+            written += write_json_string(file, message);
+            if (event->context_count) {
+                written += fprintf(file, ",\"ctx\":{");
+                for (int i = 0; i < event->context_count; i++) {
+                    if (i) {
+                        written += fprintf(file, ",");
+                    }
+                    written += write_json_string(file, event->context[i].key);
+                    written += fprintf(file, ":");
+                    written += write_json_string(file, event->context[i].value);
+                }
+                written += fprintf(file, "}");
+            }
+            written += fprintf(file, "}\n");
+            if (!logger_state.batching) {
+                fflush(file);
+            }
+            if (message != stack_message) {
+                free(message);
+            }
+            
+            output_bytes_written += (uint64_t)(written > 0 ? written : 0);
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── FILE INDEX ────────────────────────────┐
+
+        /* Append the current block's entry and start a new block */
+        static void file_index_close_block(file_index_t *index) {
+            if (index->block.count == 0) {
+                return;
+            }
+            
+            fwrite(&index->block, sizeof(index->block), 1, index->index);
+            fflush(index->index);
+            
+            memset(&index->block, 0, sizeof(index->block));
+        }
+
+        /* Account one record that was just written to the indexed file */
+        static void file_index_note(file_index_t *index, const log_event_t *event, uint64_t bytes) {
+            log_index_entry_t *block = &index->block;
+            
+            if (block->count == 0) {
+                block->offset = index->offset;
+                block->first_ns = event->timestamp_ns;
+                block->last_ns = event->timestamp_ns;
+            }
+            if (event->timestamp_ns < block->first_ns) block->first_ns = event->timestamp_ns;
+            if (event->timestamp_ns > block->last_ns) block->last_ns = event->timestamp_ns;
+            block->level_mask |= 1u << event->level;
+            block->count++;
+            index->offset += bytes;
+            
+            if (block->count >= index->every) {
+                file_index_close_block(index);
+            }
+        }
+
+        /// Keep a sparse time/level index next to a file output.
+        ///
+        /// Every `every` records the output appends one entry to `index_file`
+        /// with the byte offset of the block in the log, its first and last
+        /// timestamps and a bitmap of the levels it contains. `loggin-query`
+        /// uses the entries to read only the blocks that can match. The index
+        /// file stays owned by the caller, like the log file.
+        ///
+        /// __Parameters__
+        ///
+        /// - `file`: File already registered with `logger_add_file_output`
+        /// - `index_file`: File to append index entries to
+        /// - `every`: Records per index entry
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 if `file` is not a file output or on bad arguments
+        int logger_set_file_index(FILE *file, FILE *index_file, unsigned every) {
+            struct stat st;
+            
+            if (!file || !index_file || every == 0) {
+                return -1;
+            }
+            
+            int output = logger_find_output(logger_file_output, file);
+            if (output < 0) {
+                return -1;
+            }
+            
+            file_index_t *index = calloc(1, sizeof(*index));
+            if (!index) {
+                return -1;
+            }
+            index->index = index_file;
+            index->every = every;
+            
+            /* Offsets are tracked from here on, starting at the current end */
+            fflush(file);
+            index->offset = fstat(fileno(file), &st) == 0 ? (uint64_t)st.st_size : 0;
+            
+            fflush(index_file);
+            if (fstat(fileno(index_file), &st) == 0 && st.st_size == 0) {
+                log_index_header_t header = { .magic = LOGGER_INDEX_MAGIC, .version = 1, .every = every };
+                fwrite(&header, sizeof(header), 1, index_file);
+                fflush(index_file);
+            }
+            
+            lock_logger();
+            
+            output_handler_t *out = &logger_state.outputs[output];
+            if (out->index) {
+                file_index_close_block(out->index);
+                free(out->index);
+            }
+            out->index = index;
+            
+            unlock_logger();
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── COMPRESSED OUTPUT ────────────────────────────┐
+
+        #define LZ_HASH_BITS 12
+        #define LZ_MIN_MATCH 4
+        #define LZ_MAX_OFFSET 65535
+
+        static uint32_t read32(const unsigned char *p) {
+            uint32_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        /* Write a 4-bit length nibble's overflow as 255-runs */
+        static unsigned char *lz_put_length(unsigned char *op, size_t len) {
+            for (len -= 15; len >= 255; len -= 255) {
+                *op++ = 255;
+            }
+            *op++ = (unsigned char)len;
+            return op;
+        }
+
+        /* Emit one sequence: literals, then an optional back-reference */
+        static unsigned char *lz_put_sequence(unsigned char *op, const unsigned char *lit, size_t lit_len,
+                                              size_t offset, size_t match_len) {
+            size_t match_code = match_len ? match_len - LZ_MIN_MATCH : 0;
+            
+            *op++ = (unsigned char)(((lit_len < 15 ? lit_len : 15) << 4) | (match_code < 15 ? match_code : 15));
+            if (lit_len >= 15) {
+                op = lz_put_length(op, lit_len);
+            }
+            memcpy(op, lit, lit_len);
+            op += lit_len;
+            
+            if (match_len) {
+                *op++ = (unsigned char)(offset & 0xff);
+                *op++ = (unsigned char)(offset >> 8);
+                if (match_code >= 15) {
+                    op = lz_put_length(op, match_code);
+                }
+            }
+            return op;
+        }
+
+        /// Worst-case compressed size for `logger_lz_compress`.
+        ///
+        /// __Parameters__
+        ///
+        /// - `size`: Input size in bytes
+        ///
+        /// __Return__
+        ///
+        /// - Output capacity that is always large enough
+        size_t logger_lz_bound(size_t size) {
+            return size + size / 255 + 16;
+        }
+
+        /// Compress a block with the built-in LZ codec.
+        ///
+        /// Greedy LZ77 with a 4 KiB-entry hash table and a 64 KiB window,
+        /// encoded as LZ4-style sequences. Fast rather than tight.
+        ///
+        /// __Parameters__
+        ///
+        /// - `src`: Input bytes
+        /// - `size`: Input size
+        /// - `dst`: Output buffer
+        /// - `capacity`: Output capacity, at least `logger_lz_bound(size)`
+        ///
+        /// __Return__
+        ///
+        /// - Compressed size, or 0 if `capacity` is too small
+        size_t logger_lz_compress(const void *src, size_t size, void *dst, size_t capacity) {
+            const unsigned char *in = (const unsigned char*)src;
+            unsigned char *op = (unsigned char*)dst;
+            uint32_t table[1u << LZ_HASH_BITS] = {0};
+            size_t ip = 0;
+            size_t anchor = 0;
+            
+            if (capacity < logger_lz_bound(size)) {
+                return 0;
+            }
+            
+            while (ip + LZ_MIN_MATCH <= size) {
+                uint32_t seq = read32(in + ip);
+                uint32_t hash = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+                size_t ref = table[hash];
+                table[hash] = (uint32_t)ip;
+                
+                if (ref < ip && ip - ref <= LZ_MAX_OFFSET && read32(in + ref) == seq) {
+                    size_t len = LZ_MIN_MATCH;
+                    while (ip + len < size && in[ref + len] == in[ip + len]) {
+                        len++;
+                    }
+                    op = lz_put_sequence(op, in + anchor, ip - anchor, ip - ref, len);
+                    ip += len;
+                    anchor = ip;
+                } else {
+                    ip++;
+                }
+            }
+            
+            /* Trailing literals close the block */
+            op = lz_put_sequence(op, in + anchor, size - anchor, 0, 0);
+            return (size_t)(op - (unsigned char*)dst);
+        }
+
+        /* Read a 255-run length extension, false on truncated input */
+        static bool lz_get_length(const unsigned char **ip, const unsigned char *end, size_t *len) {
+            unsigned char b;
+            do {
+                if (*ip >= end) {
+                    return false;
+                }
+                b = *(*ip)++;
+                *len += b;
+            } while (b == 255);
+            return true;
+        }
+
+        /// Decompress a block produced by `logger_lz_compress`.
+        ///
+        /// __Parameters__
+        ///
+        /// - `src`: Compressed bytes
+        /// - `size`: Compressed size
+        /// - `dst`: Output buffer
+        /// - `capacity`: Output capacity
+        ///
+        /// __Return__
+        ///
+        /// - Decompressed size, or -1 on corrupt input or short output
+        long logger_lz_decompress(const void *src, size_t size, void *dst, size_t capacity) {
+            const unsigned char *ip = (const unsigned char*)src;
+            const unsigned char *end = ip + size;
+            unsigned char *out = (unsigned char*)dst;
+            size_t op = 0;
+            
+            while (ip < end) {
+                unsigned char token = *ip++;
+                size_t lit_len = token >> 4;
+                size_t match_len = token & 15;
+                
+                if (lit_len == 15 && !lz_get_length(&ip, end, &lit_len)) {
+                    return -1;
+                }
+                if (lit_len > (size_t)(end - ip) || lit_len > capacity - op) {
+                    return -1;
+                }
+                memcpy(out + op, ip, lit_len);
+                ip += lit_len;
+                op += lit_len;
+                
+                if (ip == end) {
+                    break;
+                }
+                
+                if (end - ip < 2) {
+                    return -1;
+                }
+                size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+                ip += 2;
+                if (match_len == 15 && !lz_get_length(&ip, end, &match_len)) {
+                    return -1;
+                }
+                match_len += LZ_MIN_MATCH;
+                if (offset == 0 || offset > op || match_len > capacity - op) {
+                    return -1;
+                }
+                
+                /* Byte copy, matches may overlap their own output */
+                for (size_t i = 0; i < match_len; i++, op++) {
+                    out[op] = out[op - offset];
+                }
+            }
+            return (long)op;
+        }
+
+        /* Compress and append one frame */
+        static void write_frame(FILE *file, const frame_buffer_t *frame, unsigned char *packed, size_t capacity) {
+            log_frame_header_t header = {
+                .magic = LOGGER_FRAME_MAGIC,
+                .raw_size = frame->size,
+                .record_count = frame->count,
+                .first_ns = frame->first_ns,
+                .last_ns = frame->last_ns
+            };
+            
+            size_t packed_size = packed ? logger_lz_compress(frame->data, frame->size, packed, capacity) : 0;
+            const void *payload = packed;
+            if (packed_size == 0 || packed_size >= frame->size) {
+                /* Incompressible or no scratch buffer, store as-is */
+                header.flags = LOGGER_FRAME_STORED;
+                packed_size = frame->size;
+                payload = frame->data;
+            }
+            header.packed_size = (uint32_t)packed_size;
+            
+            fwrite(&header, sizeof(header), 1, file);
+            fwrite(payload, 1, packed_size, file);
+            fflush(file);
+        }
+
+        /* Compressor thread: takes sealed frames off the hot path */
+        static void *compressed_sink_main(void *arg) {
+            compressed_sink_t *sink = (compressed_sink_t*)arg;
+            size_t capacity = logger_lz_bound(LOGGER_FRAME_SIZE);
+            unsigned char *packed = malloc(capacity);
+            
+            pthread_mutex_lock(&sink->mutex);
+            for (;;) {
+                while (sink->sealed < 0 && !sink->stop) {
+                    pthread_cond_wait(&sink->cond, &sink->mutex);
+                }
+                if (sink->sealed < 0) {
+                    break;
+                }
+                
+                frame_buffer_t *frame = &sink->frames[sink->sealed];
+                pthread_mutex_unlock(&sink->mutex);
+                
+                write_frame(sink->file, frame, packed, capacity);
+                
+                pthread_mutex_lock(&sink->mutex);
+                frame->size = 0;
+                frame->count = 0;
+                sink->sealed = -1;
+                pthread_cond_broadcast(&sink->cond);
+            }
+            pthread_mutex_unlock(&sink->mutex);
+            
+            free(packed);
+            return NULL;
+        }
+
+        /* Hand the active frame to the compressor, waiting if it is still busy */
+        static void compressed_sink_seal(compressed_sink_t *sink) {
+            pthread_mutex_lock(&sink->mutex);
+            while (sink->sealed >= 0) {
+                pthread_cond_wait(&sink->cond, &sink->mutex);
+            }
+            if (sink->frames[sink->active].size > 0) {
+                sink->sealed = sink->active;
+                sink->active ^= 1;
+                pthread_cond_broadcast(&sink->cond);
+            }
+            pthread_mutex_unlock(&sink->mutex);
+        }
+
+        /* Seal the partial frame and wait until it is on disk */
+        static void compressed_sink_flush(compressed_sink_t *sink) {
+            compressed_sink_seal(sink);
+            
+            pthread_mutex_lock(&sink->mutex);
+            while (sink->sealed >= 0) {
+                pthread_cond_wait(&sink->cond, &sink->mutex);
+            }
+            pthread_mutex_unlock(&sink->mutex);
+        }
+
+        static void compressed_sink_destroy(compressed_sink_t *sink) {
+            compressed_sink_flush(sink);
+            
+            pthread_mutex_lock(&sink->mutex);
+            sink->stop = true;
+            pthread_cond_broadcast(&sink->cond);
+            pthread_mutex_unlock(&sink->mutex);
+            pthread_join(sink->thread, NULL);
+            
+            fclose(sink->file);
+            pthread_mutex_destroy(&sink->mutex);
+            pthread_cond_destroy(&sink->cond);
+            free(sink->frames[0].data);
+            free(sink->frames[1].data);
+            free(sink);
+        }
+
+        /// Add compressed file output handler.
+        ///
+        /// Records are written in the `logger_file_output` text format into
+        /// 64 KiB frames. Full frames are compressed with the built-in LZ
+        /// codec on a background thread, so the logging thread only copies
+        /// text. Each frame header carries its first and last timestamps and
+        /// frames can be decoded independently; `loggin-zcat` reads them back.
+        /// The file is opened for appending and owned by the logger.
+        ///
+        /// __Parameters__
+        ///
+        /// - `path`: File to append frames to
+        /// - `level`: Minimum log level for this output
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on failure
+        int logger_add_compressed_output(const char *path, log_level_t level) {
+            if (!path) {
+                return -1;
+            }
+            
+            compressed_sink_t *sink = calloc(1, sizeof(*sink));
+            if (!sink) {
+                return -1;
+            }
+            sink->sealed = -1;
+            sink->frames[0].data = malloc(LOGGER_FRAME_SIZE);
+            sink->frames[1].data = malloc(LOGGER_FRAME_SIZE);
+            sink->file = fopen(path, "ab");
+            pthread_mutex_init(&sink->mutex, NULL);
+            pthread_cond_init(&sink->cond, NULL);
+            
+            if (!sink->frames[0].data || !sink->frames[1].data || !sink->file ||
+                pthread_create(&sink->thread, NULL, compressed_sink_main, sink) != 0) {
+                if (sink->file) fclose(sink->file);
+                pthread_mutex_destroy(&sink->mutex);
+                pthread_cond_destroy(&sink->cond);
+                free(sink->frames[0].data);
+                free(sink->frames[1].data);
+                free(sink);
+                return -1;
+            }
+            
+            if (logger_add_custom_output(logger_compressed_output, sink, level) != 0) {
+                compressed_sink_destroy(sink);
+                return -1;
+            }
+            return 0;
+        }
+
+        /// Built-in compressed output function.
+        ///
+        /// Appends the formatted line to the sink's active frame and seals
+        /// the frame once the next line no longer fits.
+        ///
+        /// __Parameters__
+        ///
+        /// - `event`: Log event to output
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_compressed_output(log_event_t *event) {
+            compressed_sink_t *sink = (compressed_sink_t*)event->user_data;
+            int64_t now_ns = event->timestamp_ns;
+            
+            for (int attempt = 0; attempt < 2; attempt++) {
+                frame_buffer_t *frame = &sink->frames[sink->active];
+                size_t room = LOGGER_FRAME_SIZE - frame->size;
+                va_list ap;
+                
+                va_copy(ap, event->ap);
+                size_t len = render_file_line((char*)frame->data + frame->size, room, event, ap);
+                va_end(ap);
+                
+                /* render_file_line needs room for its terminator too */
+                if (len >= room && frame->size > 0) {
+                    compressed_sink_seal(sink);
+                    continue;
+                }
+                if (len >= room) {
+                    /* Longer than a whole frame, keep the head and end the line */
+                    len = room;
+                    frame->data[LOGGER_FRAME_SIZE - 1] = '\n';
+                }
+                
+                if (frame->count++ == 0) {
+                    frame->first_ns = now_ns;
+                }
+                frame->last_ns = now_ns;
+                frame->size += (uint32_t)len;
+                output_bytes_written += len;
+                return;
+            }
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── SPANS ────────────────────────────┐
+
+        /* Cheapest monotonic clock: the TSC on x86, converted to ns when reported */
+        static inline uint64_t span_clock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+            return __builtin_ia32_rdtsc();
+#else
+            return (uint64_t)monotonic_ns();
+#endif
+        }
+
+        /* 4 linear sub-buckets per power of two, so every bucket is within 25% */
+        static unsigned span_bucket(uint64_t ticks) {
+            if (ticks < 4) {
+                return (unsigned)ticks;
+            }
+            unsigned e = 63u - (unsigned)__builtin_clzll(ticks);
+            return (e - 1) * 4 + (unsigned)((ticks >> (e - 2)) & 3);
+        }
+
+        static uint64_t span_bucket_floor(unsigned bucket) {
+            if (bucket < 4) {
+                return bucket;
+            }
+            unsigned e = bucket / 4 + 1;
+            return (uint64_t)(4 + bucket % 4) << (e - 2);
+        }
+
+        /* Ticks to ns from the clock's run since the first span, caller holds the span mutex */
+        static double span_calibrate(void) {
+#if defined(__x86_64__) || defined(__i386__)
+            for (;;) {
+                int64_t ns = monotonic_ns();
+                uint64_t ticks = span_clock();
+                /* Below a millisecond the ratio is mostly read jitter */
+                if (ns - span_state.base_ns >= 1000000 && ticks > span_state.base_ticks) {
+                    span_state.ns_per_tick = (double)(ns - span_state.base_ns) / (double)(ticks - span_state.base_ticks);
+                    break;
+                }
+            }
+#else
+            span_state.ns_per_tick = 1.0;
+#endif
+            return span_state.ns_per_tick;
+        }
+
+        /* Give a site its histogram slot on first use */
+        static int span_register(log_span_site_t *site) {
+            pthread_mutex_lock(&span_state.mutex);
+            
+            int id = site->id;
+            if (id == 0) {
+                if (span_state.site_count == 0) {
+                    span_state.base_ns = monotonic_ns();
+                    span_state.base_ticks = span_clock();
+                    span_state.pid = (int)getpid();
+                }
+                id = span_state.site_count < MAX_SPAN_SITES ? ++span_state.site_count : -1;
+                if (id > 0) {
+                    span_state.sites[id - 1] = site;
+                }
+                __atomic_store_n(&site->id, id, __ATOMIC_RELEASE);
+            }
+            
+            pthread_mutex_unlock(&span_state.mutex);
+            return id;
+        }
+
+        static void span_thread_release(void *arg) {
+            __atomic_store_n(&((span_thread_t*)arg)->owned, false, __ATOMIC_RELEASE);
+        }
+
+        static void span_key_create(void) {
+            pthread_key_create(&span_thread_key, span_thread_release);
+        }
+
+        /* Adopt an abandoned thread block or push a new one; histograms are never freed */
+        static span_thread_t *span_thread_attach(void) {
+            span_thread_t *thread;
+            
+            pthread_once(&span_key_once, span_key_create);
+            
+            for (thread = __atomic_load_n(&span_state.threads, __ATOMIC_ACQUIRE); thread; thread = thread->next) {
+                bool expected = false;
+                if (__atomic_compare_exchange_n(&thread->owned, &expected, true, false,
+                                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                    break;
+                }
+            }
+            
+            if (!thread) {
+                thread = calloc(1, sizeof(*thread));
+                if (!thread) {
+                    return NULL;
+                }
+                thread->owned = true;
+                thread->next = __atomic_load_n(&span_state.threads, __ATOMIC_RELAXED);
+                while (!__atomic_compare_exchange_n(&span_state.threads, &thread->next, thread, true,
+                                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+                }
+            }
+            
+            thread->tid = logger_thread_id();
+            pthread_setspecific(span_thread_key, thread);
+            span_thread = thread;
+            return thread;
+        }
+
+        /* One complete ("X") trace event per span */
+        static void span_trace_write(const log_span_site_t *site, const span_thread_t *thread, uint64_t start, uint64_t ticks) {
+            pthread_mutex_lock(&span_state.mutex);
+            
+            FILE *trace = span_state.trace;
+            if (trace) {
+                double ns_per_tick = span_state.ns_per_tick > 0 ? span_state.ns_per_tick : span_calibrate();
+                double ts_us = (double)(int64_t)(start - span_state.base_ticks) * ns_per_tick / 1000.0;
+                double dur_us = (double)ticks * ns_per_tick / 1000.0;
+                
+                fputs(span_state.trace_first ? "{\"name\":" : ",\n{\"name\":", trace);
+                write_json_string(trace, site->name);
+                fprintf(trace, ",\"cat\":\"span\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                        ts_us, dur_us, span_state.pid, thread->tid);
+                span_state.trace_first = false;
+            }
+            
+            pthread_mutex_unlock(&span_state.mutex);
+        }
+
+        /// Start a span.
+        ///
+        /// Called by `LOG_SPAN`, which ends the span when its scope closes.
+        ///
+        /// __Parameters__
+        ///
+        /// - `site`: Static call site of the span
+        ///
+        /// __Return__
+        ///
+        /// - Running span
+        log_span_t logger_span_begin(log_span_site_t *site) {
+            log_span_t span = { site, span_clock() };
+            return span;
+        }
+
+        /// End a span and record its duration.
+        ///
+        /// Adds the duration to the calling thread's histogram for the site
+        /// without locking, and writes a trace event when a trace file is
+        /// set. The first span of a site or thread sets up its storage.
+        ///
+        /// __Parameters__
+        ///
+        /// - `span`: Span returned by `logger_span_begin`
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_span_end(log_span_t *span) {
+            uint64_t ticks = span_clock() - span->start;
+            log_span_site_t *site = span->site;
+            
+            int id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+            if (id == 0) {
+                id = span_register(site);
+            }
+            if (id < 0) {
+                return;
+            }
+            
+            span_thread_t *thread = span_thread ? span_thread : span_thread_attach();
+            if (!thread) {
+                return;
+            }
+            
+            span_histogram_t *hist = thread->histograms[id - 1];
+            if (!hist) {
+                hist = calloc(1, sizeof(*hist));
+                if (!hist) {
+                    return;
+                }
+                __atomic_store_n(&thread->histograms[id - 1], hist, __ATOMIC_RELEASE);
+            }
+            
+            /* Single writer per block, the reporter only needs untorn values */
+            unsigned bucket = span_bucket(ticks);
+            __atomic_store_n(&hist->buckets[bucket], hist->buckets[bucket] + 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&hist->count, hist->count + 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&hist->sum, hist->sum + ticks, __ATOMIC_RELAXED);
+            
+            if (__atomic_load_n(&span_state.trace, __ATOMIC_RELAXED)) {
+                span_trace_write(site, thread, span->start, ticks);
+            }
+        }
+
+        /* Bucket midpoint holding the q-th quantile, in ns */
+        static double span_quantile(const uint64_t *buckets, uint64_t total, double q, double ns_per_tick) {
+            uint64_t rank = (uint64_t)(q * (double)total + 0.999999);
+            uint64_t seen = 0;
+            unsigned b = 0;
+            
+            for (; b < SPAN_BUCKETS - 1; b++) {
+                seen += buckets[b];
+                if (seen >= (rank ? rank : 1)) {
+                    break;
+                }
+            }
+            uint64_t low = span_bucket_floor(b);
+            uint64_t high = b + 1 < SPAN_BUCKETS ? span_bucket_floor(b + 1) : low;
+            return ((double)low + (double)(high - low) / 2.0) * ns_per_tick;
+        }
+
+        static void format_duration(char *buf, size_t size, double ns) {
+            if (ns < 1e3) {
+                snprintf(buf, size, "%.0fns", ns);
+            } else if (ns < 1e6) {
+                snprintf(buf, size, "%.1fus", ns / 1e3);
+            } else if (ns < 1e9) {
+                snprintf(buf, size, "%.1fms", ns / 1e6);
+            } else {
+                snprintf(buf, size, "%.2fs", ns / 1e9);
+            }
+        }
+
+        /// Log percentile summaries of every span site.
+        ///
+        /// Merges all threads' histograms and logs one INFO line per site
+        /// with the count and p50/p90/p99/max of the spans that ended since
+        /// the previous report. Sites without new spans are skipped.
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_span_report(void) {
+            struct {
+                log_span_site_t *site;
+                uint64_t count;
+                double p50, p90, p99, max;
+            } rows[MAX_SPAN_SITES];
+            int row_count = 0;
+            
+            pthread_mutex_lock(&span_state.mutex);
+            
+            if (!span_state.reported) {
+                span_state.reported = calloc(MAX_SPAN_SITES, sizeof(*span_state.reported));
+            }
+            if (!span_state.reported || span_state.site_count == 0) {
+                pthread_mutex_unlock(&span_state.mutex);
+                return;
+            }
+            double ns_per_tick = span_calibrate();
+            
+            for (int i = 0; i < span_state.site_count; i++) {
+                uint64_t delta[SPAN_BUCKETS] = {0};
+                uint64_t total = 0;
+                int top = 0;
+                
+                for (span_thread_t *t = __atomic_load_n(&span_state.threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+                    span_histogram_t *hist = __atomic_load_n(&t->histograms[i], __ATOMIC_ACQUIRE);
+                    for (int b = 0; hist && b < SPAN_BUCKETS; b++) {
+                        delta[b] += __atomic_load_n(&hist->buckets[b], __ATOMIC_RELAXED);
+                    }
+                }
+                /* Counters only grow, so the interval is the difference to the last report */
+                for (int b = 0; b < SPAN_BUCKETS; b++) {
+                    uint64_t now = delta[b];
+                    delta[b] = now - span_state.reported[i][b];
+                    span_state.reported[i][b] = now;
+                    total += delta[b];
+                    top = delta[b] ? b : top;
+                }
+                if (total == 0) {
+                    continue;
+                }
+                
+                rows[row_count].site = span_state.sites[i];
+                rows[row_count].count = total;
+                rows[row_count].p50 = span_quantile(delta, total, 0.50, ns_per_tick);
+                rows[row_count].p90 = span_quantile(delta, total, 0.90, ns_per_tick);
+                rows[row_count].p99 = span_quantile(delta, total, 0.99, ns_per_tick);
+                rows[row_count].max = (double)span_bucket_floor((unsigned)top + 1 < SPAN_BUCKETS ? (unsigned)top + 1 : (unsigned)top) * ns_per_tick;
+                row_count++;
+            }
+            
+            pthread_mutex_unlock(&span_state.mutex);
+            
+            /* Log outside the span mutex, outputs may use spans themselves */
+            for (int i = 0; i < row_count; i++) {
+                char p50[16], p90[16], p99[16], max[16];
+                format_duration(p50, sizeof(p50), rows[i].p50);
+                format_duration(p90, sizeof(p90), rows[i].p90);
+                format_duration(p99, sizeof(p99), rows[i].p99);
+                format_duration(max, sizeof(max), rows[i].max);
+                logger_log(LOG_LEVEL_INFO, rows[i].site->file, "span", rows[i].site->line,
+                           "span %s: n=%llu p50=%s p90=%s p99=%s max<%s",
+                           rows[i].site->name, (unsigned long long)rows[i].count, p50, p90, p99, max);
+            }
+        }
+
+        /// Report span summaries on an interval.
+        ///
+        /// The background ticker calls `logger_span_report` every
+        /// `interval_ms`. `logger_cleanup` stops it.
+        ///
+        /// __Parameters__
+        ///
+        /// - `interval_ms`: Report interval, 0 to stop reporting
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 if the ticker thread cannot be started
+        int logger_set_span_interval(unsigned interval_ms) {
+            pthread_mutex_lock(&ticker_state.mutex);
+            ticker_state.span_interval_ms = interval_ms;
+            pthread_mutex_unlock(&ticker_state.mutex);
+            return ticker_restart();
+        }
+
+        /// Write every span as a Chrome trace event.
+        ///
+        /// Spans are appended to `file` as a JSON array of complete ("X")
+        /// events that chrome://tracing and Perfetto load directly.
+        /// Replacing or clearing the file closes the array. The file stays
+        /// owned by the caller.
+        ///
+        /// __Parameters__
+        ///
+        /// - `file`: Trace file, or NULL to stop tracing
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_set_span_trace(FILE *file) {
+            pthread_mutex_lock(&span_state.mutex);
+            
+            if (span_state.trace) {
+                fputs("\n]\n", span_state.trace);
+                fflush(span_state.trace);
+            }
+            if (file) {
+                fputs("[\n", file);
+            }
+            span_state.trace_first = true;
+            __atomic_store_n(&span_state.trace, file, __ATOMIC_RELAXED);
+            
+            pthread_mutex_unlock(&span_state.mutex);
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── PROFILER ────────────────────────────┐
+
+        static void profile_thread_release(void *arg) {
+            __atomic_store_n(&((profile_thread_t*)arg)->owned, false, __ATOMIC_RELEASE);
+        }
+
+        static void profile_key_create(void) {
+            pthread_key_create(&profile_thread_key, profile_thread_release);
+        }
+
+        static void profile_thread_push(profile_thread_t *thread) {
+            thread->epoch = __atomic_load_n(&profile_state.epoch, __ATOMIC_ACQUIRE);
+            thread->next = __atomic_load_n(&profile_state.threads, __ATOMIC_RELAXED);
+            while (!__atomic_compare_exchange_n(&profile_state.threads, &thread->next, thread, true,
+                                                __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            }
+        }
+
+        /* Allocate unowned blocks up front so threads can attach in bounded mode without malloc */
+        static void profile_reserve(void) {
+            static pthread_mutex_t reserve_mutex = PTHREAD_MUTEX_INITIALIZER;
+            unsigned count = 0;
+            
+            pthread_mutex_lock(&reserve_mutex);
+            for (profile_thread_t *t = __atomic_load_n(&profile_state.threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+                count++;
+            }
+            for (; count < BOUNDED_THREAD_BLOCKS; count++) {
+                profile_thread_t *thread = calloc(1, sizeof(*thread));
+                if (!thread) {
+                    break;
+                }
+                profile_thread_push(thread);
+            }
+            pthread_mutex_unlock(&reserve_mutex);
+        }
+
+        /* Adopt an abandoned counter block or push a new one; blocks are never freed */
+        static profile_thread_t *profile_thread_attach(void) {
+            profile_thread_t *thread;
+            
+            pthread_once(&profile_key_once, profile_key_create);
+            
+            for (thread = __atomic_load_n(&profile_state.threads, __ATOMIC_ACQUIRE); thread; thread = thread->next) {
+                bool expected = false;
+                if (!__atomic_load_n(&thread->owned, __ATOMIC_RELAXED) &&
+                    __atomic_compare_exchange_n(&thread->owned, &expected, true, false,
+                                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                    break;
+                }
+            }
+            
+            if (!thread) {
+                /* Under a memory budget only reserved blocks are used; this thread goes uncounted */
+                if (record_pool.bounded) {
+                    return NULL;
+                }
+                thread = calloc(1, sizeof(*thread));
+                if (!thread) {
+                    return NULL;
+                }
+                thread->owned = true;
+                profile_thread_push(thread);
+            }
+            
+            pthread_setspecific(profile_thread_key, thread);
+            profile_thread = thread;
+            return thread;
+        }
+
+        /* Count one delivered event against its call site; only the owning thread writes */
+        static void profile_note(const log_event_t *event, uint64_t bytes) {
+            static const char unknown_file[] = "?";
+            profile_thread_t *thread = profile_thread ? profile_thread : profile_thread_attach();
+            
+            if (!thread || profile_reporting) {
+                return;
+            }
+            
+            /* A reset only bumps the epoch; each thread zeroes its own counters */
+            unsigned epoch = __atomic_load_n(&profile_state.epoch, __ATOMIC_ACQUIRE);
+            if (thread->epoch != epoch) {
+                for (int i = 0; i < PROFILE_SITES; i++) {
+                    __atomic_store_n(&thread->sites[i].events, 0, __ATOMIC_RELAXED);
+                    __atomic_store_n(&thread->sites[i].bytes, 0, __ATOMIC_RELAXED);
+                }
+                __atomic_store_n(&thread->other_events, 0, __ATOMIC_RELAXED);
+                __atomic_store_n(&thread->other_bytes, 0, __ATOMIC_RELAXED);
+                __atomic_store_n(&thread->epoch, epoch, __ATOMIC_RELEASE);
+            }
+            
+            const char *file = event->file ? event->file : unknown_file;
+            uint64_t hash = ((uint64_t)(uintptr_t)file ^ ((uint64_t)(unsigned)event->line << 40)) * 0x9e3779b97f4a7c15ull;
+            for (unsigned probe = 0; probe < PROFILE_PROBES; probe++) {
+                profile_site_t *site = &thread->sites[((hash >> 40) + probe) % PROFILE_SITES];
+                const char *site_file = site->file;
+                
+                if (!site_file) {
+                    /* Publish the key last so readers never see half a site */
+                    site->line = event->line;
+                    site->function = event->function;
+                    site->level = event->level;
+                    __atomic_store_n(&site->file, file, __ATOMIC_RELEASE);
+                    site_file = file;
+                }
+                if (site_file == file && site->line == event->line) {
+                    __atomic_store_n(&site->events, site->events + 1, __ATOMIC_RELAXED);
+                    __atomic_store_n(&site->bytes, site->bytes + bytes, __ATOMIC_RELAXED);
+                    return;
+                }
+            }
+            
+            __atomic_store_n(&thread->other_events, thread->other_events + 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&thread->other_bytes, thread->other_bytes + bytes, __ATOMIC_RELAXED);
+        }
+
+        static int profile_entry_compare(const void *a, const void *b) {
+            const log_profile_entry_t *x = (const log_profile_entry_t*)a;
+            const log_profile_entry_t *y = (const log_profile_entry_t*)b;
+            if (x->bytes != y->bytes) return x->bytes < y->bytes ? 1 : -1;
+            if (x->events != y->events) return x->events < y->events ? 1 : -1;
+            return 0;
+        }
+
+        /// Enable or disable the log volume profiler.
+        ///
+        /// While enabled, every delivered event is counted against its call
+        /// site (file and line) together with the bytes the built-in outputs
+        /// wrote for it. Counters live in per-thread tables, so counting
+        /// takes no lock. Events from sites beyond a thread's table size
+        /// are counted as "other". Under a memory budget, tables for 32
+        /// threads are allocated up front, and further threads are not
+        /// profiled while all of them are taken.
+        ///
+        /// __Parameters__
+        ///
+        /// - `enabled`: true to start counting, false to stop
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_set_profiler(bool enabled) {
+            if (enabled && record_pool.bounded) {
+                profile_reserve();
+            }
+            if (enabled && !__atomic_load_n(&profile_state.since_ns, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&profile_state.since_ns, monotonic_ns(), __ATOMIC_RELAXED);
+            }
+            __atomic_store_n(&profile_state.enabled, enabled, __ATOMIC_RELAXED);
+        }
+
+        /// Zero every profiler counter.
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_profile_reset(void) {
+            __atomic_store_n(&profile_state.since_ns, monotonic_ns(), __ATOMIC_RELAXED);
+            __atomic_add_fetch(&profile_state.epoch, 1, __ATOMIC_ACQ_REL);
+        }
+
+        /// Get the noisiest call sites.
+        ///
+        /// Merges every thread's counters and returns the sites sorted by
+        /// bytes written, then by event count.
+        ///
+        /// __Parameters__
+        ///
+        /// - `entries`: Array receiving up to `max` sites
+        /// - `max`: Capacity of `entries`
+        /// - `total`: Receives the sums over all sites, may be NULL
+        ///
+        /// __Return__
+        ///
+        /// - Number of entries filled, -1 if out of memory
+        int logger_profile_top(log_profile_entry_t *entries, int max, log_profile_entry_t *total) {
+            log_profile_entry_t *merged = calloc(PROFILE_MERGE_SITES + 1, sizeof(*merged));
+            if (!merged) {
+                return -1;
+            }
+            
+            unsigned epoch = __atomic_load_n(&profile_state.epoch, __ATOMIC_ACQUIRE);
+            log_profile_entry_t *other = &merged[PROFILE_MERGE_SITES];
+            int count = 0;
+            
+            other->file = "(other)";
+            for (profile_thread_t *thread = __atomic_load_n(&profile_state.threads, __ATOMIC_ACQUIRE);
+                 thread; thread = thread->next) {
+                if (__atomic_load_n(&thread->epoch, __ATOMIC_ACQUIRE) != epoch) {
+                    continue; /* Not counted anything since the last reset */
+                }
+                other->events += __atomic_load_n(&thread->other_events, __ATOMIC_RELAXED);
+                other->bytes += __atomic_load_n(&thread->other_bytes, __ATOMIC_RELAXED);
+                
+                for (int i = 0; i < PROFILE_SITES; i++) {
+                    profile_site_t *site = &thread->sites[i];
+                    const char *file = __atomic_load_n(&site->file, __ATOMIC_ACQUIRE);
+                    uint64_t events = __atomic_load_n(&site->events, __ATOMIC_RELAXED);
+                    uint64_t bytes = __atomic_load_n(&site->bytes, __ATOMIC_RELAXED);
+                    if (!file || events == 0) {
+                        continue;
+                    }
+                    
+                    /* The same header line compiled into two objects has two file pointers */
+                    int j = 0;
+                    while (j < count && !(merged[j].line == site->line &&
+                                          (merged[j].file == file || strcmp(merged[j].file, file) == 0))) {
+                        j++;
+                    }
+                    log_profile_entry_t *entry = j < count ? &merged[j] : j < PROFILE_MERGE_SITES ? &merged[count++] : other;
+                    if (entry != other && entry->events == 0) {
+                        entry->file = file;
+                        entry->function = site->function;
+                        entry->line = site->line;
+                        entry->level = site->level;
+                    }
+                    entry->events += events;
+                    entry->bytes += bytes;
+                }
+            }
+            
+            qsort(merged, (size_t)count, sizeof(*merged), profile_entry_compare);
+            
+            if (total) {
+                memset(total, 0, sizeof(*total));
+                for (int i = 0; i <= PROFILE_MERGE_SITES; i++) {
+                    total->events += merged[i].events;
+                    total->bytes += merged[i].bytes;
+                }
+            }
+            
+            int filled = entries ? (count < max ? count : max) : 0;
+            if (filled > 0) {
+                memcpy(entries, merged, (size_t)filled * sizeof(*entries));
+            }
+            free(merged);
+            return filled;
+        }
+
+        /* Human-readable byte count */
+        static void format_bytes(char *buf, size_t size, unsigned long long bytes) {
+            if (bytes < 1024) {
+                snprintf(buf, size, "%llu B", bytes);
+            } else if (bytes < 1024 * 1024) {
+                snprintf(buf, size, "%.1f KiB", (double)bytes / 1024);
+            } else {
+                snprintf(buf, size, "%.1f MiB", (double)bytes / (1024 * 1024));
+            }
+        }
+
+        /// Log the noisiest call sites.
+        ///
+        /// Writes a summary line and one line per site, in the format
+        /// `#1 app.c:120 INFO: 1200 events (60.0%), 84.2 KiB (61.3%)`, through
+        /// the outputs at INFO level. Report lines are not counted themselves.
+        ///
+        /// __Parameters__
+        ///
+        /// - `top_n`: Number of sites to list
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_profile_report(unsigned top_n) {
+            log_profile_entry_t entries[64];
+            log_profile_entry_t total;
+            char bytes[32];
+            
+            int count = logger_profile_top(entries, top_n < 64 ? (int)top_n : 64, &total);
+            if (count < 0) {
+                return;
+            }
+            
+            double seconds = (double)(monotonic_ns() - __atomic_load_n(&profile_state.since_ns, __ATOMIC_RELAXED)) / 1e9;
+            double events = total.events ? (double)total.events : 1;
+            double all_bytes = total.bytes ? (double)total.bytes : 1;
+            
+            profile_reporting = true;
+            format_bytes(bytes, sizeof(bytes), total.bytes);
+            logger_log(LOG_LEVEL_INFO, __FILE__, "profile", __LINE__, "log volume: %llu events, %s in %.1fs",
+                       total.events, bytes, seconds);
+            for (int i = 0; i < count; i++) {
+                format_bytes(bytes, sizeof(bytes), entries[i].bytes);
+                logger_log(LOG_LEVEL_INFO, __FILE__, "profile", __LINE__, "#%d %s:%d %s: %llu events (%.1f%%), %s (%.1f%%)",
+                           i + 1, entries[i].file, entries[i].line, logger_level_to_string(entries[i].level),
+                           entries[i].events, 100.0 * (double)entries[i].events / events,
+                           bytes, 100.0 * (double)entries[i].bytes / all_bytes);
+            }
+            profile_reporting = false;
+        }
+
+        /// Report the noisiest call sites on an interval.
+        ///
+        /// The background ticker calls `logger_profile_report` every
+        /// `interval_ms` and then resets the counters, so each report covers
+        /// one interval. Enables the profiler. `logger_cleanup` stops it.
+        ///
+        /// __Parameters__
+        ///
+        /// - `interval_ms`: Report interval, 0 to stop reporting
+        /// - `top_n`: Number of sites per report
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 if the ticker thread cannot be started
+        int logger_set_profile_interval(unsigned interval_ms, unsigned top_n) {
+            if (interval_ms) {
+                logger_set_profiler(true);
+            }
+            pthread_mutex_lock(&ticker_state.mutex);
+            ticker_state.profile_interval_ms = interval_ms;
+            ticker_state.profile_top = top_n;
+            pthread_mutex_unlock(&ticker_state.mutex);
+            return ticker_restart();
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── METRICS ────────────────────────────┐
+
+        /* Give a metric name its cell index on first use; sites sharing a name share the metric */
+        static int metric_register(log_metric_site_t *site) {
+            pthread_mutex_lock(&metric_state.mutex);
+            
+            int id = site->id;
+            for (int i = 0; id == 0 && i < metric_state.count; i++) {
+                if (metric_state.sites[i]->kind == site->kind && strcmp(metric_state.sites[i]->name, site->name) == 0) {
+                    id = i + 1;
+                }
+            }
+            if (id == 0) {
+                id = metric_state.count < MAX_METRICS ? ++metric_state.count : -1;
+                if (id > 0) {
+                    metric_state.sites[id - 1] = site;
+                }
+            }
+            __atomic_store_n(&site->id, id, __ATOMIC_RELEASE);
+            
+            pthread_mutex_unlock(&metric_state.mutex);
+            return id;
+        }
+
+        static void metric_thread_release(void *arg) {
+            __atomic_store_n(&((metric_thread_t*)arg)->owned, false, __ATOMIC_RELEASE);
+        }
+
+        static void metric_key_create(void) {
+            pthread_key_create(&metric_thread_key, metric_thread_release);
+        }
+
+        /* Adopt an abandoned bank or push a new one; banks are never freed */
+        static metric_thread_t *metric_thread_attach(void) {
+            metric_thread_t *thread;
+            
+            pthread_once(&metric_key_once, metric_key_create);
+            
+            for (thread = __atomic_load_n(&metric_state.threads, __ATOMIC_ACQUIRE); thread; thread = thread->next) {
+                bool expected = false;
+                if (__atomic_compare_exchange_n(&thread->owned, &expected, true, false,
+                                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                    break;
+                }
+            }
+            
+            if (!thread) {
+                thread = calloc(1, sizeof(*thread));
+                if (!thread) {
+                    return NULL;
+                }
+                thread->owned = true;
+                thread->next = __atomic_load_n(&metric_state.threads, __ATOMIC_RELAXED);
+                while (!__atomic_compare_exchange_n(&metric_state.threads, &thread->next, thread, true,
+                                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+                }
+            }
+            
+            pthread_setspecific(metric_thread_key, thread);
+            metric_thread = thread;
+            return thread;
+        }
+
+        /// Add a value to a metric.
+        ///
+        /// Called by `log_counter_add` and `log_gauge_set`. The value goes
+        /// into the calling thread's own bank without locking or logging;
+        /// `logger_metric_report` merges the banks. The first use of a name
+        /// or thread sets up its storage. Up to 128 metrics are kept, later
+        /// names are ignored.
+        ///
+        /// __Parameters__
+        ///
+        /// - `site`: Static call site of the metric
+        /// - `value`: Value to aggregate
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_metric_record(log_metric_site_t *site, double value) {
+            int id = __atomic_load_n(&site->id, __ATOMIC_ACQUIRE);
+            if (id == 0) {
+                id = metric_register(site);
+            }
+            if (id < 0) {
+                return;
+            }
+            
+            metric_thread_t *thread = metric_thread ? metric_thread : metric_thread_attach();
+            if (!thread) {
+                return;
+            }
+            
+            /* Single writer per bank, the reporter only needs untorn values */
+            metric_cell_t *cell = &thread->cells[id - 1];
+            unsigned interval = __atomic_load_n(&metric_state.interval, __ATOMIC_RELAXED);
+            double sum = cell->sum + value;
+            double min = cell->interval != interval || value < cell->min ? value : cell->min;
+            double max = cell->interval != interval || value > cell->max ? value : cell->max;
+            __atomic_store(&cell->sum, &sum, __ATOMIC_RELAXED);
+            __atomic_store(&cell->min, &min, __ATOMIC_RELAXED);
+            __atomic_store(&cell->max, &max, __ATOMIC_RELAXED);
+            __atomic_store_n(&cell->count, cell->count + 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&cell->interval, interval, __ATOMIC_RELEASE);
+            
+            if (site->kind == LOG_METRIC_GAUGE) {
+                __atomic_store(&metric_state.last[id - 1], &value, __ATOMIC_RELAXED);
+            }
+        }
+
+        /// Log one summary line per metric.
+        ///
+        /// Merges every thread's bank and logs, at INFO level, the values
+        /// recorded since the previous report:
+        /// `counter http.bytes: n=1532 sum=2.41e+06 min=120 max=65536`.
+        /// Gauges also show the last value set. Metrics without new values
+        /// are skipped. A value recorded while the report runs counts
+        /// towards the next one.
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_metric_report(void) {
+            struct {
+                log_metric_site_t *site;
+                uint64_t count;
+                double sum, min, max, last;
+            } rows[MAX_METRICS];
+            int row_count = 0;
+            
+            pthread_mutex_lock(&metric_state.mutex);
+            
+            /* Values recorded from now on restart min and max */
+            unsigned interval = metric_state.interval;
+            __atomic_store_n(&metric_state.interval, interval + 1, __ATOMIC_RELEASE);
+            
+            for (int i = 0; i < metric_state.count; i++) {
+                uint64_t count = 0;
+                double sum = 0, min = 0, max = 0;
+                bool ranged = false;
+                
+                for (metric_thread_t *t = __atomic_load_n(&metric_state.threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+                    metric_cell_t *cell = &t->cells[i];
+                    double cell_sum, cell_min, cell_max;
+                    bool current = __atomic_load_n(&cell->interval, __ATOMIC_ACQUIRE) == interval;
+                    count += __atomic_load_n(&cell->count, __ATOMIC_RELAXED);
+                    __atomic_load(&cell->sum, &cell_sum, __ATOMIC_RELAXED);
+                    sum += cell_sum;
+                    if (current) {
+                        __atomic_load(&cell->min, &cell_min, __ATOMIC_RELAXED);
+                        __atomic_load(&cell->max, &cell_max, __ATOMIC_RELAXED);
+                        min = !ranged || cell_min < min ? cell_min : min;
+                        max = !ranged || cell_max > max ? cell_max : max;
+                        ranged = true;
+                    }
+                }
+                
+                /* Counts and sums only grow, so the interval is the difference to the last report */
+                uint64_t delta = count - metric_state.reported_count[i];
+                double delta_sum = sum - metric_state.reported_sum[i];
+                metric_state.reported_count[i] = count;
+                metric_state.reported_sum[i] = sum;
+                if (delta == 0) {
+                    continue;
+                }
+                
+                rows[row_count].site = metric_state.sites[i];
+                rows[row_count].count = delta;
+                rows[row_count].sum = delta_sum;
+                rows[row_count].min = ranged ? min : delta_sum / (double)delta;
+                rows[row_count].max = ranged ? max : delta_sum / (double)delta;
+                __atomic_load(&metric_state.last[i], &rows[row_count].last, __ATOMIC_RELAXED);
+                row_count++;
+            }
+            
+            pthread_mutex_unlock(&metric_state.mutex);
+            
+            for (int i = 0; i < row_count; i++) {
+                log_metric_site_t *site = rows[i].site;
+                if (site->kind == LOG_METRIC_GAUGE) {
+                    logger_log(LOG_LEVEL_INFO, site->file, "metric", site->line,
+                               "gauge %s: last=%.6g n=%llu sum=%.6g min=%.6g max=%.6g", site->name, rows[i].last,
+                               (unsigned long long)rows[i].count, rows[i].sum, rows[i].min, rows[i].max);
+                } else {
+                    logger_log(LOG_LEVEL_INFO, site->file, "metric", site->line,
+                               "counter %s: n=%llu sum=%.6g min=%.6g max=%.6g", site->name,
+                               (unsigned long long)rows[i].count, rows[i].sum, rows[i].min, rows[i].max);
+                }
+            }
+        }
+
+        /// Report metric summaries on an interval.
+        ///
+        /// The background ticker calls `logger_metric_report` every
+        /// `interval_ms`. `logger_cleanup` stops it and reports the last,
+        /// partial interval.
+        ///
+        /// __Parameters__
+        ///
+        /// - `interval_ms`: Report interval, 0 to stop reporting
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 if the ticker thread cannot be started
+        int logger_set_metric_interval(unsigned interval_ms) {
+            pthread_mutex_lock(&ticker_state.mutex);
+            ticker_state.metric_interval_ms = interval_ms;
+            pthread_mutex_unlock(&ticker_state.mutex);
+            return ticker_restart();
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── THROTTLING ────────────────────────────┐
+
+        static void rate_thread_release(void *arg) {
+            __atomic_store_n(&((rate_thread_t*)arg)->owned, false, __ATOMIC_RELEASE);
+        }
+
+        static void rate_key_create(void) {
+            pthread_key_create(&rate_thread_key, rate_thread_release);
+        }
+
+        static void rate_thread_push(rate_thread_t *thread) {
+            thread->next = __atomic_load_n(&throttle_state.threads, __ATOMIC_RELAXED);
+            while (!__atomic_compare_exchange_n(&throttle_state.threads, &thread->next, thread, true,
+                                                __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            }
+        }
+
+        /* Allocate unowned blocks up front so threads can attach in bounded mode without malloc */
+        static void rate_reserve(void) {
+            unsigned count = 0;
+            for (rate_thread_t *t = __atomic_load_n(&throttle_state.threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+                count++;
+            }
+            for (; count < BOUNDED_THREAD_BLOCKS; count++) {
+                rate_thread_t *thread = calloc(1, sizeof(*thread));
+                if (!thread) {
+                    return;
+                }
+                rate_thread_push(thread);
+            }
+        }
+
+        /* Adopt an abandoned counter block or push a new one; blocks are never freed */
+        static rate_thread_t *rate_thread_attach(void) {
+            rate_thread_t *thread;
+            
+            pthread_once(&rate_key_once, rate_key_create);
+            
+            for (thread = __atomic_load_n(&throttle_state.threads, __ATOMIC_ACQUIRE); thread; thread = thread->next) {
+                bool expected = false;
+                if (!__atomic_load_n(&thread->owned, __ATOMIC_RELAXED) &&
+                    __atomic_compare_exchange_n(&thread->owned, &expected, true, false,
+                                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                    break;
+                }
+            }
+            
+            if (!thread) {
+                /* Under a memory budget only reserved blocks are used; this thread goes uncounted */
+                if (record_pool.bounded) {
+                    return NULL;
+                }
+                thread = calloc(1, sizeof(*thread));
+                if (!thread) {
+                    return NULL;
+                }
+                thread->owned = true;
+                rate_thread_push(thread);
+            }
+            
+            pthread_setspecific(rate_thread_key, thread);
+            rate_thread = thread;
+            return thread;
+        }
+
+        /* Count delivered events and bytes on this thread; only the owner writes its block */
+        static void rate_note(uint64_t events, uint64_t bytes) {
+            if (!__atomic_load_n(&throttle_state.enabled, __ATOMIC_RELAXED) || throttle_reporting) {
+                return;
+            }
+            rate_thread_t *thread = rate_thread ? rate_thread : rate_thread_attach();
+            if (thread) {
+                __atomic_store_n(&thread->events, thread->events + events, __ATOMIC_RELAXED);
+                __atomic_store_n(&thread->bytes, thread->bytes + bytes, __ATOMIC_RELAXED);
+            }
+        }
+
+        /* True (and counted) when the rate budget currently sheds `level` */
+        static bool throttle_sheds(log_level_t level) {
+            if ((int)level >= __atomic_load_n(&throttle_state.level, __ATOMIC_RELAXED) || throttle_reporting) {
+                return false;
+            }
+            rate_thread_t *thread = rate_thread ? rate_thread : rate_thread_attach();
+            if (thread) {
+                __atomic_store_n(&thread->shed[level], thread->shed[level] + 1, __ATOMIC_RELAXED);
+            }
+            return true;
+        }
+
+        /* Compare the last check interval's rate with the budget and move the threshold one level */
+        static void throttle_adjust(void) {
+            uint64_t events = 0, bytes = 0;
+            uint64_t shed[LOG_LEVEL_ERROR] = {0};
+            
+            pthread_mutex_lock(&throttle_state.mutex);
+            
+            for (rate_thread_t *t = __atomic_load_n(&throttle_state.threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+                events += __atomic_load_n(&t->events, __ATOMIC_RELAXED);
+                bytes += __atomic_load_n(&t->bytes, __ATOMIC_RELAXED);
+                for (int level = 0; level < LOG_LEVEL_ERROR; level++) {
+                    shed[level] += __atomic_load_n(&t->shed[level], __ATOMIC_RELAXED);
+                }
+            }
+            
+            /* Counters only grow, so the interval is the difference to the last check */
+            int64_t now = monotonic_ns();
+            double per_sec = 1e9 / (double)(now - throttle_state.seen_ns > 0 ? now - throttle_state.seen_ns : 1);
+            double event_rate = (double)(events - throttle_state.seen_events) * per_sec;
+            double byte_rate = (double)(bytes - throttle_state.seen_bytes) * per_sec;
+            double bytes_per_event = events > throttle_state.seen_events ?
+                                     (double)(bytes - throttle_state.seen_bytes) / (double)(events - throttle_state.seen_events) : 0;
+            int level = throttle_state.level;
+            int base = (int)__atomic_load_n(&logger_state.config.level, __ATOMIC_RELAXED);
+            int threshold = level > base ? level : base;
+            int next = level;
+            
+            bool over = (throttle_state.events_per_sec && event_rate > (double)throttle_state.events_per_sec) ||
+                        (throttle_state.bytes_per_sec && byte_rate > (double)throttle_state.bytes_per_sec);
+            if (over && threshold < LOG_LEVEL_ERROR) {
+                next = threshold + 1;
+            } else if (!over && level > base) {
+                /* Step down only if the rate with the last shed level back stays under half the budget */
+                double returning = (double)(shed[level - 1] - throttle_state.seen_shed[level - 1]) * per_sec;
+                if ((!throttle_state.events_per_sec || event_rate + returning < (double)throttle_state.events_per_sec / 2) &&
+                    (!throttle_state.bytes_per_sec ||
+                     byte_rate + returning * bytes_per_event < (double)throttle_state.bytes_per_sec / 2)) {
+                    next = level - 1 > base ? level - 1 : LOG_LEVEL_TRACE;
+                }
+            }
+            
+            throttle_state.seen_events = events;
+            throttle_state.seen_bytes = bytes;
+            memcpy(throttle_state.seen_shed, shed, sizeof(shed));
+            throttle_state.seen_ns = now;
+            
+            pthread_mutex_unlock(&throttle_state.mutex);
+            
+            if (next == level) {
+                return;
+            }
+            
+            /* Announce the step before taking it, the line itself is never shed */
+            char rate[32];
+            format_bytes(rate, sizeof(rate), (unsigned long long)byte_rate);
+            throttle_reporting = true;
+            if (next > level) {
+                logger_log(LOG_LEVEL_WARN, __FILE__, "throttle", __LINE__,
+                           "log rate %.0f events/s, %s/s over budget: dropping %s and below",
+                           event_rate, rate, level_strings[next - 1]);
+            } else {
+                logger_log(LOG_LEVEL_WARN, __FILE__, "throttle", __LINE__,
+                           "log rate %.0f events/s, %s/s back under budget: logging %s again",
+                           event_rate, rate, level_strings[next > base ? next : base]);
+            }
+            throttle_reporting = false;
+            
+            pthread_mutex_lock(&throttle_state.mutex);
+            if (throttle_state.enabled) {
+                __atomic_store_n(&throttle_state.level, next, __ATOMIC_RELAXED);
+            }
+            pthread_mutex_unlock(&throttle_state.mutex);
+        }
+
+        /// Set a log rate budget.
+        ///
+        /// Every 250 ms the background ticker compares the rate of delivered
+        /// events and output bytes with the budget. While it is over, the
+        /// threshold rises one level per check above the configured level,
+        /// up to ERROR, so ERROR and FATAL are never shed. Once the rate
+        /// with the most recently shed level added back stays under half
+        /// the budget, the threshold steps back down one level at a time.
+        /// Each step is logged at WARN. Events are counted per thread, and
+        /// shed events show up in `log_stats_t.records_throttled`. Under a
+        /// memory budget, counters for 32 threads are allocated up front;
+        /// while all of them are taken, the events of further threads are
+        /// still shed but left out of the rate and the shed count.
+        ///
+        /// __Parameters__
+        ///
+        /// - `events_per_sec`: Event budget, 0 for no event limit
+        /// - `bytes_per_sec`: Output byte budget, 0 for no byte limit
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 if the ticker thread cannot be started
+        int logger_set_rate_budget(unsigned long events_per_sec, unsigned long long bytes_per_sec) {
+            bool enabled = events_per_sec > 0 || bytes_per_sec > 0;
+            
+            pthread_mutex_lock(&throttle_state.mutex);
+            throttle_state.events_per_sec = events_per_sec;
+            throttle_state.bytes_per_sec = bytes_per_sec;
+            if (!enabled) {
+                __atomic_store_n(&throttle_state.level, LOG_LEVEL_TRACE, __ATOMIC_RELAXED);
+            }
+            throttle_state.seen_ns = monotonic_ns();
+            if (enabled && record_pool.bounded) {
+                rate_reserve();
+            }
+            __atomic_store_n(&throttle_state.enabled, enabled, __ATOMIC_RELAXED);
+            pthread_mutex_unlock(&throttle_state.mutex);
+            
+            pthread_mutex_lock(&ticker_state.mutex);
+            bool changed = ticker_state.throttle != enabled;
+            ticker_state.throttle = enabled;
+            pthread_mutex_unlock(&ticker_state.mutex);
+            return changed ? ticker_restart() : 0;
+        }
+
+        /// Get the lowest level the rate budget lets through.
+        ///
+        /// __Return__
+        ///
+        /// - LOG_LEVEL_TRACE while not throttling, up to LOG_LEVEL_ERROR
+        log_level_t logger_throttle_level(void) {
+            return (log_level_t)__atomic_load_n(&throttle_state.level, __ATOMIC_RELAXED);
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── TICKER ────────────────────────────┐
+
+        /* Absolute CLOCK_REALTIME deadline `ns` from now, for pthread_cond_timedwait */
+        static struct timespec deadline_after(int64_t ns) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            int64_t total = (int64_t)deadline.tv_nsec + ns;
+            deadline.tv_sec += (time_t)(total / 1000000000);
+            deadline.tv_nsec = (long)(total % 1000000000);
+            return deadline;
+        }
+
+        /* One thread for all periodic work: span, profile and metric reports, throttling, TSC calibration, coalescing */
+        static void *ticker_main(void *arg) {
+            (void)arg;
+            pthread_mutex_lock(&ticker_state.mutex);
+            
+            int64_t report_period = (int64_t)ticker_state.span_interval_ms * 1000000;
+            int64_t profile_period = (int64_t)ticker_state.profile_interval_ms * 1000000;
+            int64_t metric_period = (int64_t)ticker_state.metric_interval_ms * 1000000;
+            int64_t coalesce_period = (int64_t)ticker_state.coalesce_ms * (1000000 / COALESCE_SWEEPS);
+            int64_t next_coalesce = monotonic_ns() + coalesce_period;
+            int64_t next_report = monotonic_ns() + report_period;
+            int64_t next_profile = monotonic_ns() + profile_period;
+            int64_t next_metric = monotonic_ns() + metric_period;
+            int64_t next_throttle = monotonic_ns() + (int64_t)THROTTLE_CHECK_MS * 1000000;
+            int64_t next_calibration = monotonic_ns() + TSC_CALIBRATION_NS;
+            
+            while (ticker_state.running) {
+                int64_t now = monotonic_ns();
+                bool report = report_period > 0 && now >= next_report;
+                bool profile = profile_period > 0 && now >= next_profile;
+                bool metrics = metric_period > 0 && now >= next_metric;
+                bool throttle = ticker_state.throttle && now >= next_throttle;
+                bool calibrate = ticker_state.calibrate && now >= next_calibration;
+                bool sweep = coalesce_period > 0 && now >= next_coalesce;
+                
+                if (report || profile || metrics || throttle || calibrate || sweep) {
+                    unsigned profile_top = ticker_state.profile_top;
+                    next_report = report ? now + report_period : next_report;
+                    next_profile = profile ? now + profile_period : next_profile;
+                    next_metric = metrics ? now + metric_period : next_metric;
+                    next_throttle = throttle ? now + (int64_t)THROTTLE_CHECK_MS * 1000000 : next_throttle;
+                    next_calibration = calibrate ? now + TSC_CALIBRATION_NS : next_calibration;
+                    next_coalesce = sweep ? now + coalesce_period : next_coalesce;
+                    pthread_mutex_unlock(&ticker_state.mutex);
+                    if (calibrate) {
+                        tsc_calibrate();
+                    }
+                    if (throttle) {
+                        throttle_adjust();
+                    }
+                    if (report) {
+                        logger_span_report();
+                    }
+                    if (profile) {
+                        logger_profile_report(profile_top);
+                        logger_profile_reset();
+                    }
+                    if (metrics) {
+                        logger_metric_report();
+                    }
+                    
+                    /* A hung output holds the lock; its runs wait for the next sweep */
+                    if (sweep && !__atomic_load_n(&watchdog_state.bypass, __ATOMIC_ACQUIRE)) {
+                        lock_logger();
+                        coalesce_sweep(false);
+                        unlock_logger();
+                    }
+                    pthread_mutex_lock(&ticker_state.mutex);
+                    continue;
+                }
+                
+                int64_t wake = INT64_MAX;
+                if (report_period > 0) {
+                    wake = next_report;
+                }
+                if (profile_period > 0 && next_profile < wake) {
+                    wake = next_profile;
+                }
+                if (metric_period > 0 && next_metric < wake) {
+                    wake = next_metric;
+                }
+                if (ticker_state.throttle && next_throttle < wake) {
+                    wake = next_throttle;
+                }
+                if (ticker_state.calibrate && next_calibration < wake) {
+                    wake = next_calibration;
+                }
+                if (coalesce_period > 0 && next_coalesce < wake) {
+                    wake = next_coalesce;
+                }
+                if (wake == INT64_MAX) {
+                    pthread_cond_wait(&ticker_state.cond, &ticker_state.mutex);
+                } else {
+                    struct timespec deadline = deadline_after(wake - now);
+                    pthread_cond_timedwait(&ticker_state.cond, &ticker_state.mutex, &deadline);
+                }
+            }
+            
+            pthread_mutex_unlock(&ticker_state.mutex);
+            return NULL;
+        }
+
+        /* Sweep expired coalescing runs every quarter window, or stop sweeping */
+        static int coalesce_tick(unsigned window_ms) {
+            pthread_mutex_lock(&ticker_state.mutex);
+            bool changed = ticker_state.coalesce_ms != window_ms;
+            ticker_state.coalesce_ms = window_ms;
+            pthread_mutex_unlock(&ticker_state.mutex);
+            return changed ? ticker_restart() : 0;
+        }
+
+        /* Restart the ticker with the current settings, or leave it stopped if it has no work */
+        static int ticker_restart(void) {
+            int result = 0;
+            
+            pthread_mutex_lock(&ticker_state.mutex);
+            if (ticker_state.running) {
+                ticker_state.running = false;
+                pthread_cond_signal(&ticker_state.cond);
+                pthread_mutex_unlock(&ticker_state.mutex);
+                pthread_join(ticker_state.thread, NULL);
+                pthread_mutex_lock(&ticker_state.mutex);
+            }
+            
+            if (ticker_state.span_interval_ms > 0 || ticker_state.profile_interval_ms > 0 ||
+                ticker_state.metric_interval_ms > 0 || ticker_state.throttle || ticker_state.calibrate ||
+                ticker_state.coalesce_ms > 0) {
+                ticker_state.running = true;
+                if (pthread_create(&ticker_state.thread, NULL, ticker_main, NULL) != 0) {
+                    ticker_state.running = false;
+                    result = -1;
+                }
+            }
+            
+            pthread_mutex_unlock(&ticker_state.mutex);
+            return result;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── TCP OUTPUT ────────────────────────────┐
+
+        /* Close the connection and schedule the next attempt with doubled backoff */
+        static void tcp_sink_disconnect(tcp_sink_t *sink) {
+            if (sink->fd >= 0) {
+                close(sink->fd);
+                sink->fd = -1;
+            }
+            sink->next_attempt_ns = monotonic_ns() + (int64_t)sink->backoff_ms * 1000000;
+            sink->backoff_ms = sink->backoff_ms * 2 < TCP_BACKOFF_MAX_MS ? sink->backoff_ms * 2 : TCP_BACKOFF_MAX_MS;
+        }
+
+        /* Write everything or fail; a stalled collector times out instead of blocking forever */
+        static int tcp_send_all(int fd, const char *data, size_t size) {
+            while (size > 0) {
+                ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (sent <= 0) {
+                    return -1;
+                }
+                data += sent;
+                size -= (size_t)sent;
+            }
+            return 0;
+        }
+
+        /* A collector that closed its end shows up as a readable EOF before sends start failing */
+        static bool tcp_peer_alive(int fd) {
+            char scratch[256];
+            struct pollfd pfd = { .fd = fd, .events = POLLIN };
+            
+            while (poll(&pfd, 1, 0) > 0) {
+                ssize_t got = recv(fd, scratch, sizeof(scratch), MSG_DONTWAIT);
+                if (got == 0 || (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+                    return false;
+                }
+                if (got < 0) {
+                    break;
+                }
+            }
+            return true;
+        }
+
+        /* Connect with a bounded wait, returns the socket or -1 */
+        static int tcp_open(const char *host, const char *port) {
+            struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+            struct addrinfo *addresses;
+            int fd = -1;
+            
+            if (getaddrinfo(host, port, &hints, &addresses) != 0) {
+                return -1;
+            }
+            
+            for (struct addrinfo *ai = addresses; ai && fd < 0; ai = ai->ai_next) {
+                fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+                if (fd < 0) {
+                    continue;
+                }
+                
+                int error = 0;
+                socklen_t error_len = sizeof(error);
+                struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+                if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0 &&
+                    (errno != EINPROGRESS || poll(&pfd, 1, TCP_TIMEOUT_MS) != 1 ||
+                     getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_len) != 0 || error != 0)) {
+                    close(fd);
+                    fd = -1;
+                }
+            }
+            freeaddrinfo(addresses);
+            
+            if (fd >= 0) {
+                struct timeval timeout = { .tv_sec = TCP_TIMEOUT_MS / 1000, .tv_usec = (TCP_TIMEOUT_MS % 1000) * 1000 };
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            }
+            return fd;
+        }
+
+        /* Connect and replay the spool; the spool is only emptied once all of it went out */
+        static void tcp_sink_connect(tcp_sink_t *sink) {
+            char chunk[16384];
+            
+            sink->fd = tcp_open(sink->host, sink->port);
+            if (sink->fd < 0) {
+                tcp_sink_disconnect(sink);
+                return;
+            }
+            
+            for (size_t offset = 0; offset < sink->spool_size; ) {
+                ssize_t got = pread(sink->spool_fd, chunk, sizeof(chunk), (off_t)offset);
+                if (got <= 0 || tcp_send_all(sink->fd, chunk, (size_t)got) != 0) {
+                    tcp_sink_disconnect(sink);
+                    return;
+                }
+                offset += (size_t)got;
+            }
+            if (sink->spool_size > 0 && ftruncate(sink->spool_fd, 0) == 0) {
+                sink->spool_size = 0;
+            }
+            sink->backoff_ms = TCP_BACKOFF_MIN_MS;
+        }
+
+        /* Send a sealed buffer, or spool it while the collector is unreachable */
+        static void tcp_sink_deliver(tcp_sink_t *sink, tcp_buffer_t *buffer) {
+            if (sink->fd >= 0 && !tcp_peer_alive(sink->fd)) {
+                tcp_sink_disconnect(sink);
+            }
+            if (sink->fd < 0 && monotonic_ns() >= sink->next_attempt_ns) {
+                tcp_sink_connect(sink);
+            }
+            
+            if (sink->fd >= 0 && sink->spool_size == 0) {
+                if (tcp_send_all(sink->fd, buffer->data, buffer->size) == 0) {
+                    return;
+                }
+                /* Lines that reached the old connection may arrive twice */
+                tcp_sink_disconnect(sink);
+            }
+            
+            if (sink->spool_fd >= 0 && sink->spool_size + buffer->size <= sink->spool_limit &&
+                write(sink->spool_fd, buffer->data, buffer->size) == (ssize_t)buffer->size) {
+                sink->spool_size += buffer->size;
+                return;
+            }
+            __atomic_add_fetch(&record_pool.dropped, buffer->count, __ATOMIC_RELAXED);
+        }
+
+        /* Sender thread: seals batches, delivers them and retries the collector */
+        static void *tcp_sink_main(void *arg) {
+            tcp_sink_t *sink = (tcp_sink_t*)arg;
+            
+            pthread_mutex_lock(&sink->mutex);
+            for (;;) {
+                int64_t now = monotonic_ns();
+                tcp_buffer_t *active = &sink->buffers[sink->active];
+                
+                if (sink->sealed < 0 && active->size > 0) {
+                    if (!sink->batch_deadline_ns) {
+                        sink->batch_deadline_ns = now + (int64_t)TCP_BATCH_MS * 1000000;
+                    }
+                    if (sink->flush_requested || sink->stop || now >= sink->batch_deadline_ns) {
+                        sink->sealed = sink->active;
+                        sink->active ^= 1;
+                        sink->batch_deadline_ns = 0;
+                    }
+                }
+                
+                if (sink->sealed >= 0) {
+                    tcp_buffer_t *buffer = &sink->buffers[sink->sealed];
+                    pthread_mutex_unlock(&sink->mutex);
+                    tcp_sink_deliver(sink, buffer);
+                    pthread_mutex_lock(&sink->mutex);
+                    buffer->size = 0;
+                    buffer->count = 0;
+                    sink->sealed = -1;
+                    pthread_cond_broadcast(&sink->cond);
+                    continue;
+                }
+                
+                if (sink->buffers[sink->active].size == 0) {
+                    sink->flush_requested = false;
+                    if (sink->stop) {
+                        break;
+                    }
+                }
+                
+                /* Replay the spool as soon as the collector is back */
+                if (sink->fd < 0 && sink->spool_size > 0 && now >= sink->next_attempt_ns) {
+                    pthread_mutex_unlock(&sink->mutex);
+                    tcp_sink_connect(sink);
+                    pthread_mutex_lock(&sink->mutex);
+                    continue;
+                }
+                
+                int64_t wake = sink->batch_deadline_ns ? sink->batch_deadline_ns : INT64_MAX;
+                if (sink->fd < 0 && sink->spool_size > 0 && sink->next_attempt_ns < wake) {
+                    wake = sink->next_attempt_ns;
+                }
+                if (wake == INT64_MAX) {
+                    pthread_cond_wait(&sink->cond, &sink->mutex);
+                } else {
+                    struct timespec deadline = deadline_after(wake - now);
+                    pthread_cond_timedwait(&sink->cond, &sink->mutex, &deadline);
+                }
+            }
+            pthread_mutex_unlock(&sink->mutex);
+            return NULL;
+        }
+
+        /* Send or spool everything logged so far */
+        static void tcp_sink_flush(tcp_sink_t *sink) {
+            pthread_mutex_lock(&sink->mutex);
+            sink->flush_requested = true;
+            pthread_cond_broadcast(&sink->cond);
+            while (sink->sealed >= 0 || sink->buffers[sink->active].size > 0) {
+                pthread_cond_wait(&sink->cond, &sink->mutex);
+            }
+            pthread_mutex_unlock(&sink->mutex);
+        }
+
+        static void tcp_sink_destroy(tcp_sink_t *sink) {
+            pthread_mutex_lock(&sink->mutex);
+            sink->stop = true;
+            pthread_cond_broadcast(&sink->cond);
+            pthread_mutex_unlock(&sink->mutex);
+            pthread_join(sink->thread, NULL);
             
-            for (int i = 0; i < 6; i++) {
-                if (strcasecmp(str, level_strings[i]) == 0) {
-                    return (log_level_t)i;
+            if (sink->fd >= 0) close(sink->fd);
+            if (sink->spool_fd >= 0) close(sink->spool_fd);
+            pthread_mutex_destroy(&sink->mutex);
+            pthread_cond_destroy(&sink->cond);
+            free(sink->buffers[0].data);
+            free(sink->buffers[1].data);
+            free(sink);
+        }
+
+        /// Add TCP stream output handler.
+        ///
+        /// Lines in the `logger_file_output` text format are collected for up
+        /// to 20 ms and sent in one write by a background thread, so logging
+        /// never waits on the network. The thread connects lazily and
+        /// reconnects with exponential backoff (100 ms up to 10 s). While the
+        /// collector is unreachable, batches are appended to the spool file,
+        /// which is replayed in order before anything new once a connection
+        /// is back; a spool that already holds data from an earlier run is
+        /// replayed too. Batches that do not fit the spool, or arrive while
+        /// both buffers are full, are dropped and counted in
+        /// `log_stats_t.records_dropped`. Delivery is at least once: lines
+        /// in flight when a connection breaks are sent again.
+        ///
+        /// __Parameters__
+        ///
+        /// - `host`: Collector host name or address
+        /// - `port`: Collector TCP port
+        /// - `framing`: `LOG_FRAMING_NEWLINE`, or `LOG_FRAMING_LENGTH` for a
+        ///   4-byte big-endian length before each line (without newline)
+        /// - `spool_path`: File to keep batches in while disconnected, NULL to drop them
+        /// - `spool_limit`: Largest spool size in bytes
+        /// - `level`: Minimum log level for this output
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on failure
+        int logger_add_tcp_output(const char *host, int port, log_framing_t framing,
+                                  const char *spool_path, size_t spool_limit, log_level_t level) {
+            if (!host || strlen(host) >= sizeof(((tcp_sink_t*)0)->host) || port <= 0 || port > 65535) {
+                return -1;
+            }
+            
+            tcp_sink_t *sink = calloc(1, sizeof(*sink));
+            if (!sink) {
+                return -1;
+            }
+            strcpy(sink->host, host);
+            snprintf(sink->port, sizeof(sink->port), "%d", port);
+            sink->framing = framing;
+            sink->fd = -1;
+            sink->spool_fd = -1;
+            sink->spool_limit = spool_limit;
+            sink->backoff_ms = TCP_BACKOFF_MIN_MS;
+            sink->sealed = -1;
+            sink->buffers[0].data = malloc(LOGGER_FRAME_SIZE);
+            sink->buffers[1].data = malloc(LOGGER_FRAME_SIZE);
+            pthread_mutex_init(&sink->mutex, NULL);
+            pthread_cond_init(&sink->cond, NULL);
+            
+            if (spool_path) {
+                sink->spool_fd = open(spool_path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+                struct stat st;
+                if (sink->spool_fd >= 0 && fstat(sink->spool_fd, &st) == 0) {
+                    sink->spool_size = (size_t)st.st_size;
                 }
             }
-            return LOG_LEVEL_INFO;
+            
+            if (!sink->buffers[0].data || !sink->buffers[1].data || (spool_path && sink->spool_fd < 0) ||
+                pthread_create(&sink->thread, NULL, tcp_sink_main, sink) != 0) {
+                if (sink->spool_fd >= 0) close(sink->spool_fd);
+                pthread_mutex_destroy(&sink->mutex);
+                pthread_cond_destroy(&sink->cond);
+                free(sink->buffers[0].data);
+                free(sink->buffers[1].data);
+                free(sink);
+                return -1;
+            }
+            
+            if (logger_add_custom_output(logger_tcp_output, sink, level) != 0) {
+                tcp_sink_destroy(sink);
+                return -1;
+            }
+            return 0;
+        }
+
+        /// Built-in TCP output function.
+        ///
+        /// Appends the framed line to the sink's active buffer. When that
+        /// buffer is full and the sender still holds the other one, the
+        /// record is dropped rather than stalling the caller.
+        ///
+        /// __Parameters__
+        ///
+        /// - `event`: Log event to output
+        ///
+        /// __Return__
+        ///
+        /// - No return value
+        void logger_tcp_output(log_event_t *event) {
+            tcp_sink_t *sink = (tcp_sink_t*)event->user_data;
+            size_t header = sink->framing == LOG_FRAMING_LENGTH ? 4 : 0;
+            
+            pthread_mutex_lock(&sink->mutex);
+            for (int attempt = 0; attempt < 2; attempt++) {
+                tcp_buffer_t *buffer = &sink->buffers[sink->active];
+                char *out = buffer->data + buffer->size;
+                size_t room = LOGGER_FRAME_SIZE - buffer->size - header;
+                va_list ap;
+                
+                va_copy(ap, event->ap);
+                size_t len = render_file_line(out + header, room, event, ap);
+                va_end(ap);
+                
+                if (len >= room && buffer->size > 0) {
+                    if (sink->sealed < 0) {
+                        sink->sealed = sink->active;
+                        sink->active ^= 1;
+                        sink->batch_deadline_ns = 0;
+                        pthread_cond_broadcast(&sink->cond);
+                        continue;
+                    }
+                    __atomic_add_fetch(&record_pool.dropped, 1, __ATOMIC_RELAXED);
+                    break;
+                }
+                if (len >= room) {
+                    /* Longer than a whole buffer, keep the head and end the line */
+                    len = room;
+                    out[header + room - 1] = '\n';
+                }
+                
+                if (header) {
+                    uint32_t payload = (uint32_t)len - 1;
+                    out[0] = (char)(payload >> 24);
+                    out[1] = (char)(payload >> 16);
+                    out[2] = (char)(payload >> 8);
+                    out[3] = (char)payload;
+                    len = header + payload;
+                }
+                if (buffer->size == 0) {
+                    pthread_cond_broadcast(&sink->cond);
+                }
+                buffer->size += (uint32_t)len;
+                buffer->count++;
+                output_bytes_written += len;
+                break;
+            }
+            pthread_mutex_unlock(&sink->mutex);
         }
 
     // └────────────────────────────────────────────────────────────────────┘
 
-    // ┌──────────────────────────── MAIN LOGGING ────────────────────────────┐
+    // ┌──────────────────────────── CRASH RING ────────────────────────────┐
 
-        /* Initialize event with current time */
-        static void init_event(log_event_t *event, void *user_data) {
-            if (!event->time) {
-                time_t t = time(NULL);
-                event->time = localtime(&t);
+        static log_ring_slot_t *ring_slot(ring_sink_t *sink, uint64_t seq) {
+            return (log_ring_slot_t*)(sink->map + ((seq - 1) % sink->slot_count + 1) * LOGGER_RING_SLOT_SIZE);
+        }
+
+        /* Continue numbering after the newest slot a previous run left behind */
+        static uint64_t ring_last_seq(ring_sink_t *sink) {
+            uint64_t last = 0;
+            for (uint64_t i = 0; i < sink->slot_count; i++) {
+                log_ring_slot_t *slot = (log_ring_slot_t*)(sink->map + (i + 1) * LOGGER_RING_SLOT_SIZE);
+                if (slot->seq > last) {
+                    last = slot->seq;
+                }
             }
-            event->user_data = user_data;
+            return last;
         }
 
-        /// Main logging function.
+        static void ring_sink_destroy(ring_sink_t *sink) {
+            munmap(sink->map, sink->map_size);
+            close(sink->fd);
+            free(sink);
+        }
+
+        /// Add crash ring output handler.
         ///
-        /// Processes a log message and sends it to all appropriate output handlers.
-        /// This is the core function that all logging macros ultimately call.
+        /// Keeps the most recent records in a fixed-size file mapped with
+        /// `MAP_SHARED`. Each line is stored straight into the page cache,
+        /// so it survives the process being killed at any point, including
+        /// by SIGKILL or the OOM killer. The file is split into 256-byte
+        /// slots numbered by a sequence that keeps counting across restarts;
+        /// longer lines take several slots. `loggin-ring-dump` rebuilds the
+        /// records in order. A file of another size or format is reset.
         ///
         /// __Parameters__
         ///
-        /// - `level`: Log level of the message
-        /// - `file`: Source file name (usually __FILE__)
-        /// - `function`: Function name (usually __FUNCTION__)
-        /// - `line`: Line number (usually __LINE__)
-        /// - `fmt`: printf-style format string
-        /// - `...`: Variable arguments for the format string
+        /// - `path`: Ring file, created if missing
+        /// - `size`: File size in bytes, at least two slots
+        /// - `level`: Minimum log level for this output
+        ///
+        /// __Return__
+        ///
+        /// - 0 on success, -1 on failure
+        int logger_add_ring_output(const char *path, size_t size, log_level_t level) {
+            if (!path || size < 2 * LOGGER_RING_SLOT_SIZE) {
+                return -1;
+            }
+            
+            ring_sink_t *sink = calloc(1, sizeof(*sink));
+            if (!sink) {
+                return -1;
+            }
+            sink->slot_count = size / LOGGER_RING_SLOT_SIZE - 1;
+            sink->map_size = (size_t)(sink->slot_count + 1) * LOGGER_RING_SLOT_SIZE;
+            sink->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            
+            /* Blocks are reserved up front, a full disk must not turn a store into SIGBUS */
+            struct stat st;
+            bool reuse = sink->fd >= 0 && fstat(sink->fd, &st) == 0 && (size_t)st.st_size == sink->map_size;
+            if (sink->fd < 0 || (!reuse && ftruncate(sink->fd, 0) != 0) ||
+                posix_fallocate(sink->fd, 0, (off_t)sink->map_size) != 0) {
+                if (sink->fd >= 0) close(sink->fd);
+                free(sink);
+                return -1;
+            }
+            sink->map = mmap(NULL, sink->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, sink->fd, 0);
+            if (sink->map == MAP_FAILED) {
+                close(sink->fd);
+                free(sink);
+                return -1;
+            }
+            
+            log_ring_header_t *header = (log_ring_header_t*)sink->map;
+            if (!reuse || header->magic != LOGGER_RING_MAGIC || header->slot_size != LOGGER_RING_SLOT_SIZE ||
+                header->slot_count != sink->slot_count) {
+                memset(sink->map, 0, sink->map_size);
+                header->slot_size = LOGGER_RING_SLOT_SIZE;
+                header->slot_count = sink->slot_count;
+                __atomic_store_n(&header->magic, LOGGER_RING_MAGIC, __ATOMIC_RELEASE);
+            }
+            sink->next_seq = ring_last_seq(sink) + 1;
+            
+            if (logger_add_custom_output(logger_ring_output, sink, level) != 0) {
+                ring_sink_destroy(sink);
+                return -1;
+            }
+            return 0;
+        }
+
+        /// Built-in crash ring output function.
+        ///
+        /// Renders the line in the `logger_file_output` format and copies it
+        /// into the next slots. A slot's sequence number is cleared before
+        /// its text is replaced and set again last, so a slot caught half
+        /// written by a kill reads as empty rather than as mixed text.
+        ///
+        /// __Parameters__
+        ///
+        /// - `event`: Log event to output
         ///
         /// __Return__
         ///
         /// - No return value
-        void logger_log(log_level_t level, const char *file, const char *function, int line, const char *fmt, ...) {
-            if (!logger_state.initialized) {
-                logger_init();
+        void logger_ring_output(log_event_t *event) {
+            ring_sink_t *sink = (ring_sink_t*)event->user_data;
+            char line[MAX_MESSAGE_LEN + MAX_CONTEXT_LEN + 256];
+            size_t payload = LOGGER_RING_SLOT_SIZE - sizeof(log_ring_slot_t);
+            va_list ap;
+            
+            va_copy(ap, event->ap);
+            size_t len = render_file_line(line, sizeof(line), event, ap);
+            va_end(ap);
+            if (len >= sizeof(line)) {
+                len = sizeof(line) - 1;
+                line[len - 1] = '\n';
             }
             
-            log_event_t event = {
-                .fmt = fmt,
-                .file = file,
-                .function = function,
-                .line = line,
-                .level = level,
-                .time = NULL,
-                .user_data = NULL
-            };
+            /* A line never laps the ring, the oldest part would overwrite its own head */
+            if (len > payload * sink->slot_count) {
+                len = payload * sink->slot_count;
+                line[len - 1] = '\n';
+            }
             
-            lock_logger();
+            for (size_t offset = 0; offset < len; offset += payload) {
+                uint64_t seq = sink->next_seq++;
+                log_ring_slot_t *slot = ring_slot(sink, seq);
+                size_t chunk = len - offset < payload ? len - offset : payload;
+                
+                __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+                __atomic_thread_fence(__ATOMIC_RELEASE);
+                memcpy(slot + 1, line + offset, chunk);
+                slot->length = (uint16_t)chunk;
+                slot->level = (uint8_t)event->level;
+                slot->flags = offset > 0 ? LOGGER_RING_CONTINUED : 0;
+                __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+            }
+            output_bytes_written += len;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── SHARDED FILES ────────────────────────────┐
+
+        /* Closes a thread's shard when the thread exits */
+        static void shard_thread_release(void *data) {
+            shard_thread_t *shard = data;
             
-            /* Check if we should log this level */
-            if (level < logger_state.config.level) {
-                unlock_logger();
-                return;
+            pthread_mutex_lock(&shard_state.mutex);
+            for (shard_thread_t **link = &shard_state.threads; *link; link = &(*link)->next) {
+                if (*link == shard) {
+                    *link = shard->next;
+                    break;
+                }
             }
+            pthread_mutex_unlock(&shard_state.mutex);
             
-            /* Process all active outputs */
-            for (int i = 0; i < MAX_OUTPUTS; i++) {
-                if (logger_state.outputs[i].active && 
-                    level >= logger_state.outputs[i].min_level) {
-                    
-                    init_event(&event, logger_state.outputs[i].user_data);
-                    va_start(event.ap, fmt);
-                    logger_state.outputs[i].output_fn(&event);
-                    va_end(event.ap);
+            if (shard->file) {
+                fclose(shard->file);
+            }
+            free(shard);
+        }
+
+        static void shard_key_create(void) {
+            pthread_key_create(&shard_thread_key, shard_thread_release);
+        }
+
+        /* Open `<base>.<tid>` for appending; a file left by another run, which had the tid too, starts over */
+        static FILE *shard_open(const char *base, int tid) {
+            char path[PATH_MAX + 16];
+            log_shard_header_t header;
+            
+            snprintf(path, sizeof(path), "%s.%d", base, tid);
+            FILE *file = fopen(path, "a+b");
+            if (!file) {
+                return NULL;
+            }
+            if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != LOGGER_SHARD_MAGIC ||
+                header.run != shard_state.run) {
+                header = (log_shard_header_t){ LOGGER_SHARD_MAGIC, tid, shard_state.run };
+                if (ftruncate(fileno(file), 0) != 0) {
+                    fclose(file);
+                    return NULL;
+                }
+                fseek(file, 0, SEEK_SET);
+                fwrite(&header, sizeof(header), 1, file);
+            } else {
+                fseek(file, 0, SEEK_END);
+            }
+            return file;
+        }
+
+        /* The calling thread's shard for the current generation, opened on first use */
+        static shard_thread_t *shard_attach(void) {
+            pthread_once(&shard_key_once, shard_key_create);
+            shard_thread_t *shard = shard_thread;
+            unsigned generation = __atomic_load_n(&shard_state.generation, __ATOMIC_ACQUIRE);
+            
+            if (shard && shard->generation == generation) {
+                return shard->file ? shard : NULL;
+            }
+            if (!shard) {
+                shard = calloc(1, sizeof(*shard));
+                if (!shard) {
+                    return NULL;
                 }
+                pthread_mutex_lock(&shard_state.mutex);
+                shard->next = shard_state.threads;
+                shard_state.threads = shard;
+                pthread_mutex_unlock(&shard_state.mutex);
+                shard_thread = shard;
+                pthread_setspecific(shard_thread_key, shard);
             }
             
-            unlock_logger();
+            /* Only the owner closes its file, so no other thread can be writing it */
+            FILE *previous = shard->file;
+            pthread_mutex_lock(&shard_state.mutex);
+            shard->file = shard_state.enabled ? shard_open(shard_state.path, logger_thread_id()) : NULL;
+            shard->generation = shard_state.generation;
+            pthread_mutex_unlock(&shard_state.mutex);
+            if (previous) {
+                fclose(previous);
+            }
+            return shard->file ? shard : NULL;
         }
 
-    // └────────────────────────────────────────────────────────────────────┘
+        /* Append one record to the calling thread's shard */
+        static bool shard_write(log_event_t *event, va_list ap) {
+            shard_thread_t *shard = shard_attach();
+            char record[sizeof(log_shard_record_t) + MAX_MESSAGE_LEN + MAX_CONTEXT_LEN + 256];
+            char *line = record + sizeof(log_shard_record_t);
+            size_t room = sizeof(record) - sizeof(log_shard_record_t);
+            struct tm tm_buf;
+            va_list copy;
+            
+            if (!shard) {
+                return false;
+            }
+            init_event(event, &tm_buf, NULL);
+            /* Batched records keep the context they were added with */
+            if (!event->thread_id) {
+                attach_context(event);
+            }
+            
+            va_copy(copy, ap);
+            size_t len = render_file_line(line, room, event, copy);
+            va_end(copy);
+            if (len >= room) {
+                len = room - 1;
+                line[len - 1] = '\n';
+            }
+            
+            /* One counter for all shards orders records that share a timestamp */
+            log_shard_record_t header = {
+                .timestamp_ns = event->timestamp_ns,
+                .seq = __atomic_add_fetch(&shard_state.seq, 1, __ATOMIC_RELAXED),
+                .length = (uint32_t)len
+            };
+            memcpy(record, &header, sizeof(header));
+            fwrite(record, 1, sizeof(header) + len, shard->file);
+            if (event->level >= LOG_LEVEL_ERROR) {
+                fflush(shard->file);
+            }
+            output_bytes_written += len;
+            return true;
+        }
 
-    // ┌──────────────────────────── BUILT-IN OUTPUTS ────────────────────────────┐
+        /* Push every shard's stdio buffer to its file; stdio locks each stream against its owner */
+        static void shard_flush(void) {
+            pthread_mutex_lock(&shard_state.mutex);
+            for (shard_thread_t *shard = shard_state.threads; shard; shard = shard->next) {
+                if (shard->file) {
+                    fflush(shard->file);
+                }
+            }
+            pthread_mutex_unlock(&shard_state.mutex);
+        }
 
-        /// Built-in console output function.
+        /// Write each thread's records to its own file.
         ///
-        /// Formats and outputs log messages to console with colors and
-        /// customizable formatting options.
+        /// While shards are on, every log call that passes `level` is
+        /// rendered in the `logger_file_output` format and appended to
+        /// `<base_path>.<tid>` by the calling thread alone, with no logger
+        /// lock, shared stdio buffer or shared file. The outputs added with
+        /// `logger_add_*` are bypassed. Each record carries its timestamp
+        /// and a process-wide sequence number; `loggin-merge` puts the shards
+        /// back into one stream ordered by both.
+        ///
+        /// The file header names the process run. Within one run a thread
+        /// that reuses a tid appends to its shard; a shard left by an
+        /// earlier run with the same tid is truncated on first use.
+        ///
+        /// Shards are stdio-buffered; ERROR and FATAL records are flushed
+        /// at once. `logger_flush` writes out every thread's buffer, and a
+        /// thread's file is closed when it exits. A thread opens its file
+        /// and allocates its buffer on its first record, so shards cannot be
+        /// combined with a memory budget.
         ///
         /// __Parameters__
         ///
-        /// - `event`: Log event to output
+        /// - `base_path`: Path the thread ids are appended to, or NULL to turn shards off
+        /// - `level`: Minimum log level written to the shards
         ///
         /// __Return__
         ///
-        /// - No return value
-        void logger_console_output(log_event_t *event) {
-            FILE *stream = (FILE*)event->user_data;
-            char time_buf[32];
+        /// - 0 on success, -1 if the path is too long or a memory budget is active
+        int logger_set_shard_output(const char *base_path, log_level_t level) {
+            if (base_path && (strlen(base_path) >= sizeof(shard_state.path) || record_pool.bounded)) {
+                return -1;
+            }
+            if (!base_path && !__atomic_load_n(&shard_state.enabled, __ATOMIC_ACQUIRE)) {
+                return 0;
+            }
             
-            /* Format timestamp */
-            strftime(time_buf, sizeof(time_buf), "%H:%M:%S", event->time);
+            pthread_mutex_lock(&shard_state.mutex);
+            if (!shard_state.run) {
+                shard_state.run = (uint64_t)clock_now_ns();
+            }
+            if (base_path) {
+                strcpy(shard_state.path, base_path);
+                __atomic_store_n(&shard_state.level, level, __ATOMIC_RELAXED);
+            }
+            __atomic_store_n(&shard_state.enabled, base_path != NULL, __ATOMIC_RELEASE);
+            __atomic_add_fetch(&shard_state.generation, 1, __ATOMIC_RELEASE);
+            pthread_mutex_unlock(&shard_state.mutex);
             
-            /* Print timestamp and level */
-            if (logger_state.config.use_colors) {
-                fprintf(stream, "%s %s%-5s%s ", 
-                        time_buf, 
-                        level_colors[event->level], 
-                        level_strings[event->level], 
-                        color_reset);
+            /* Other threads reopen or close their own shard on their next record or at exit */
+            shard_flush();
+            if (shard_thread) {
+                shard_attach();
+            }
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── OUTPUT WATCHDOG ────────────────────────────┐
+
+        /* The fallback output, when it can take another output's events */
+        static output_handler_t *watchdog_fallback(int output) {
+            int fallback = __atomic_load_n(&watchdog_state.fallback, __ATOMIC_RELAXED);
+            if (fallback < 0 || fallback == output) {
+                return NULL;
+            }
+            output_handler_t *out = &logger_state.outputs[fallback];
+            return out->active && !__atomic_load_n(&out->degraded, __ATOMIC_ACQUIRE) ? out : NULL;
+        }
+
+        /* A degraded output's event goes to the fallback, unless the fallback takes it anyway */
+        static void watchdog_reroute(int output, log_event_t *event, va_list ap) {
+            output_handler_t *fallback = watchdog_fallback(output);
+            struct tm tm_buf;
+            
+            if (!fallback) {
+                __atomic_add_fetch(&watchdog_state.dropped, 1, __ATOMIC_RELAXED);
+                return;
+            }
+            if (event->level < fallback->min_level) {
+                output_call(fallback, event, &tm_buf, ap);
+            }
+            __atomic_add_fetch(&watchdog_state.rerouted, 1, __ATOMIC_RELAXED);
+        }
+
+        /* Deliver without the logger lock while a call hangs; false once the hung call has returned */
+        static bool watchdog_bypass(log_event_t *event, va_list ap) {
+            pthread_mutex_lock(&watchdog_state.fallback_mutex);
+            if (!__atomic_load_n(&watchdog_state.bypass, __ATOMIC_ACQUIRE)) {
+                pthread_mutex_unlock(&watchdog_state.fallback_mutex);
+                return false;
+            }
+            
+            /* The hung thread holds the lock, so the output table cannot change under us */
+            output_handler_t *fallback = watchdog_fallback(-1);
+            output_handler_t *stalled = &logger_state.outputs[watchdog_state.stalled];
+            struct tm tm_buf;
+            attach_context(event);
+            if (fallback && (event->level >= fallback->min_level || event->level >= stalled->min_level)) {
+                output_call(fallback, event, &tm_buf, ap);
+                __atomic_add_fetch(&watchdog_state.rerouted, 1, __ATOMIC_RELAXED);
             } else {
-                fprintf(stream, "%s %-5s ", time_buf, level_strings[event->level]);
+                __atomic_add_fetch(&watchdog_state.dropped, 1, __ATOMIC_RELAXED);
             }
             
-            /* Print file and line if enabled */
-            if (logger_state.config.show_file_line) {
-                if (logger_state.config.use_colors) {
-                    fprintf(stream, "%s%s:%d:%s ", 
-                            color_reset, event->file, event->line, color_reset);
-                } else {
-                    fprintf(stream, "%s:%d: ", event->file, event->line);
+            pthread_mutex_unlock(&watchdog_state.fallback_mutex);
+            return true;
+        }
+
+        /* Probe thread: a stream must take a flush and an fsync within the threshold to recover */
+        static void *watchdog_probe_main(void *arg) {
+            int output = (int)(intptr_t)arg;
+            output_handler_t *out = &logger_state.outputs[output];
+            int64_t start = monotonic_ns();
+            
+            if (out->output_fn == logger_file_output || out->output_fn == logger_console_output ||
+                out->output_fn == logger_json_output) {
+                FILE *stream = out->user_data;
+                fflush(stream);
+                fsync(fileno(stream));
+            }
+            
+            /* A probe that outlived the watchdog leaves the output alone */
+            int64_t elapsed_ms = (monotonic_ns() - start) / 1000000;
+            if (elapsed_ms < (int64_t)__atomic_load_n(&watchdog_state.stall_ms, __ATOMIC_RELAXED)) {
+                __atomic_store_n(&out->degraded, false, __ATOMIC_RELEASE);
+                logger_log(LOG_LEVEL_WARN, __FILE__, __func__, __LINE__, "output %d recovered", output);
+            }
+            __atomic_store_n(&watchdog_state.probing, false, __ATOMIC_RELEASE);
+            return NULL;
+        }
+
+        /* Start a probe of every degraded output, one at a time, in a thread that may hang itself */
+        static void watchdog_probe(void) {
+            for (int i = 0; i < MAX_OUTPUTS; i++) {
+                output_handler_t *out = &logger_state.outputs[i];
+                if (!__atomic_load_n(&out->degraded, __ATOMIC_ACQUIRE) ||
+                    __atomic_load_n(&watchdog_state.probing, __ATOMIC_ACQUIRE)) {
+                    continue;
                 }
+                
+                pthread_t probe;
+                pthread_attr_t attr;
+                pthread_attr_init(&attr);
+                pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+                __atomic_store_n(&watchdog_state.probing, true, __ATOMIC_RELEASE);
+                if (pthread_create(&probe, &attr, watchdog_probe_main, (void*)(intptr_t)i) != 0) {
+                    __atomic_store_n(&watchdog_state.probing, false, __ATOMIC_RELEASE);
+                }
+                pthread_attr_destroy(&attr);
             }
+        }
+
+        /* Watchdog thread: samples the call in flight a few times per threshold */
+        static void *watchdog_main(void *arg) {
+            (void)arg;
+            pthread_mutex_lock(&watchdog_state.mutex);
             
-            /* Print function if enabled */
-            if (logger_state.config.show_function) {
-                if (logger_state.config.use_colors) {
-                    fprintf(stream, "%s[%s]%s ", 
-                            color_reset, event->function, color_reset);
-                } else {
-                    fprintf(stream, "[%s] ", event->function);
+            uint64_t seen = 0;
+            int64_t seen_ns = monotonic_ns();
+            int64_t next_probe = seen_ns;
+            
+            while (watchdog_state.running) {
+                int64_t stall_ns = (int64_t)watchdog_state.stall_ms * 1000000;
+                struct timespec deadline = deadline_after(stall_ns / 4 > 1000000 ? stall_ns / 4 : 1000000);
+                pthread_cond_timedwait(&watchdog_state.cond, &watchdog_state.mutex, &deadline);
+                if (!watchdog_state.running) {
+                    break;
+                }
+                
+                uint64_t call = __atomic_load_n(&watchdog_state.call, __ATOMIC_ACQUIRE);
+                int64_t now = monotonic_ns();
+                if (call != seen) {
+                    seen = call;
+                    seen_ns = now;
+                }
+                
+                if (call && now - seen_ns >= stall_ns && !__atomic_load_n(&watchdog_state.bypass, __ATOMIC_ACQUIRE)) {
+                    int output = (int)(call & 0xff) - 1;
+                    watchdog_state.stalled = output;
+                    __atomic_store_n(&logger_state.outputs[output].degraded, true, __ATOMIC_RELEASE);
+                    __atomic_store_n(&watchdog_state.bypass, true, __ATOMIC_RELEASE);
+                    
+                    /* Goes to the fallback like every other line until the call returns */
+                    pthread_mutex_unlock(&watchdog_state.mutex);
+                    logger_log(LOG_LEVEL_WARN, __FILE__, __func__, __LINE__, "output %d stalled for %lld ms: %s", output,
+                               (long long)((now - seen_ns) / 1000000),
+                               watchdog_fallback(output) ? "rerouting to the fallback" : "dropping its events");
+                    pthread_mutex_lock(&watchdog_state.mutex);
+                }
+                
+                /* Probing waits until the hung call has returned and released the lock */
+                if (!__atomic_load_n(&watchdog_state.bypass, __ATOMIC_ACQUIRE) && now >= next_probe) {
+                    next_probe = now + (int64_t)WATCHDOG_PROBE_MS * 1000000;
+                    watchdog_probe();
                 }
             }
             
-            /* Print the actual message */
-            vfprintf(stream, event->fmt, event->ap);
-            fprintf(stream, "\n");
-            fflush(stream);
+            pthread_mutex_unlock(&watchdog_state.mutex);
+            return NULL;
         }
 
-        /// Built-in file output function.
+        /// Watch output calls for stalls and fail over.
         ///
-        /// Formats and outputs log messages to files with detailed timestamps
-        /// and no color codes.
+        /// A background thread notices when one output call (an `fprintf`
+        /// to a hung NFS file, say) has run for `stall_ms`. The output is
+        /// marked degraded and, for as long as the call hangs, log calls
+        /// skip the logger lock it holds: their events go straight to the
+        /// fallback output, or are dropped and counted in
+        /// `records_stall_dropped`. Once the call returns, the degraded
+        /// output's events keep going to the fallback while a probe thread
+        /// checks it about once a second; a stream output recovers when a
+        /// flush and fsync take less than `stall_ms`, any other output as
+        /// soon as the hung call has returned.
+        ///
+        /// The watchdog relies on `logger_set_lock` to serialize output
+        /// calls. The fallback should be an output that cannot hang, such
+        /// as the console or a file on local disk. The thread inside the
+        /// hung call, and log calls that were already waiting for the lock
+        /// when the stall began, still wait for the call.
         ///
         /// __Parameters__
         ///
-        /// - `event`: Log event to output
+        /// - `stall_ms`: Longest acceptable output call, or 0 to stop watching
+        /// - `fallback_output`: Output index from `logger_find_output`, or -1 to drop
         ///
         /// __Return__
         ///
-        /// - No return value
-        void logger_file_output(log_event_t *event) {
-            FILE *file = (FILE*)event->user_data;
-            char time_buf[64];
-            
-            /* Format timestamp with date */
-            strftime(time_buf, sizeof(time_buf), "%Y-%m-%d %H:%M:%S", event->time);
+        /// - 0 on success, -1 on an invalid fallback or when the thread cannot start
+        int logger_set_output_watchdog(unsigned stall_ms, int fallback_output) {
+            if (fallback_output >= MAX_OUTPUTS || (stall_ms && fallback_output >= 0 &&
+                                                   !logger_state.outputs[fallback_output].active)) {
+                return -1;
+            }
             
-            /* Print to file */
-            fprintf(file, "%s %-5s %s:%d", 
-                    time_buf, 
-                    level_strings[event->level], 
-                    event->file, 
-                    event->line);
+            pthread_mutex_lock(&watchdog_state.mutex);
+            if (watchdog_state.running) {
+                watchdog_state.running = false;
+                pthread_cond_signal(&watchdog_state.cond);
+                pthread_mutex_unlock(&watchdog_state.mutex);
+                pthread_join(watchdog_state.thread, NULL);
+                pthread_mutex_lock(&watchdog_state.mutex);
+            }
             
-            if (logger_state.config.show_function) {
-                fprintf(file, " [%s]", event->function);
+            __atomic_store_n(&watchdog_state.fallback, fallback_output < 0 ? -1 : fallback_output, __ATOMIC_RELAXED);
+            __atomic_store_n(&watchdog_state.stall_ms, stall_ms, __ATOMIC_RELAXED);
+            /* Without probes nothing would bring degraded outputs back */
+            for (int i = 0; !stall_ms && i < MAX_OUTPUTS; i++) {
+                __atomic_store_n(&logger_state.outputs[i].degraded, false, __ATOMIC_RELEASE);
+            }
+            int result = 0;
+            if (stall_ms) {
+                watchdog_state.running = true;
+                if (pthread_create(&watchdog_state.thread, NULL, watchdog_main, NULL) != 0) {
+                    watchdog_state.running = false;
+                    __atomic_store_n(&watchdog_state.stall_ms, 0, __ATOMIC_RELAXED);
+                    result = -1;
+                }
             }
             
-            fprintf(file, ": ");
-            vfprintf(file, event->fmt, event->ap);
-            fprintf(file, "\n");
-            fflush(file);
+            pthread_mutex_unlock(&watchdog_state.mutex);
+            return result;
+        }
+
+        /// Check whether the watchdog has taken an output out of service.
+        ///
+        /// __Parameters__
+        ///
+        /// - `output`: Output index from `logger_find_output`
+        ///
+        /// __Return__
+        ///
+        /// - true while the output's events go to the fallback
+        bool logger_output_degraded(int output) {
+            return output >= 0 && output < MAX_OUTPUTS &&
+                   __atomic_load_n(&logger_state.outputs[output].degraded, __ATOMIC_ACQUIRE);
         }
 
     // └────────────────────────────────────────────────────────────────────┘
@@ -14,13 +14,30 @@
     #include <stdio.h>
     #include <stdarg.h>
     #include <stdbool.h>
+    #include <stdint.h>
     #include <time.h>
 
+    #ifdef __cplusplus
+    extern "C" {
+    #endif
+
 // ╚═════════════════════════════════════════════════════════════════════════════════════╝
 
 // ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
 
     #define LOGGER_VERSION "1.0.0"
+    #define LOGGER_CATEGORY_NAME_MAX 64
+    #define LOGGER_CONTEXT_MAX 8
+    #define LOGGER_CONTEXT_KEY_MAX 32
+    #define LOGGER_CONTEXT_VALUE_MAX 64
+    #define LOGGER_THREAD_NAME_MAX 16
+    #define LOGGER_FRAME_MAGIC 0x315a474cu /* "LGZ1" */
+    #define LOGGER_FRAME_STORED 1u
+    #define LOGGER_INDEX_MAGIC 0x3158494cu /* "LIX1" */
+    #define LOGGER_RING_MAGIC 0x31474e52u /* "RNG1" */
+    #define LOGGER_RING_SLOT_SIZE 256
+    #define LOGGER_RING_CONTINUED 1u
+    #define LOGGER_SHARD_MAGIC 0x31445353u /* "SSD1" */
 
     /* Log levels */
     typedef enum {
@@ -32,18 +49,163 @@
         LOG_LEVEL_FATAL = 5
     } log_level_t;
 
+    /* One key/value pair of a thread's logging context */
+    typedef struct {
+        char key[LOGGER_CONTEXT_KEY_MAX];
+        char value[LOGGER_CONTEXT_VALUE_MAX];
+    } log_context_field_t;
+
     /* Log event structure */
     typedef struct {
         va_list ap;
         const char *fmt;
         const char *file;
         const char *function;
+        const char *category;
         struct tm *time;
+        int64_t timestamp_ns;
         void *user_data;
+        const char *thread_name;
+        const log_context_field_t *context;
+        int context_count;
+        int thread_id;
         int line;
         log_level_t level;
     } log_event_t;
 
+    /* Record framing of a TCP output */
+    typedef enum {
+        LOG_FRAMING_NEWLINE = 0,
+        LOG_FRAMING_LENGTH  = 1
+    } log_framing_t;
+
+    /* Header in front of every compressed output frame */
+    typedef struct {
+        uint32_t magic;
+        uint32_t flags;
+        uint32_t raw_size;
+        uint32_t packed_size;
+        uint32_t record_count;
+        uint32_t reserved;
+        int64_t first_ns;
+        int64_t last_ns;
+    } log_frame_header_t;
+
+    /* File index header, followed by log_index_entry_t records */
+    typedef struct {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t every;
+        uint32_t reserved;
+    } log_index_header_t;
+
+    /* One indexed block of records in a log file */
+    typedef struct {
+        uint64_t offset;
+        int64_t first_ns;
+        int64_t last_ns;
+        uint32_t count;
+        uint32_t level_mask;
+    } log_index_entry_t;
+
+    /* First slot of a crash ring file */
+    typedef struct {
+        uint32_t magic;
+        uint32_t slot_size;
+        uint64_t slot_count;
+    } log_ring_header_t;
+
+    /* Slot of a crash ring file, followed by up to LOGGER_RING_SLOT_SIZE - 16 bytes of text */
+    typedef struct {
+        uint64_t seq;
+        uint16_t length;
+        uint8_t level;
+        uint8_t flags;
+        uint32_t reserved;
+    } log_ring_slot_t;
+
+    /* Start of a per-thread shard file; `run` tells the process runs that reuse a tid apart */
+    typedef struct {
+        uint32_t magic;
+        int32_t tid;
+        uint64_t run;
+    } log_shard_header_t;
+
+    /* Record of a shard file, followed by `length` bytes of text in the file output format */
+    typedef struct {
+        int64_t timestamp_ns;
+        uint64_t seq;
+        uint32_t length;
+        uint32_t reserved;
+    } log_shard_record_t;
+
+    /* Logger statistics */
+    typedef struct {
+        size_t memory_budget;
+        unsigned long records_total;
+        unsigned long records_in_use;
+        unsigned long long records_dropped;
+        unsigned long long records_truncated;
+        unsigned long long records_throttled;
+        unsigned long long records_rerouted;
+        unsigned long long records_stall_dropped;
+    } log_stats_t;
+
+    /* Events gathered by logger_batch_add, delivered together on commit */
+    typedef struct {
+        void *head;
+        void *tail;
+        unsigned count;
+        unsigned dropped;
+    } log_batch_t;
+
+    /* Call site of a LOG_SPAN, one static instance per site */
+    typedef struct {
+        const char *name;
+        const char *file;
+        int line;
+        int id;
+    } log_span_site_t;
+
+    /* Running span, ended when its scope closes */
+    typedef struct {
+        log_span_site_t *site;
+        uint64_t start;
+    } log_span_t;
+
+    /* Kind of an aggregated metric */
+    typedef enum {
+        LOG_METRIC_COUNTER = 0,
+        LOG_METRIC_GAUGE   = 1
+    } log_metric_kind_t;
+
+    /* Call site of a log_counter_add or log_gauge_set, one static instance per site */
+    typedef struct {
+        const char *name;
+        const char *file;
+        int line;
+        log_metric_kind_t kind;
+        int id;
+    } log_metric_site_t;
+
+    /* Volume of one call site, as returned by logger_profile_top */
+    typedef struct {
+        const char *file;
+        const char *function;
+        int line;
+        log_level_t level;
+        unsigned long long events;
+        unsigned long long bytes;
+    } log_profile_entry_t;
+
+    /* Named category; `effective_level` is resolved again whenever any level changes */
+    typedef struct {
+        char name[LOGGER_CATEGORY_NAME_MAX];
+        int parent;
+        int level;
+        log_level_t effective_level;
+    } log_category_t;
+
     /* Function pointer types */
     typedef void (*log_output_fn_t)(log_event_t *event);
     typedef void (*log_lock_fn_t)(bool lock, void *user_data);
@@ -55,6 +217,7 @@
         bool use_colors;
         bool show_file_line;
         bool show_function;
+        bool show_context;
         log_lock_fn_t lock_fn;
         void *lock_data;
     } log_config_t;
@@ -71,31 +234,171 @@
     #define log_error(...) logger_log(LOG_LEVEL_ERROR, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
     #define log_fatal(...) logger_log(LOG_LEVEL_FATAL, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
 
+    /* Hexdump macro */
+    #define log_hexdump(level, data, size, label) logger_hexdump(level, __FILE__, __FUNCTION__, __LINE__, data, size, label)
+
+    /* Batch macro */
+    #define log_batch(batch, level, ...) logger_batch_add(batch, level, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__)
+
+    /* Time the rest of the enclosing scope */
+    #define LOG_SPAN(name) \
+        static log_span_site_t LOGGER_CONCAT_(logger_span_site_, __LINE__) = { name, __FILE__, __LINE__, 0 }; \
+        log_span_t LOGGER_CONCAT_(logger_span_, __LINE__) __attribute__((cleanup(logger_span_end))) = \
+            logger_span_begin(&LOGGER_CONCAT_(logger_span_site_, __LINE__))
+
+    /* Aggregate a value into the next metric summary; `name` must be a string constant */
+    #define log_counter_add(name, value) LOGGER_METRIC_(name, LOG_METRIC_COUNTER, value)
+    #define log_gauge_set(name, value)   LOGGER_METRIC_(name, LOG_METRIC_GAUGE, value)
+
+    #define LOGGER_METRIC_(name, kind, value) do { \
+        static log_metric_site_t logger_metric_site_ = { name, __FILE__, __LINE__, kind, 0 }; \
+        logger_metric_record(&logger_metric_site_, (double)(value)); \
+    } while (0)
+
+    #define LOGGER_CONCAT_(a, b) LOGGER_CONCAT2_(a, b)
+    #define LOGGER_CONCAT2_(a, b) a##b
+
+    /* Category macros */
+    #define log_cat_trace(cat, ...) LOGGER_CAT_LOG_(cat, LOG_LEVEL_TRACE, __VA_ARGS__)
+    #define log_cat_debug(cat, ...) LOGGER_CAT_LOG_(cat, LOG_LEVEL_DEBUG, __VA_ARGS__)
+    #define log_cat_info(cat, ...)  LOGGER_CAT_LOG_(cat, LOG_LEVEL_INFO,  __VA_ARGS__)
+    #define log_cat_warn(cat, ...)  LOGGER_CAT_LOG_(cat, LOG_LEVEL_WARN,  __VA_ARGS__)
+    #define log_cat_error(cat, ...) LOGGER_CAT_LOG_(cat, LOG_LEVEL_ERROR, __VA_ARGS__)
+    #define log_cat_fatal(cat, ...) LOGGER_CAT_LOG_(cat, LOG_LEVEL_FATAL, __VA_ARGS__)
+
+    #define LOGGER_CAT_LOG_(cat, lvl, ...) do { \
+        log_category_t *logger_cat_ = (cat); \
+        if (logger_category_enabled(logger_cat_, lvl) || logger_site_enabled(__FILE__, __LINE__)) { \
+            logger_log_cat(logger_cat_, lvl, __FILE__, __FUNCTION__, __LINE__, __VA_ARGS__); \
+        } \
+    } while (0)
+
     /* Core API functions */
     void logger_init(void);
     void logger_cleanup(void);
 
     /* Configuration functions */
     void logger_set_level(log_level_t level);
+    log_level_t logger_get_level(void);
     void logger_set_quiet(bool quiet);
     void logger_set_colors(bool use_colors);
     void logger_set_show_file_line(bool show);
     void logger_set_show_function(bool show);
+    void logger_set_show_context(bool show);
     void logger_set_lock(log_lock_fn_t fn, void *user_data);
+    void logger_set_coalesce(unsigned window_ms);
+    int logger_set_memory_budget(size_t bytes);
+    int logger_set_tsc_clock(bool enabled);
+    int logger_set_async(bool enabled);
+    int logger_set_format_workers(unsigned workers);
+    int logger_set_rate_budget(unsigned long events_per_sec, unsigned long long bytes_per_sec);
+    log_level_t logger_throttle_level(void);
+    void logger_get_stats(log_stats_t *stats);
 
     /* Output functions */
     int logger_add_console_output(log_level_t level);
     int logger_add_file_output(FILE *file, log_level_t level);
+    int logger_add_json_output(FILE *file, log_level_t level);
     int logger_add_custom_output(log_output_fn_t output_fn, void *user_data, log_level_t level);
+    int logger_add_compressed_output(const char *path, log_level_t level);
+    int logger_add_tcp_output(const char *host, int port, log_framing_t framing, const char *spool_path, size_t spool_limit, log_level_t level);
+    int logger_add_ring_output(const char *path, size_t size, log_level_t level);
+    int logger_set_shard_output(const char *base_path, log_level_t level);
+    int logger_set_file_index(FILE *file, FILE *index_file, unsigned every);
+    int logger_find_output(log_output_fn_t output_fn, void *user_data);
+    int logger_remove_output(int output);
+    int logger_set_output_coalesce(int output, bool enabled);
+    int logger_set_output_pattern(int output, const char *pattern);
+    int logger_add_output_filter(int output, const char *rule);
+    int logger_clear_output_filters(int output);
+    int logger_set_output_watchdog(unsigned stall_ms, int fallback_output);
+    bool logger_output_degraded(int output);
+
+    /* Category functions */
+    log_category_t *logger_category(const char *name);
+    int logger_set_category_level(const char *name, log_level_t level);
+    int logger_clear_category_level(const char *name);
+    void logger_log_cat(log_category_t *category, log_level_t level, const char *file, const char *function, int line, const char *fmt, ...);
+
+    /* One load and a compare: level changes keep every effective level up to date */
+    static inline bool logger_category_enabled(log_category_t *category, log_level_t level) {
+        return level >= __atomic_load_n(&category->effective_level, __ATOMIC_RELAXED);
+    }
+
+    /* Profiler functions */
+    void logger_set_profiler(bool enabled);
+    void logger_profile_reset(void);
+    int logger_profile_top(log_profile_entry_t *entries, int max, log_profile_entry_t *total);
+    void logger_profile_report(unsigned top_n);
+    int logger_set_profile_interval(unsigned interval_ms, unsigned top_n);
+
+    /* Metric functions */
+    void logger_metric_record(log_metric_site_t *site, double value);
+    void logger_metric_report(void);
+    int logger_set_metric_interval(unsigned interval_ms);
+
+    /* Batch functions */
+    void logger_batch_begin(log_batch_t *batch);
+    int logger_batch_add(log_batch_t *batch, log_level_t level, const char *file, const char *function, int line, const char *fmt, ...);
+    int logger_batch_commit(log_batch_t *batch);
+    void logger_batch_discard(log_batch_t *batch);
+
+    /* Span functions */
+    log_span_t logger_span_begin(log_span_site_t *site);
+    void logger_span_end(log_span_t *span);
+    void logger_span_report(void);
+    int logger_set_span_interval(unsigned interval_ms);
+    void logger_set_span_trace(FILE *file);
+
+    /* Thread context functions */
+    int logger_context_set(const char *key, const char *value);
+    void logger_context_clear(const char *key);
+    void logger_set_thread_name(const char *name);
+    int logger_thread_id(void);
+
+    /* Configuration file functions */
+    int logger_load_config(const char *path);
+    int logger_watch_config(const char *path);
+    void logger_unwatch_config(void);
+    const char *logger_config_error(void);
+
+    /* Control socket functions */
+    int logger_serve_control(const char *socket_path);
+    void logger_stop_control(void);
+    int logger_set_site_enabled(const char *file, int line, bool enabled);
+    extern unsigned logger_site_count;
+    bool logger_site_lookup(const char *file, int line);
+
+    /* Only reached for statements below their level; one load while no site is enabled */
+    static inline bool logger_site_enabled(const char *file, int line) {
+        return __atomic_load_n(&logger_site_count, __ATOMIC_RELAXED) && logger_site_lookup(file, line);
+    }
 
     /* Utility functions */
     const char* logger_level_to_string(log_level_t level);
     log_level_t logger_string_to_level(const char *str);
     void logger_log(log_level_t level, const char *file, const char *function, int line, const char *fmt, ...);
+    void logger_logv(log_level_t level, const char *file, const char *function, int line, const char *fmt, va_list ap);
+    void logger_flush(void);
+    void logger_hexdump(log_level_t level, const char *file, const char *function, int line, const void *data, size_t size, const char *label);
+    void logger_set_hexdump_limit(size_t bytes);
 
     /* Built-in output functions */
     void logger_console_output(log_event_t *event);
     void logger_file_output(log_event_t *event);
+    void logger_json_output(log_event_t *event);
+    void logger_compressed_output(log_event_t *event);
+    void logger_tcp_output(log_event_t *event);
+    void logger_ring_output(log_event_t *event);
+
+    /* Block compression used by compressed outputs */
+    size_t logger_lz_bound(size_t size);
+    size_t logger_lz_compress(const void *src, size_t size, void *dst, size_t capacity);
+    long logger_lz_decompress(const void *src, size_t size, void *dst, size_t capacity);
+
+    #ifdef __cplusplus
+    }
+    #endif
 
 // ╚═════════════════════════════════════════════════════════════════════════════════════╝
 
@@ -0,0 +1,503 @@
+// loggin.hpp — Type-Checked C++ Front End for the C Logging Library
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#ifndef LOGGIN_HPP
+#define LOGGIN_HPP
+
+// ╔══════════════════════════════════════ PACK ══════════════════════════════════════╗
+
+    #include "loggin.h"
+    #include <cstddef>
+    #include <cstdint>
+    #include <cstdio>
+    #include <cstring>
+    #include <string>
+    #include <string_view>
+    #include <type_traits>
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Logging macros, the format must be a string literal */
+    #define LOG_TRACE(...) LOGGIN_LOG_(nullptr, LOG_LEVEL_TRACE, __VA_ARGS__)
+    #define LOG_DEBUG(...) LOGGIN_LOG_(nullptr, LOG_LEVEL_DEBUG, __VA_ARGS__)
+    #define LOG_INFO(...)  LOGGIN_LOG_(nullptr, LOG_LEVEL_INFO,  __VA_ARGS__)
+    #define LOG_WARN(...)  LOGGIN_LOG_(nullptr, LOG_LEVEL_WARN,  __VA_ARGS__)
+    #define LOG_ERROR(...) LOGGIN_LOG_(nullptr, LOG_LEVEL_ERROR, __VA_ARGS__)
+    #define LOG_FATAL(...) LOGGIN_LOG_(nullptr, LOG_LEVEL_FATAL, __VA_ARGS__)
+
+    /* Category macros */
+    #define LOG_CAT_TRACE(cat, ...) LOGGIN_LOG_(cat, LOG_LEVEL_TRACE, __VA_ARGS__)
+    #define LOG_CAT_DEBUG(cat, ...) LOGGIN_LOG_(cat, LOG_LEVEL_DEBUG, __VA_ARGS__)
+    #define LOG_CAT_INFO(cat, ...)  LOGGIN_LOG_(cat, LOG_LEVEL_INFO,  __VA_ARGS__)
+    #define LOG_CAT_WARN(cat, ...)  LOGGIN_LOG_(cat, LOG_LEVEL_WARN,  __VA_ARGS__)
+    #define LOG_CAT_ERROR(cat, ...) LOGGIN_LOG_(cat, LOG_LEVEL_ERROR, __VA_ARGS__)
+    #define LOG_CAT_FATAL(cat, ...) LOGGIN_LOG_(cat, LOG_LEVEL_FATAL, __VA_ARGS__)
+
+    /* RAII form of the C span macro */
+    #undef LOG_SPAN
+    #define LOG_SPAN(name) \
+        static log_span_site_t LOGGER_CONCAT_(loggin_span_site_, __LINE__) = { name, __FILE__, __LINE__, 0 }; \
+        ::loggin::span LOGGER_CONCAT_(loggin_span_, __LINE__)(&LOGGER_CONCAT_(loggin_span_site_, __LINE__))
+
+    #define LOGGIN_FMT_(...) LOGGIN_FMT_IMPL_(__VA_ARGS__, 0)
+    #define LOGGIN_FMT_IMPL_(fmt, ...) fmt
+
+    /* The plan is built and checked at compile time, once per call site */
+    #define LOGGIN_LOG_(cat, lvl, ...) do { \
+        log_category_t *loggin_cat_ = (cat); \
+        using loggin_args_ = decltype(::loggin::detail::types_of(__VA_ARGS__)); \
+        static constexpr auto loggin_plan_ = ::loggin::detail::compile<::loggin::detail::count_segments(LOGGIN_FMT_(__VA_ARGS__))>( \
+            LOGGIN_FMT_(__VA_ARGS__), loggin_args_{}); \
+        if (::loggin::enabled(loggin_cat_, (lvl), __FILE__, __LINE__)) { \
+            ::loggin::detail::emit(loggin_cat_, (lvl), __FILE__, __FUNCTION__, __LINE__, loggin_plan_, __VA_ARGS__); \
+        } \
+    } while (0)
+
+    namespace loggin {
+        namespace detail {
+
+            /* Longest message the C core renders, see MAX_MESSAGE_LEN */
+            constexpr std::size_t message_capacity = 1024;
+
+            /* What a captured argument is, after decay */
+            enum class arg_kind : unsigned char { signed_int, unsigned_int, floating, string, pointer, other };
+
+            /* One conversion of the format, with a ready-made printf spec */
+            struct spec_t {
+                char conv = 0;
+                bool plain = true;   /* No flags, width or precision */
+                int precision = -1;
+                char printf_spec[24] = {};
+            };
+
+            /* A literal run of the format or one argument */
+            struct segment_t {
+                std::size_t begin = 0;
+                std::size_t length = 0;
+                int arg = -1;
+                spec_t spec;
+            };
+
+            template <std::size_t N>
+            struct plan_t {
+                segment_t segments[N ? N : 1];
+                std::size_t count = 0;
+                const char *fmt = nullptr;
+            };
+
+            template <class... A>
+            struct type_list {
+                static constexpr std::size_t size = sizeof...(A);
+            };
+
+            /* Only used in decltype, the format itself is dropped */
+            template <class Fmt, class... A>
+            type_list<std::decay_t<A>...> types_of(Fmt &&, A &&...);
+
+            /* String argument, length -1 until measured */
+            struct text_t {
+                const char *data;
+                std::size_t length;
+            };
+
+            /* Packed by-value copy of one argument */
+            struct captured_t {
+                arg_kind kind;
+                unsigned char bytes;
+                union {
+                    intmax_t i;
+                    uintmax_t u;
+                    double f;
+                    const void *p;
+                    text_t s;
+                };
+            };
+
+        }
+    }
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    namespace loggin {
+        namespace detail {
+
+            // ┌──────────────────────────── COMPILE TIME ────────────────────────────┐
+
+                template <class T>
+                constexpr arg_kind kind_of() {
+                    using U = std::remove_cv_t<T>;
+                    if constexpr (std::is_enum_v<U>) {
+                        return std::is_signed_v<std::underlying_type_t<U>> ? arg_kind::signed_int : arg_kind::unsigned_int;
+                    } else if constexpr (std::is_integral_v<U>) {
+                        return std::is_signed_v<U> ? arg_kind::signed_int : arg_kind::unsigned_int;
+                    } else if constexpr (std::is_floating_point_v<U>) {
+                        return arg_kind::floating;
+                    } else if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*> ||
+                                         std::is_same_v<U, std::string> || std::is_same_v<U, std::string_view>) {
+                        return arg_kind::string;
+                    } else if constexpr (std::is_pointer_v<U> || std::is_null_pointer_v<U>) {
+                        return arg_kind::pointer;
+                    } else {
+                        return arg_kind::other;
+                    }
+                }
+
+                /* Not constexpr: reaching it during compilation is the diagnostic */
+                inline void format_error(const char *) {}
+
+                constexpr bool is_flag(char c) {
+                    return c == '-' || c == '+' || c == ' ' || c == '#' || c == '0';
+                }
+
+                constexpr bool is_digit(char c) {
+                    return c >= '0' && c <= '9';
+                }
+
+                /* Literal runs plus conversions, enough room for the plan */
+                constexpr std::size_t count_segments(const char *fmt) {
+                    std::size_t count = 1;
+                    for (std::size_t i = 0; fmt[i]; i++) {
+                        if (fmt[i] == '%') {
+                            count += 2;
+                            i += fmt[i + 1] == '%';
+                        }
+                    }
+                    return count;
+                }
+
+                constexpr bool accepts(char conv, arg_kind kind) {
+                    switch (conv) {
+                        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+                            return kind == arg_kind::signed_int || kind == arg_kind::unsigned_int;
+                        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                            return kind == arg_kind::floating;
+                        case 's':
+                            return kind == arg_kind::string;
+                        case 'p':
+                            return kind == arg_kind::pointer || kind == arg_kind::string;
+                        default:
+                            return false;
+                    }
+                }
+
+                /* Parse one "%[flags][width][.precision][length]conv" starting after '%' */
+                constexpr std::size_t parse_spec(const char *fmt, std::size_t i, spec_t &spec) {
+                    std::size_t out = 0;
+                    spec.printf_spec[out++] = '%';
+
+                    while (is_flag(fmt[i])) {
+                        spec.printf_spec[out++] = fmt[i++];
+                        spec.plain = false;
+                    }
+                    while (is_digit(fmt[i])) {
+                        spec.printf_spec[out++] = fmt[i++];
+                        spec.plain = false;
+                    }
+                    if (fmt[i] == '.') {
+                        i++;
+                        spec.plain = false;
+                        spec.precision = 0;
+                        while (is_digit(fmt[i])) {
+                            spec.precision = spec.precision * 10 + (fmt[i++] - '0');
+                        }
+                    }
+                    if (fmt[i] == '*' || out > 12) {
+                        format_error("'*' widths and very long specs are not supported");
+                    }
+
+                    /* Length modifiers carry no information, the type is known */
+                    while (fmt[i] == 'h' || fmt[i] == 'l' || fmt[i] == 'j' || fmt[i] == 'z' ||
+                           fmt[i] == 't' || fmt[i] == 'L' || fmt[i] == 'q') {
+                        i++;
+                    }
+
+                    spec.conv = fmt[i];
+                    switch (spec.conv) {
+                        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+                            spec.printf_spec[out++] = 'j';
+                            break;
+                        case 's':
+                            spec.printf_spec[out++] = '.';
+                            spec.printf_spec[out++] = '*';
+                            break;
+                        case 'c': case 'p':
+                        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                            break;
+                        default:
+                            format_error("unknown conversion in log format");
+                    }
+                    if (spec.precision >= 0 && spec.conv != 's') {
+                        /* Re-insert the precision in front of the length modifier */
+                        std::size_t tail = spec.conv == 'd' || spec.conv == 'i' || spec.conv == 'u' ||
+                                           spec.conv == 'x' || spec.conv == 'X' || spec.conv == 'o';
+                        char digits[12] = {};
+                        std::size_t n = 0;
+                        int p = spec.precision;
+                        do {
+                            digits[n++] = (char)('0' + p % 10);
+                            p /= 10;
+                        } while (p);
+                        out -= tail;
+                        spec.printf_spec[out++] = '.';
+                        while (n) {
+                            spec.printf_spec[out++] = digits[--n];
+                        }
+                        if (tail) {
+                            spec.printf_spec[out++] = 'j';
+                        }
+                    }
+                    spec.printf_spec[out++] = spec.conv;
+                    spec.printf_spec[out] = '\0';
+                    return i + 1;
+                }
+
+                /* Split the format into literal runs and typed conversions */
+                template <std::size_t N, class... A>
+                constexpr plan_t<N> compile(const char *fmt, type_list<A...>) {
+                    constexpr arg_kind kinds[sizeof...(A) + 1] = { kind_of<A>()..., arg_kind::other };
+                    plan_t<N> plan;
+                    plan.fmt = fmt;
+                    std::size_t literal = 0;
+                    std::size_t i = 0;
+                    int arg = 0;
+
+                    while (fmt[i]) {
+                        if (fmt[i] != '%') {
+                            i++;
+                            continue;
+                        }
+                        if (fmt[i + 1] == '%') {
+                            /* Keep one '%' in the literal run and skip the other */
+                            plan.segments[plan.count++] = segment_t{ literal, i + 1 - literal, -1, spec_t{} };
+                            literal = i += 2;
+                            continue;
+                        }
+                        if (i > literal) {
+                            plan.segments[plan.count++] = segment_t{ literal, i - literal, -1, spec_t{} };
+                        }
+
+                        segment_t segment{ 0, 0, arg, spec_t{} };
+                        i = parse_spec(fmt, i + 1, segment.spec);
+                        if (arg >= (int)sizeof...(A)) {
+                            format_error("log format has more conversions than arguments");
+                        } else if (!accepts(segment.spec.conv, kinds[arg])) {
+                            format_error("log argument type does not match its conversion");
+                        }
+                        plan.segments[plan.count++] = segment;
+                        literal = i;
+                        arg++;
+                    }
+
+                    if (i > literal) {
+                        plan.segments[plan.count++] = segment_t{ literal, i - literal, -1, spec_t{} };
+                    }
+                    if (arg != (int)sizeof...(A)) {
+                        format_error("log format has fewer conversions than arguments");
+                    }
+                    return plan;
+                }
+
+            // └────────────────────────────────────────────────────────────────────┘
+
+            // ┌──────────────────────────── CAPTURE ────────────────────────────┐
+
+                template <class T>
+                inline captured_t capture(const T &value) {
+                    captured_t arg{};
+                    arg.kind = kind_of<T>();
+                    arg.bytes = (unsigned char)sizeof(T);
+                    if constexpr (std::is_enum_v<T>) {
+                        arg.i = (intmax_t)static_cast<std::underlying_type_t<T>>(value);
+                    } else if constexpr (std::is_integral_v<T>) {
+                        if constexpr (std::is_signed_v<T>) {
+                            arg.i = value;
+                        } else {
+                            arg.u = value;
+                        }
+                    } else if constexpr (std::is_floating_point_v<T>) {
+                        arg.f = (double)value;
+                    } else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>) {
+                        arg.s.data = value.data();
+                        arg.s.length = value.size();
+                    } else if constexpr (std::is_same_v<T, const char*> || std::is_same_v<T, char*>) {
+                        arg.s.data = value ? value : "(null)";
+                        arg.s.length = (std::size_t)-1; /* Measured when rendered */
+                    } else if constexpr (std::is_pointer_v<T>) {
+                        arg.p = (const void*)value;
+                    } else {
+                        arg.p = nullptr;
+                    }
+                    return arg;
+                }
+
+            // └────────────────────────────────────────────────────────────────────┘
+
+            // ┌──────────────────────────── RENDERING ────────────────────────────┐
+
+                /* Bounded append into the message buffer, truncating like vsnprintf */
+                struct writer_t {
+                    char *buf;
+                    std::size_t used;
+
+                    void append(const char *data, std::size_t length) {
+                        std::size_t room = message_capacity - 1 - used;
+                        length = length < room ? length : room;
+                        std::memcpy(buf + used, data, length);
+                        used += length;
+                    }
+
+                    template <class V>
+                    void print(const char *spec, V value) {
+                        int n = std::snprintf(buf + used, message_capacity - used, spec, value);
+                        if (n > 0) {
+                            used += (std::size_t)n < message_capacity - 1 - used ? (std::size_t)n : message_capacity - 1 - used;
+                        }
+                    }
+                };
+
+                inline void append_decimal(writer_t &out, uintmax_t value, bool negative) {
+                    char digits[24];
+                    char *p = digits + sizeof(digits);
+                    do {
+                        *--p = (char)('0' + value % 10);
+                        value /= 10;
+                    } while (value);
+                    if (negative) {
+                        *--p = '-';
+                    }
+                    out.append(p, (std::size_t)(digits + sizeof(digits) - p));
+                }
+
+                inline void render(writer_t &out, const spec_t &spec, const captured_t &arg) {
+                    switch (spec.conv) {
+                        case 'd': case 'i': {
+                            intmax_t v = arg.kind == arg_kind::signed_int ? arg.i : (intmax_t)arg.u;
+                            if (spec.plain) {
+                                append_decimal(out, v < 0 ? 0 - (uintmax_t)v : (uintmax_t)v, v < 0);
+                            } else {
+                                out.print(spec.printf_spec, v);
+                            }
+                            return;
+                        }
+                        case 'u': case 'x': case 'X': case 'o': {
+                            uintmax_t v = arg.u;
+                            if (arg.kind == arg_kind::signed_int && arg.bytes < sizeof(uintmax_t)) {
+                                /* Match C, where -1 as %x of an int is ffffffff */
+                                v &= ((uintmax_t)1 << (arg.bytes * 8)) - 1;
+                            }
+                            if (spec.plain && spec.conv == 'u') {
+                                append_decimal(out, v, false);
+                            } else {
+                                out.print(spec.printf_spec, v);
+                            }
+                            return;
+                        }
+                        case 'c':
+                            out.print(spec.printf_spec, (int)arg.i);
+                            return;
+                        case 'p':
+                            out.print(spec.printf_spec, arg.kind == arg_kind::string ? (const void*)arg.s.data : arg.p);
+                            return;
+                        case 's': {
+                            std::size_t length = arg.s.length;
+                            if (length == (std::size_t)-1) {
+                                length = spec.precision >= 0 ? strnlen(arg.s.data, (std::size_t)spec.precision)
+                                                             : std::strlen(arg.s.data);
+                            } else if (spec.precision >= 0 && (std::size_t)spec.precision < length) {
+                                length = (std::size_t)spec.precision;
+                            }
+                            if (spec.plain) {
+                                out.append(arg.s.data, length);
+                            } else {
+                                int n = std::snprintf(out.buf + out.used, message_capacity - out.used,
+                                                      spec.printf_spec, (int)length, arg.s.data);
+                                if (n > 0) {
+                                    std::size_t room = message_capacity - 1 - out.used;
+                                    out.used += (std::size_t)n < room ? (std::size_t)n : room;
+                                }
+                            }
+                            return;
+                        }
+                        default:
+                            out.print(spec.printf_spec, arg.f);
+                            return;
+                    }
+                }
+
+                /* Render the captured arguments and hand the finished text to the C core */
+                template <std::size_t N, class... A>
+                inline void emit(log_category_t *category, log_level_t level, const char *file, const char *function,
+                                 int line, const plan_t<N> &plan, const char *, const A &...args) {
+                    const captured_t captured[sizeof...(A) + 1] = { capture<std::decay_t<const A>>(args)..., captured_t{} };
+                    char buf[message_capacity];
+                    writer_t out{ buf, 0 };
+
+                    for (std::size_t i = 0; i < plan.count; i++) {
+                        const segment_t &segment = plan.segments[i];
+                        if (segment.arg < 0) {
+                            out.append(plan.fmt + segment.begin, segment.length);
+                        } else {
+                            render(out, segment.spec, captured[segment.arg]);
+                        }
+                    }
+                    buf[out.used] = '\0';
+
+                    if (category) {
+                        logger_log_cat(category, level, file, function, line, "%s", buf);
+                    } else {
+                        logger_log(level, file, function, line, "%s", buf);
+                    }
+                }
+
+            // └────────────────────────────────────────────────────────────────────┘
+
+        }
+
+        /// Scoped span timer.
+        ///
+        /// Records the time between construction and destruction in the
+        /// site's histogram, the same way the C `LOG_SPAN` does.
+        class span {
+            public:
+                explicit span(log_span_site_t *site) : span_(logger_span_begin(site)) {}
+                ~span() { logger_span_end(&span_); }
+
+                span(const span &) = delete;
+                span &operator=(const span &) = delete;
+
+            private:
+                log_span_t span_;
+        };
+
+        /// Check whether a level would be logged at all
+        ///
+        /// Uses the category's cached level when there is one and the global level otherwise,
+        /// so disabled statements cost a load and a compare, plus one load for the site table.
+        ///
+        /// __Parameters__
+        /// - `category`: Category of the statement, or `nullptr`
+        /// - `level`: Level of the statement
+        /// - `file`: Source file of the statement, or `nullptr` to ignore enabled sites
+        /// - `line`: Line of the statement
+        ///
+        /// __Return__
+        /// - `true` if the statement should be rendered
+        inline bool enabled(log_category_t *category, log_level_t level, const char *file = nullptr, int line = 0) {
+            bool on = category ? logger_category_enabled(category, level) : level >= logger_get_level();
+            return on || (file && logger_site_enabled(file, line));
+        }
+
+    }
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+#endif /* LOGGIN_HPP */
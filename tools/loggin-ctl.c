@@ -0,0 +1,115 @@
+// loggin-ctl.c — Client for the Logger Control Socket
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Longest request line the server reads */
+    #define REQUEST_MAX 512
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── ARGUMENTS ────────────────────────────┐
+
+        static void usage(const char *prog) {
+            fprintf(stderr,
+                    "usage: %s SOCKET COMMAND [ARGS...]\n"
+                    "Sends one command to a process serving logger_serve_control:\n"
+                    "  level [LEVEL]               show or set the global level\n"
+                    "  category NAME LEVEL|clear   set or clear a category level\n"
+                    "  site on|off FILE[:LINE]     log one call site or file below the level\n"
+                    "  sites                       list enabled call sites\n"
+                    "  outputs                     list outputs\n"
+                    "  stats                       show logger stats\n"
+                    "  flush                       flush all outputs\n", prog);
+        }
+
+        /* Join the command words into one request line */
+        static int build_request(char *request, size_t size, int argc, char **argv) {
+            size_t len = 0;
+            for (int i = 0; i < argc; i++) {
+                int n = snprintf(request + len, size - len, "%s%s", i ? " " : "", argv[i]);
+                if (n < 0 || (size_t)n >= size - len) {
+                    return -1;
+                }
+                len += (size_t)n;
+            }
+            if (len + 1 >= size) {
+                return -1;
+            }
+            request[len++] = '\n';
+            request[len] = '\0';
+            return (int)len;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── MAIN ────────────────────────────┐
+
+        int main(int argc, char **argv) {
+            struct sockaddr_un addr = { .sun_family = AF_UNIX };
+            char request[REQUEST_MAX];
+            char reply[4096];
+            bool first = true;
+            bool failed = false;
+
+            if (argc < 3 || argv[1][0] == '-' || strlen(argv[1]) >= sizeof(addr.sun_path)) {
+                usage(argv[0]);
+                return 2;
+            }
+            int len = build_request(request, sizeof(request), argc - 2, argv + 2);
+            if (len < 0) {
+                fprintf(stderr, "%s: command too long\n", argv[0]);
+                return 2;
+            }
+
+            strcpy(addr.sun_path, argv[1]);
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+                perror(argv[1]);
+                return 1;
+            }
+            if (write(fd, request, (size_t)len) != len) {
+                perror(argv[1]);
+                close(fd);
+                return 1;
+            }
+
+            /* An "ok" status line is dropped; an error goes to stderr as is */
+            ssize_t n;
+            while ((n = read(fd, reply, sizeof(reply))) > 0) {
+                const char *body = reply;
+                size_t size = (size_t)n;
+                if (first) {
+                    const char *newline = memchr(reply, '\n', size);
+                    failed = strncmp(reply, "ok", 2) != 0;
+                    if (!failed && newline) {
+                        body = newline + 1;
+                        size -= (size_t)(body - reply);
+                    }
+                    first = false;
+                }
+                fwrite(body, 1, size, failed ? stderr : stdout);
+            }
+            close(fd);
+            return first || failed ? 1 : 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
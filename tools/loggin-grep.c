@@ -0,0 +1,452 @@
+// loggin-grep.c — SIMD Filter for Log Files Produced by logger_file_output
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define LOGGIN_GREP_X86 1
+#endif
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Line layout: "YYYY-mm-dd HH:MM:SS LEVEL file:line [func]: msg" */
+    #define STAMP_LEN 19
+    #define LEVEL_OFFSET (STAMP_LEN + 1)
+
+    /* Files smaller than this per thread are not split further */
+    #define MIN_CHUNK (1u << 20)
+    #define MAX_THREADS 64
+
+    /* Filters from the command line */
+    typedef struct {
+        uint32_t level_mask;
+        const char *time_prefix;
+        size_t time_prefix_len;
+        const char *from_text;
+        const char *to_text;
+        const char *needle;
+        size_t needle_len;
+        bool count_only;
+    } filter_t;
+
+    /* One thread's slice of a mapped file and its matches */
+    typedef struct {
+        const filter_t *filter;
+        const char *begin;
+        const char *end;
+        char *out;
+        size_t out_len;
+        size_t out_cap;
+        size_t matches;
+        pthread_t thread;
+    } chunk_t;
+
+    /* First four bytes of each level name, unique per level */
+    static uint32_t level_keys[6];
+
+    /* Scanners picked once at startup for the running CPU */
+    static const char *(*find_newline)(const char *p, const char *end);
+    static const char *(*find_needle)(const char *p, const char *end, const char *needle, size_t len);
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── SCANNERS ────────────────────────────┐
+
+        static const char *newline_scalar(const char *p, const char *end) {
+            const char *nl = memchr(p, '\n', (size_t)(end - p));
+            return nl ? nl : end;
+        }
+
+        static const char *needle_scalar(const char *p, const char *end, const char *needle, size_t len) {
+            const char *hit = memmem(p, (size_t)(end - p), needle, len);
+            return hit ? hit : end;
+        }
+
+#ifdef LOGGIN_GREP_X86
+
+        __attribute__((target("sse2")))
+        static const char *newline_sse2(const char *p, const char *end) {
+            const __m128i nl = _mm_set1_epi8('\n');
+            for (; end - p >= 16; p += 16) {
+                __m128i block = _mm_loadu_si128((const __m128i*)p);
+                unsigned mask = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(block, nl));
+                if (mask) {
+                    return p + __builtin_ctz(mask);
+                }
+            }
+            return newline_scalar(p, end);
+        }
+
+        __attribute__((target("avx2")))
+        static const char *newline_avx2(const char *p, const char *end) {
+            const __m256i nl = _mm256_set1_epi8('\n');
+            for (; end - p >= 64; p += 64) {
+                __m256i a = _mm256_loadu_si256((const __m256i*)p);
+                __m256i b = _mm256_loadu_si256((const __m256i*)(p + 32));
+                uint64_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, nl)) |
+                                ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(b, nl)) << 32);
+                if (mask) {
+                    return p + __builtin_ctzll(mask);
+                }
+            }
+            return newline_sse2(p, end);
+        }
+
+        /* Compare first and last needle bytes 16 positions at a time, verify hits */
+        __attribute__((target("sse2")))
+        static const char *needle_sse2(const char *p, const char *end, const char *needle, size_t len) {
+            const __m128i first = _mm_set1_epi8(needle[0]);
+            const __m128i last = _mm_set1_epi8(needle[len - 1]);
+            for (; end - p >= (ptrdiff_t)(len + 15); p += 16) {
+                __m128i a = _mm_loadu_si128((const __m128i*)p);
+                __m128i b = _mm_loadu_si128((const __m128i*)(p + len - 1));
+                unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+                                                                          _mm_cmpeq_epi8(b, last)));
+                while (mask) {
+                    unsigned bit = (unsigned)__builtin_ctz(mask);
+                    if (memcmp(p + bit + 1, needle + 1, len - 1) == 0) {
+                        return p + bit;
+                    }
+                    mask &= mask - 1;
+                }
+            }
+            return needle_scalar(p, end, needle, len);
+        }
+
+        __attribute__((target("avx2")))
+        static const char *needle_avx2(const char *p, const char *end, const char *needle, size_t len) {
+            const __m256i first = _mm256_set1_epi8(needle[0]);
+            const __m256i last = _mm256_set1_epi8(needle[len - 1]);
+            for (; end - p >= (ptrdiff_t)(len + 31); p += 32) {
+                __m256i a = _mm256_loadu_si256((const __m256i*)p);
+                __m256i b = _mm256_loadu_si256((const __m256i*)(p + len - 1));
+                unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first),
+                                                                                _mm256_cmpeq_epi8(b, last)));
+                while (mask) {
+                    unsigned bit = (unsigned)__builtin_ctz(mask);
+                    if (memcmp(p + bit + 1, needle + 1, len - 1) == 0) {
+                        return p + bit;
+                    }
+                    mask &= mask - 1;
+                }
+            }
+            return needle_sse2(p, end, needle, len);
+        }
+
+#endif
+
+        static void pick_scanners(void) {
+            find_newline = newline_scalar;
+            find_needle = needle_scalar;
+#ifdef LOGGIN_GREP_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                find_newline = newline_avx2;
+                find_needle = needle_avx2;
+            } else if (__builtin_cpu_supports("sse2")) {
+                find_newline = newline_sse2;
+                find_needle = needle_sse2;
+            }
+#endif
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── MATCHING ────────────────────────────┐
+
+        static uint32_t load32(const char *p) {
+            uint32_t v;
+            memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        /* Fixed-position field checks; the substring is handled by the caller */
+        static bool line_matches(const filter_t *filter, const char *line, size_t len) {
+            if (len < LEVEL_OFFSET + 5) {
+                return false;
+            }
+            if (filter->level_mask != 0x3f) {
+                uint32_t key = load32(line + LEVEL_OFFSET);
+                bool hit = false;
+                for (int i = 0; i < 6 && !hit; i++) {
+                    hit = (filter->level_mask & (1u << i)) && key == level_keys[i];
+                }
+                if (!hit) {
+                    return false;
+                }
+            }
+            if (filter->time_prefix && (filter->time_prefix_len > len ||
+                                        memcmp(line, filter->time_prefix, filter->time_prefix_len) != 0)) {
+                return false;
+            }
+            if (filter->from_text && memcmp(line, filter->from_text, STAMP_LEN) < 0) {
+                return false;
+            }
+            if (filter->to_text && memcmp(line, filter->to_text, STAMP_LEN) > 0) {
+                return false;
+            }
+            return true;
+        }
+
+        static void emit(chunk_t *chunk, const char *line, size_t len) {
+            chunk->matches++;
+            if (chunk->filter->count_only) {
+                return;
+            }
+            if (chunk->out_len + len + 1 > chunk->out_cap) {
+                size_t cap = chunk->out_cap ? chunk->out_cap * 2 : 1u << 16;
+                while (cap < chunk->out_len + len + 1) {
+                    cap *= 2;
+                }
+                char *out = realloc(chunk->out, cap);
+                if (!out) {
+                    return;
+                }
+                chunk->out = out;
+                chunk->out_cap = cap;
+            }
+            memcpy(chunk->out + chunk->out_len, line, len);
+            chunk->out_len += len;
+            if (len == 0 || line[len - 1] != '\n') {
+                chunk->out[chunk->out_len++] = '\n';
+            }
+        }
+
+        static void *scan_chunk(void *arg) {
+            chunk_t *chunk = (chunk_t*)arg;
+            const filter_t *filter = chunk->filter;
+            const char *p = chunk->begin;
+            const char *end = chunk->end;
+
+            if (filter->needle_len) {
+                /* Jump from needle hit to needle hit, lines without one are never touched */
+                while (p < end) {
+                    const char *hit = find_needle(p, end, filter->needle, filter->needle_len);
+                    if (hit >= end) {
+                        break;
+                    }
+                    const char *line = hit;
+                    while (line > chunk->begin && line[-1] != '\n') {
+                        line--;
+                    }
+                    const char *nl = find_newline(hit, end);
+                    const char *next = nl < end ? nl + 1 : end;
+                    if (line_matches(filter, line, (size_t)(next - line))) {
+                        emit(chunk, line, (size_t)(next - line));
+                    }
+                    p = next;
+                }
+            } else {
+                while (p < end) {
+                    const char *nl = find_newline(p, end);
+                    const char *next = nl < end ? nl + 1 : end;
+                    if (line_matches(filter, p, (size_t)(next - p))) {
+                        emit(chunk, p, (size_t)(next - p));
+                    }
+                    p = next;
+                }
+            }
+            return NULL;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── FILES ────────────────────────────┐
+
+        /* Split on line boundaries, scan slices in parallel, print in order */
+        static int grep_file(const char *path, const filter_t *filter, int threads, bool show_name, size_t *total) {
+            struct stat st;
+            int fd = open(path, O_RDONLY);
+            if (fd < 0 || fstat(fd, &st) != 0) {
+                perror(path);
+                if (fd >= 0) close(fd);
+                return -1;
+            }
+            size_t size = (size_t)st.st_size;
+            if (size == 0) {
+                close(fd);
+                return 0;
+            }
+
+            const char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (data == MAP_FAILED) {
+                perror(path);
+                return -1;
+            }
+            madvise((void*)data, size, MADV_SEQUENTIAL);
+
+            int count = (int)(size / MIN_CHUNK);
+            count = count < 1 ? 1 : count > threads ? threads : count;
+
+            chunk_t chunks[MAX_THREADS];
+            const char *cursor = data;
+            const char *end = data + size;
+            for (int i = 0; i < count; i++) {
+                const char *stop = i + 1 == count ? end : data + size / (size_t)count * (size_t)(i + 1);
+                if (stop < cursor) {
+                    stop = cursor;
+                }
+                if (stop < end) {
+                    stop = find_newline(stop, end);
+                    stop = stop < end ? stop + 1 : end;
+                }
+                chunks[i] = (chunk_t){ .filter = filter, .begin = cursor, .end = stop };
+                cursor = stop;
+            }
+
+            for (int i = 1; i < count; i++) {
+                if (pthread_create(&chunks[i].thread, NULL, scan_chunk, &chunks[i]) != 0) {
+                    scan_chunk(&chunks[i]);
+                    chunks[i].thread = 0;
+                }
+            }
+            scan_chunk(&chunks[0]);
+
+            for (int i = 0; i < count; i++) {
+                if (i > 0 && chunks[i].thread) {
+                    pthread_join(chunks[i].thread, NULL);
+                }
+                *total += chunks[i].matches;
+
+                /* Lines are copied whole, so a name prefix means walking them */
+                if (show_name) {
+                    for (const char *line = chunks[i].out, *stop = line + chunks[i].out_len; line < stop; ) {
+                        const char *nl = memchr(line, '\n', (size_t)(stop - line));
+                        printf("%s:%.*s\n", path, (int)(nl - line), line);
+                        line = nl + 1;
+                    }
+                } else {
+                    fwrite(chunks[i].out, 1, chunks[i].out_len, stdout);
+                }
+                free(chunks[i].out);
+            }
+
+            munmap((void*)data, size);
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── MAIN ────────────────────────────┐
+
+        static void usage(const char *prog) {
+            fprintf(stderr,
+                    "usage: %s [options] FILE...\n"
+                    "  -e TEXT             lines containing TEXT\n"
+                    "  --level L[,L...]    lines at exactly these levels\n"
+                    "  --min-level L       lines at L or above\n"
+                    "  --time PREFIX       timestamp starts with PREFIX (e.g. \"2024-01-15 14:0\")\n"
+                    "  --from / --to T     timestamp range, T is \"YYYY-mm-dd HH:MM:SS\"\n"
+                    "  -c                  print the number of matching lines only\n"
+                    "  -j N                scan with N threads (default: online CPUs)\n", prog);
+        }
+
+        static int parse_level(const char *text) {
+            for (int i = LOG_LEVEL_TRACE; i <= LOG_LEVEL_FATAL; i++) {
+                if (strcasecmp(text, logger_level_to_string((log_level_t)i)) == 0) {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        int main(int argc, char **argv) {
+            filter_t filter = { .level_mask = 0x3f };
+            long online = sysconf(_SC_NPROCESSORS_ONLN);
+            int threads = online > 0 ? (int)online : 1;
+            int arg = 1;
+
+            for (int i = 0; i < 6; i++) {
+                char key[5] = "    ";
+                memcpy(key, logger_level_to_string((log_level_t)i), 4);
+                level_keys[i] = load32(key);
+            }
+
+            for (; arg < argc && argv[arg][0] == '-'; arg++) {
+                const char *opt = argv[arg];
+                char *value = arg + 1 < argc ? argv[arg + 1] : NULL;
+
+                if (strcmp(opt, "-c") == 0) {
+                    filter.count_only = true;
+                    continue;
+                }
+                if (!value) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                arg++;
+
+                if (strcmp(opt, "-e") == 0 && *value) {
+                    filter.needle = value;
+                    filter.needle_len = strlen(value);
+                } else if (strcmp(opt, "-j") == 0 && atoi(value) > 0) {
+                    threads = atoi(value) < MAX_THREADS ? atoi(value) : MAX_THREADS;
+                } else if (strcmp(opt, "--time") == 0 && strlen(value) <= STAMP_LEN) {
+                    filter.time_prefix = value;
+                    filter.time_prefix_len = strlen(value);
+                } else if (strcmp(opt, "--from") == 0 && strlen(value) == STAMP_LEN) {
+                    filter.from_text = value;
+                } else if (strcmp(opt, "--to") == 0 && strlen(value) == STAMP_LEN) {
+                    filter.to_text = value;
+                } else if (strcmp(opt, "--min-level") == 0 && parse_level(value) >= 0) {
+                    filter.level_mask = 0x3fu & ~((1u << parse_level(value)) - 1);
+                } else if (strcmp(opt, "--level") == 0) {
+                    filter.level_mask = 0;
+                    for (char *tok = strtok(value, ","); tok; tok = strtok(NULL, ",")) {
+                        int level = parse_level(tok);
+                        if (level < 0) {
+                            usage(argv[0]);
+                            return 2;
+                        }
+                        filter.level_mask |= 1u << level;
+                    }
+                } else {
+                    usage(argv[0]);
+                    return 2;
+                }
+            }
+
+            if (arg >= argc) {
+                usage(argv[0]);
+                return 2;
+            }
+
+            pick_scanners();
+
+            size_t total = 0;
+            int status = 0;
+            bool show_name = argc - arg > 1 && !filter.count_only;
+            for (; arg < argc; arg++) {
+                if (grep_file(argv[arg], &filter, threads, show_name, &total) != 0) {
+                    status = 2;
+                }
+            }
+
+            if (filter.count_only) {
+                printf("%zu\n", total);
+            }
+            return status ? status : total ? 0 : 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
@@ -0,0 +1,173 @@
+// loggin-merge.c — Merger for Per-Thread Shard Files
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* A mapped shard and the record the merge is at */
+    typedef struct {
+        const char *path;
+        const unsigned char *map;
+        size_t size;
+        size_t offset;
+        log_shard_record_t record;
+    } shard_t;
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── ARGUMENTS ────────────────────────────┐
+
+        static void usage(const char *prog) {
+            fprintf(stderr,
+                    "usage: %s SHARD...\n"
+                    "Merges the logger_set_shard_output files of one run into a single stream,\n"
+                    "ordered by timestamp and then sequence number.\n", prog);
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── SHARDS ────────────────────────────┐
+
+        /* Load the record at the shard's offset; false at the end or at a record cut short */
+        static bool shard_next(shard_t *shard) {
+            if (shard->size - shard->offset < sizeof(log_shard_record_t)) {
+                return false;
+            }
+            memcpy(&shard->record, shard->map + shard->offset, sizeof(shard->record));
+            if (shard->size - shard->offset - sizeof(log_shard_record_t) < shard->record.length) {
+                fprintf(stderr, "%s: last record is incomplete\n", shard->path);
+                return false;
+            }
+            return true;
+        }
+
+        static int shard_open(shard_t *shard, const char *path) {
+            int fd = open(path, O_RDONLY);
+            struct stat st;
+            if (fd < 0 || fstat(fd, &st) != 0) {
+                perror(path);
+                if (fd >= 0) close(fd);
+                return -1;
+            }
+
+            const log_shard_header_t *header = NULL;
+            shard->path = path;
+            shard->size = (size_t)st.st_size;
+            shard->offset = sizeof(log_shard_header_t);
+            if (shard->size >= sizeof(*header)) {
+                shard->map = mmap(NULL, shard->size, PROT_READ, MAP_SHARED, fd, 0);
+                header = shard->map != MAP_FAILED ? (const log_shard_header_t*)shard->map : NULL;
+            }
+            close(fd);
+            if (!header || header->magic != LOGGER_SHARD_MAGIC) {
+                fprintf(stderr, "%s: not a shard file\n", path);
+                if (header) munmap((void*)shard->map, shard->size);
+                return -1;
+            }
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── MERGE ────────────────────────────┐
+
+        /* Timestamps first; the sequence number breaks ties so the order is total */
+        static bool shard_before(const shard_t *a, const shard_t *b) {
+            if (a->record.timestamp_ns != b->record.timestamp_ns) {
+                return a->record.timestamp_ns < b->record.timestamp_ns;
+            }
+            return a->record.seq < b->record.seq;
+        }
+
+        static void heap_down(shard_t **heap, size_t count, size_t i) {
+            for (;;) {
+                size_t smallest = i;
+                size_t left = 2 * i + 1, right = left + 1;
+                if (left < count && shard_before(heap[left], heap[smallest])) smallest = left;
+                if (right < count && shard_before(heap[right], heap[smallest])) smallest = right;
+                if (smallest == i) {
+                    return;
+                }
+                shard_t *swap = heap[i];
+                heap[i] = heap[smallest];
+                heap[smallest] = swap;
+                i = smallest;
+            }
+        }
+
+        /* K-way merge: write the smallest head, advance its shard, restore the heap */
+        static void merge(shard_t **heap, size_t count) {
+            for (size_t i = count / 2; i-- > 0; ) {
+                heap_down(heap, count, i);
+            }
+            while (count > 0) {
+                shard_t *shard = heap[0];
+                fwrite(shard->map + shard->offset + sizeof(log_shard_record_t), 1, shard->record.length, stdout);
+                shard->offset += sizeof(log_shard_record_t) + shard->record.length;
+                if (!shard_next(shard)) {
+                    heap[0] = heap[--count];
+                }
+                heap_down(heap, count, 0);
+            }
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── MAIN ────────────────────────────┐
+
+        int main(int argc, char **argv) {
+            if (argc < 2 || argv[1][0] == '-') {
+                usage(argv[0]);
+                return 2;
+            }
+
+            size_t count = (size_t)argc - 1;
+            shard_t *shards = calloc(count, sizeof(*shards));
+            shard_t **heap = calloc(count, sizeof(*heap));
+            size_t live = 0;
+            int status = 0;
+            if (!shards || !heap) {
+                perror("calloc");
+                return 1;
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                if (shard_open(&shards[i], argv[i + 1]) != 0) {
+                    status = 1;
+                    continue;
+                }
+                if (shard_next(&shards[i])) {
+                    heap[live++] = &shards[i];
+                }
+            }
+            merge(heap, live);
+
+            for (size_t i = 0; i < count; i++) {
+                if (shards[i].map && shards[i].map != MAP_FAILED) {
+                    munmap((void*)shards[i].map, shards[i].size);
+                }
+            }
+            free(heap);
+            free(shards);
+            return status;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
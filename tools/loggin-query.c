@@ -0,0 +1,261 @@
+// loggin-query.c — Indexed Time/Level Query over Log Files
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Length of the "YYYY-mm-dd HH:MM:SS" prefix of every line */
+    #define STAMP_LEN 19
+
+    /* Query given on the command line */
+    typedef struct {
+        const char *from_text;
+        const char *to_text;
+        int64_t from_ns;
+        int64_t to_ns;
+        uint32_t level_mask;
+    } query_t;
+
+    /* Read-only mapping of a whole file */
+    typedef struct {
+        const char *data;
+        size_t size;
+    } mapping_t;
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── ARGUMENTS ────────────────────────────┐
+
+        static void usage(const char *prog) {
+            fprintf(stderr,
+                    "usage: %s [--from \"YYYY-mm-dd HH:MM:SS\"] [--to \"YYYY-mm-dd HH:MM:SS\"]\n"
+                    "          [--level LEVEL[,LEVEL...]] [--min-level LEVEL] LOG INDEX\n"
+                    "Prints the lines of LOG in the time range and levels, reading only\n"
+                    "the blocks INDEX (see logger_set_file_index) says can match.\n", prog);
+        }
+
+        /* Parse a local timestamp into nanoseconds since the epoch */
+        static int parse_stamp(const char *text, int64_t *ns) {
+            struct tm tm = {0};
+            const char *end = strptime(text, "%Y-%m-%d %H:%M:%S", &tm);
+            if (!end || *end != '\0' || strlen(text) != STAMP_LEN) {
+                return -1;
+            }
+            tm.tm_isdst = -1;
+            *ns = (int64_t)mktime(&tm) * 1000000000;
+            return 0;
+        }
+
+        static int parse_level(const char *text) {
+            for (int i = LOG_LEVEL_TRACE; i <= LOG_LEVEL_FATAL; i++) {
+                if (strcasecmp(text, logger_level_to_string((log_level_t)i)) == 0) {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        /* Comma-separated level list into a bitmap */
+        static int parse_level_list(char *list, uint32_t *mask) {
+            *mask = 0;
+            for (char *tok = strtok(list, ","); tok; tok = strtok(NULL, ",")) {
+                int level = parse_level(tok);
+                if (level < 0) {
+                    return -1;
+                }
+                *mask |= 1u << level;
+            }
+            return *mask ? 0 : -1;
+        }
+
+        static int map_file(const char *path, mapping_t *map) {
+            struct stat st;
+            int fd = open(path, O_RDONLY);
+            if (fd < 0 || fstat(fd, &st) != 0) {
+                perror(path);
+                if (fd >= 0) close(fd);
+                return -1;
+            }
+
+            map->size = (size_t)st.st_size;
+            map->data = NULL;
+            if (map->size > 0) {
+                void *data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED) {
+                    perror(path);
+                    close(fd);
+                    return -1;
+                }
+                map->data = data;
+            }
+            close(fd);
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── SCANNING ────────────────────────────┐
+
+        /* Level of a line from its "%-5s" field, -1 if the line is not ours */
+        static int line_level(const char *line, size_t len) {
+            if (len < STAMP_LEN + 7 || line[STAMP_LEN] != ' ') {
+                return -1;
+            }
+            const char *field = line + STAMP_LEN + 1;
+            for (int i = LOG_LEVEL_TRACE; i <= LOG_LEVEL_FATAL; i++) {
+                const char *name = logger_level_to_string((log_level_t)i);
+                size_t n = strlen(name);
+                if (memcmp(field, name, n) == 0 && field[n] == ' ') {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+        /* Print the matching lines of log[begin, end) */
+        static void scan_range(const mapping_t *log, size_t begin, size_t end, const query_t *query) {
+            const char *p = log->data + begin;
+            const char *stop = log->data + (end < log->size ? end : log->size);
+
+            while (p < stop) {
+                const char *nl = memchr(p, '\n', (size_t)(stop - p));
+                const char *next = nl ? nl + 1 : stop;
+                size_t len = (size_t)(next - p);
+                int level = line_level(p, len);
+
+                if (level >= 0 && (query->level_mask & (1u << level)) &&
+                    (!query->from_text || memcmp(p, query->from_text, STAMP_LEN) >= 0) &&
+                    (!query->to_text || memcmp(p, query->to_text, STAMP_LEN) <= 0)) {
+                    fwrite(p, 1, len, stdout);
+                }
+                p = next;
+            }
+        }
+
+        /* First entry whose block may end at or after `from_ns` */
+        static size_t lower_bound(const log_index_entry_t *entries, size_t count, int64_t from_ns) {
+            size_t lo = 0;
+            size_t hi = count;
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (entries[mid].last_ns < from_ns) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return lo;
+        }
+
+        static int run_query(const mapping_t *log, const mapping_t *index, const query_t *query) {
+            if (index->size < sizeof(log_index_header_t)) {
+                fprintf(stderr, "index is empty or truncated\n");
+                return -1;
+            }
+
+            log_index_header_t header;
+            memcpy(&header, index->data, sizeof(header));
+            if (header.magic != LOGGER_INDEX_MAGIC || header.version != 1) {
+                fprintf(stderr, "not a loggin index\n");
+                return -1;
+            }
+
+            const log_index_entry_t *entries = (const log_index_entry_t*)(index->data + sizeof(header));
+            size_t count = (index->size - sizeof(header)) / sizeof(log_index_entry_t);
+            int64_t to_end = query->to_text ? query->to_ns + 999999999 : INT64_MAX;
+
+            if (count == 0) {
+                scan_range(log, 0, log->size, query);
+                return 0;
+            }
+
+            /* Records written before the index was attached */
+            if (entries[0].offset > 0 && query->from_ns <= entries[0].first_ns) {
+                scan_range(log, 0, entries[0].offset, query);
+            }
+
+            for (size_t i = lower_bound(entries, count, query->from_ns); i < count; i++) {
+                const log_index_entry_t *entry = &entries[i];
+                if (entry->first_ns > to_end) {
+                    return 0;
+                }
+                /* The last block also covers the not yet indexed tail */
+                size_t end = i + 1 < count ? entries[i + 1].offset : log->size;
+                if ((entry->level_mask & query->level_mask) || i + 1 == count) {
+                    scan_range(log, entry->offset, end, query);
+                }
+            }
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── MAIN ────────────────────────────┐
+
+        int main(int argc, char **argv) {
+            query_t query = { NULL, NULL, INT64_MIN, INT64_MAX, 0x3f };
+            int arg = 1;
+
+            while (arg + 1 < argc && strncmp(argv[arg], "--", 2) == 0) {
+                const char *opt = argv[arg];
+                char *value = argv[arg + 1];
+                int ok;
+
+                if (strcmp(opt, "--from") == 0) {
+                    ok = parse_stamp(value, &query.from_ns) == 0;
+                    query.from_text = value;
+                } else if (strcmp(opt, "--to") == 0) {
+                    ok = parse_stamp(value, &query.to_ns) == 0;
+                    query.to_text = value;
+                } else if (strcmp(opt, "--level") == 0) {
+                    ok = parse_level_list(value, &query.level_mask) == 0;
+                } else if (strcmp(opt, "--min-level") == 0) {
+                    int level = parse_level(value);
+                    ok = level >= 0;
+                    query.level_mask = ok ? 0x3fu & ~((1u << level) - 1) : 0;
+                } else {
+                    ok = 0;
+                }
+
+                if (!ok) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                arg += 2;
+            }
+
+            if (argc - arg != 2) {
+                usage(argv[0]);
+                return 2;
+            }
+
+            mapping_t log;
+            mapping_t index;
+            if (map_file(argv[arg], &log) != 0 || map_file(argv[arg + 1], &index) != 0) {
+                return 1;
+            }
+
+            return run_query(&log, &index, &query) == 0 ? 0 : 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
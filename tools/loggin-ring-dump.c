@@ -0,0 +1,180 @@
+// loggin-ring-dump.c — Reader for Crash Ring Files
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Text bytes carried by one slot */
+    #define SLOT_PAYLOAD (LOGGER_RING_SLOT_SIZE - sizeof(log_ring_slot_t))
+
+    /* A mapped ring file */
+    typedef struct {
+        const unsigned char *map;
+        size_t size;
+        uint64_t slot_count;
+    } ring_t;
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── ARGUMENTS ────────────────────────────┐
+
+        static void usage(const char *prog) {
+            fprintf(stderr,
+                    "usage: %s [-n COUNT] FILE\n"
+                    "Prints the records of a logger_add_ring_output file, oldest first.\n"
+                    "With -n, only the last COUNT records are printed.\n", prog);
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── SLOTS ────────────────────────────┐
+
+        static const log_ring_slot_t *slot_at(const ring_t *ring, uint64_t index) {
+            return (const log_ring_slot_t*)(ring->map + (index % ring->slot_count + 1) * LOGGER_RING_SLOT_SIZE);
+        }
+
+        /* The newest slot holds the highest sequence number; the oldest follows it */
+        static uint64_t find_wrap(const ring_t *ring) {
+            uint64_t newest = 0;
+            uint64_t newest_seq = 0;
+            for (uint64_t i = 0; i < ring->slot_count; i++) {
+                if (slot_at(ring, i)->seq > newest_seq) {
+                    newest_seq = slot_at(ring, i)->seq;
+                    newest = i;
+                }
+            }
+            return newest + 1;
+        }
+
+        /* A slot is usable when it was fully written and belongs to the current lap */
+        static bool slot_valid(const log_ring_slot_t *slot, uint64_t expected_seq) {
+            return slot->seq != 0 && slot->seq == expected_seq && slot->length <= SLOT_PAYLOAD;
+        }
+
+        /* Print one record: a head slot and the continuation slots after it */
+        static uint64_t print_record(const ring_t *ring, uint64_t index, uint64_t end) {
+            const log_ring_slot_t *slot = slot_at(ring, index);
+            uint64_t seq = slot->seq;
+            size_t last_len = 0;
+            const char *last = NULL;
+
+            do {
+                last = (const char*)(slot + 1);
+                last_len = slot->length;
+                fwrite(last, 1, last_len, stdout);
+                index++;
+                seq++;
+                slot = slot_at(ring, index);
+            } while (index < end && slot_valid(slot, seq) && (slot->flags & LOGGER_RING_CONTINUED));
+
+            /* A line cut short by the kill still ends the output line */
+            if (last_len == 0 || last[last_len - 1] != '\n') {
+                fputc('\n', stdout);
+            }
+            return index;
+        }
+
+        static int dump_ring(const char *path, long count) {
+            int fd = open(path, O_RDONLY);
+            struct stat st;
+            if (fd < 0 || fstat(fd, &st) != 0) {
+                perror(path);
+                if (fd >= 0) close(fd);
+                return -1;
+            }
+
+            ring_t ring = { NULL, (size_t)st.st_size, 0 };
+            const log_ring_header_t *header = NULL;
+            if (ring.size >= 2 * LOGGER_RING_SLOT_SIZE) {
+                ring.map = mmap(NULL, ring.size, PROT_READ, MAP_SHARED, fd, 0);
+                header = ring.map != MAP_FAILED ? (const log_ring_header_t*)ring.map : NULL;
+            }
+            close(fd);
+            if (!header || header->magic != LOGGER_RING_MAGIC || header->slot_size != LOGGER_RING_SLOT_SIZE ||
+                header->slot_count == 0 || (header->slot_count + 1) * LOGGER_RING_SLOT_SIZE != ring.size) {
+                fprintf(stderr, "%s: not a crash ring file\n", path);
+                if (header) munmap((void*)ring.map, ring.size);
+                return -1;
+            }
+            ring.slot_count = header->slot_count;
+
+            /* Walk one lap from the wrap point, collecting where every record starts */
+            uint64_t wrap = find_wrap(&ring);
+            uint64_t *heads = malloc(ring.slot_count * sizeof(*heads));
+            uint64_t head_count = 0;
+            uint64_t expected = 0;
+            if (!heads) {
+                munmap((void*)ring.map, ring.size);
+                return -1;
+            }
+
+            for (uint64_t i = wrap; i < wrap + ring.slot_count; i++) {
+                const log_ring_slot_t *slot = slot_at(&ring, i);
+                if (slot->seq == 0 || slot->length > SLOT_PAYLOAD) {
+                    expected = 0;
+                    continue;
+                }
+                /* Continuations whose head was overwritten or torn are skipped */
+                if (!(slot->flags & LOGGER_RING_CONTINUED)) {
+                    heads[head_count++] = i;
+                } else if (slot->seq != expected) {
+                    expected = 0;
+                    continue;
+                }
+                expected = slot->seq + 1;
+            }
+
+            uint64_t first = count >= 0 && (uint64_t)count < head_count ? head_count - (uint64_t)count : 0;
+            for (uint64_t i = first; i < head_count; i++) {
+                print_record(&ring, heads[i], wrap + ring.slot_count);
+            }
+
+            free(heads);
+            munmap((void*)ring.map, ring.size);
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── MAIN ────────────────────────────┐
+
+        int main(int argc, char **argv) {
+            long count = -1;
+            int first_file = 1;
+
+            if (argc > 2 && strcmp(argv[1], "-n") == 0) {
+                char *end;
+                count = strtol(argv[2], &end, 10);
+                if (*end != '\0' || count < 0) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                first_file = 3;
+            }
+
+            if (first_file != argc - 1) {
+                usage(argv[0]);
+                return 2;
+            }
+            return dump_ring(argv[first_file], count) == 0 ? 0 : 1;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
@@ -0,0 +1,184 @@
+// loggin-zcat.c — Reader for Compressed Log Output
+//
+// repo   : https://github.com/ItsCbass/loggin.c
+// docs   : https://github.com/ItsCbass/loggin.c
+// author : https://github.com/ItsCbass
+//
+// Developed with ❤️ by Sebastian Rivera.
+
+#define _GNU_SOURCE
+
+#include "../lib/loggin.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ╔══════════════════════════════════════ INIT ══════════════════════════════════════╗
+
+    /* Time range requested on the command line */
+    typedef struct {
+        const char *from_text;
+        const char *to_text;
+        int64_t from_ns;
+        int64_t to_ns;
+    } time_range_t;
+
+    /* Length of the "YYYY-mm-dd HH:MM:SS" prefix of every line */
+    #define STAMP_LEN 19
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝
+
+// ╔══════════════════════════════════════ CORE ══════════════════════════════════════╗
+
+    // ┌──────────────────────────── ARGUMENTS ────────────────────────────┐
+
+        static void usage(const char *prog) {
+            fprintf(stderr,
+                    "usage: %s [--from \"YYYY-mm-dd HH:MM:SS\"] [--to \"YYYY-mm-dd HH:MM:SS\"] FILE...\n"
+                    "Decompresses the frames of a logger_add_compressed_output file that\n"
+                    "overlap the time range and prints the lines inside it.\n", prog);
+        }
+
+        /* Parse a local timestamp into nanoseconds since the epoch */
+        static int parse_stamp(const char *text, int64_t *ns) {
+            struct tm tm = {0};
+            const char *end = strptime(text, "%Y-%m-%d %H:%M:%S", &tm);
+            if (!end || *end != '\0') {
+                return -1;
+            }
+            tm.tm_isdst = -1;
+            *ns = (int64_t)mktime(&tm) * 1000000000;
+            return 0;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── FRAMES ────────────────────────────┐
+
+        /* Print the lines of one decoded frame that fall inside the range */
+        static void print_lines(const char *data, size_t size, const time_range_t *range) {
+            const char *end = data + size;
+
+            while (data < end) {
+                const char *nl = memchr(data, '\n', (size_t)(end - data));
+                const char *next = nl ? nl + 1 : end;
+                size_t len = (size_t)(next - data);
+
+                /* The text timestamp sorts lexicographically */
+                bool keep = len < STAMP_LEN ||
+                            ((!range->from_text || memcmp(data, range->from_text, STAMP_LEN) >= 0) &&
+                             (!range->to_text || memcmp(data, range->to_text, STAMP_LEN) <= 0));
+                if (keep) {
+                    fwrite(data, 1, len, stdout);
+                }
+                data = next;
+            }
+        }
+
+        /* Walk a file frame by frame, seeking over frames outside the range */
+        static int dump_file(const char *path, const time_range_t *range) {
+            FILE *file = fopen(path, "rb");
+            if (!file) {
+                perror(path);
+                return -1;
+            }
+
+            unsigned char *packed = NULL;
+            char *raw = NULL;
+            size_t packed_cap = 0;
+            size_t raw_cap = 0;
+            log_frame_header_t header;
+            int result = 0;
+
+            while (fread(&header, sizeof(header), 1, file) == 1) {
+                if (header.magic != LOGGER_FRAME_MAGIC) {
+                    fprintf(stderr, "%s: bad frame magic at offset %ld\n", path, ftell(file) - (long)sizeof(header));
+                    result = -1;
+                    break;
+                }
+
+                /* Frames stamped with last < from or first > to are never read */
+                int64_t to_end = range->to_text ? range->to_ns + 999999999 : INT64_MAX;
+                if (header.last_ns < range->from_ns || header.first_ns > to_end) {
+                    if (fseek(file, (long)header.packed_size, SEEK_CUR) != 0) {
+                        result = -1;
+                        break;
+                    }
+                    continue;
+                }
+
+                if (header.packed_size > packed_cap) {
+                    packed_cap = header.packed_size;
+                    packed = realloc(packed, packed_cap);
+                }
+                if (header.raw_size > raw_cap) {
+                    raw_cap = header.raw_size;
+                    raw = realloc(raw, raw_cap);
+                }
+                if (!packed || !raw || fread(packed, 1, header.packed_size, file) != header.packed_size) {
+                    fprintf(stderr, "%s: truncated frame\n", path);
+                    result = -1;
+                    break;
+                }
+
+                if (header.flags & LOGGER_FRAME_STORED) {
+                    print_lines((const char*)packed, header.packed_size, range);
+                } else if (logger_lz_decompress(packed, header.packed_size, raw, header.raw_size) == (long)header.raw_size) {
+                    print_lines(raw, header.raw_size, range);
+                } else {
+                    fprintf(stderr, "%s: corrupt frame\n", path);
+                    result = -1;
+                    break;
+                }
+            }
+
+            free(packed);
+            free(raw);
+            fclose(file);
+            return result;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+    // ┌──────────────────────────── MAIN ────────────────────────────┐
+
+        int main(int argc, char **argv) {
+            time_range_t range = { NULL, NULL, INT64_MIN, INT64_MAX };
+            int first_file = 1;
+
+            while (first_file < argc && strncmp(argv[first_file], "--", 2) == 0) {
+                const char *opt = argv[first_file];
+                if (first_file + 1 >= argc) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                const char *value = argv[first_file + 1];
+
+                if (strcmp(opt, "--from") == 0 && parse_stamp(value, &range.from_ns) == 0 && strlen(value) == STAMP_LEN) {
+                    range.from_text = value;
+                } else if (strcmp(opt, "--to") == 0 && parse_stamp(value, &range.to_ns) == 0 && strlen(value) == STAMP_LEN) {
+                    range.to_text = value;
+                } else {
+                    usage(argv[0]);
+                    return 2;
+                }
+                first_file += 2;
+            }
+
+            if (first_file >= argc) {
+                usage(argv[0]);
+                return 2;
+            }
+
+            int status = 0;
+            for (int i = first_file; i < argc; i++) {
+                if (dump_file(argv[i], &range) != 0) {
+                    status = 1;
+                }
+            }
+            return status;
+        }
+
+    // └────────────────────────────────────────────────────────────────────┘
+
+// ╚═════════════════════════════════════════════════════════════════════════════════════╝